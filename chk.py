@@ -0,0 +1,13 @@
+import struct,sys
+n=int(sys.argv[1]); s=n*n; cl=open(sys.argv[2],'rb').read(); so=open(sys.argv[3],'rb').read()
+G=s*s*4
+assert len(cl)==len(so),(len(cl),len(so))
+bad=0
+for i in range(len(cl)//G):
+    c=struct.unpack(f'<{s*s}I',cl[i*G:(i+1)*G]); v=struct.unpack(f'<{s*s}I',so[i*G:(i+1)*G])
+    ok=all(a==0 or a==b for a,b in zip(c,v))
+    g=[v[r*s:(r+1)*s] for r in range(s)]
+    full=set(range(1,s+1))
+    ok=ok and all(set(r)==full for r in g) and all(set(col)==full for col in zip(*g)) and all(set(g[br+r][bc+cc] for r in range(n) for cc in range(n))==full for br in range(0,s,n) for bc in range(0,s,n))
+    if not ok: bad+=1; print("bad grid",i)
+print("checked",len(cl)//G,"bad",bad)
@@ -0,0 +1,35 @@
+#!/bin/env python3
+
+"""Compares the JSON reports of make bench bench_args=--json of several builds.
+
+The first report is the baseline. For each grid size and engine, the median
+latency of each build is printed with its gain over the baseline.
+"""
+
+import json
+import sys
+from pathlib import Path
+
+
+def load_report(path: Path) -> dict[tuple[int, str], float]:
+    with path.open() as file:
+        return {(record['n'], record['engine']): record['median_us']
+                for record in map(json.loads, filter(str.strip, file))}
+
+
+if len(sys.argv) < 3:
+    print(f'Usage : {sys.argv[0]} <baseline:file> <report:file>...', file=sys.stderr)
+    sys.exit(1)
+
+paths = [Path(arg) for arg in sys.argv[1:]]
+reports = [load_report(path) for path in paths]
+names = [path.stem for path in paths]
+
+print(f'{"N":<4} {"engine":<14}', *(f'{name + " (us)":>20}' for name in names))
+for key, baseline in reports[0].items():
+    cells = [f'{baseline:>20.3f}']
+    for report in reports[1:]:
+        median = report.get(key)
+        cells.append(f'{"-":>20}' if median is None
+                     else f'{f"{median:.3f} ({(baseline / median - 1) * 100:+.1f}%)":>20}')
+    print(f'{key[0]:<4} {key[1]:<14}', *cells)
@@ -79,3 +79,126 @@ def grid_decode(n: int, binFile: BinaryIO) -> List[List[int]]:
                 4), byteorder='little', signed=True))
         grid.append(row)
     return grid
+
+
+PACKED_MAGIC = b"SUDP"
+PACKED_VERSION = 1
+PACKED_FLAG_RLE = 1
+PACKED_COUNT_UNKNOWN = 0xFFFFFFFF
+
+
+class _BitWriter:
+    """Writes bits from the least significant bit of each byte."""
+
+    def __init__(self):
+        self.bytes = bytearray()
+        self.bits = 0
+        self.count = 0
+
+    def write(self, value: int, width: int):
+        self.bits |= value << self.count
+        self.count += width
+        while self.count >= 8:
+            self.bytes.append(self.bits & 0xFF)
+            self.bits >>= 8
+            self.count -= 8
+
+    def write_gamma(self, value: int):
+        width = value.bit_length() - 1
+        self.write(0, width)
+        self.write(1, 1)
+        self.write(value & ((1 << width) - 1), width)
+
+    def flush(self) -> bytes:
+        if self.count > 0:
+            self.bytes.append(self.bits & 0xFF)
+            self.bits = self.count = 0
+        return bytes(self.bytes)
+
+
+class _BitReader:
+    """Reads bits from the least significant bit of each byte."""
+
+    def __init__(self, data: bytes, position: int):
+        self.data = data
+        self.position = position
+        self.bits = 0
+        self.count = 0
+
+    def read(self, width: int) -> int:
+        while self.count < width:
+            if self.position == len(self.data):
+                raise ValueError("truncated packed grid")
+            self.bits |= self.data[self.position] << self.count
+            self.position += 1
+            self.count += 8
+        value = self.bits & ((1 << width) - 1)
+        self.bits >>= width
+        self.count -= width
+        return value
+
+    def read_gamma(self) -> int:
+        width = 0
+        while self.read(1) == 0:
+            width += 1
+        return (1 << width) | self.read(width)
+
+
+def grid_encode_packed_header(n: int, flags: int, count: int, binFile: BinaryIO):
+    """Writes the header of a packed stream of count grids of size n⁴ to binFile."""
+    binFile.write(PACKED_MAGIC + bytes([PACKED_VERSION, flags, n, 0]) +
+                  count.to_bytes(4, byteorder='little', signed=False))
+
+
+def grid_encode_packed(grid: List[List[int]], flags: int, binFile: BinaryIO):
+    """Writes the grid to binFile in packed format, after the header."""
+    size = len(grid)
+    writer = _BitWriter()
+    values = [value for row in grid for value in row]
+    if flags & PACKED_FLAG_RLE:
+        width = (size - 1).bit_length()
+        run = 0
+        for value in values:
+            if value == 0:
+                run += 1
+            else:
+                writer.write_gamma(run + 1)
+                writer.write(value - 1, width)
+                run = 0
+        if run > 0:
+            writer.write_gamma(run + 1)
+    else:
+        width = size.bit_length()
+        for value in values:
+            writer.write(value, width)
+    binFile.write(writer.flush())
+
+
+def grid_decode_packed(binFile: BinaryIO) -> List[List[List[int]]]:
+    """Reads all the grids of a packed stream from binFile."""
+    data = binFile.read()
+    if len(data) < 12 or data[:4] != PACKED_MAGIC or data[4] != PACKED_VERSION:
+        raise ValueError("not a packed stream")
+    flags, n = data[5], data[6]
+    count = int.from_bytes(data[8:12], byteorder='little', signed=False)
+    size = n * n
+    grids = []
+    position = 12
+    # Without a count, the grids go on until the end of the stream
+    while position < len(data) if count == PACKED_COUNT_UNKNOWN else len(grids) < count:
+        reader = _BitReader(data, position)
+        values = []
+        if flags & PACKED_FLAG_RLE:
+            width = (size - 1).bit_length()
+            while len(values) < size * size:
+                values += [0] * (reader.read_gamma() - 1)
+                if len(values) < size * size:
+                    values.append(reader.read(width) + 1)
+        else:
+            width = size.bit_length()
+            values = [reader.read(width) for _ in range(size * size)]
+        if len(values) != size * size:
+            raise ValueError("malformed packed grid")
+        grids.append([values[r * size:(r + 1) * size] for r in range(size)])
+        position = reader.position
+    return grids
@@ -0,0 +1,23 @@
+#!/bin/env bash
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+    echo >&2 "Usage : $0 <exe:file> <grids:dir>"
+    exit 1
+fi
+
+# Resolve arguments
+file_exe=$(realpath -e "$1")
+dir_grids=$(realpath -e "$2")
+
+# Training run: every engine on every sample grid of the N3 to N5 directories,
+# in batch mode to also cover the input and output paths. Counting the solutions
+# uses propagation, as plain backtracking takes seconds on N=5.
+for dir_n in "$dir_grids"/N[3-5]; do
+    n=${dir_n##*/N}
+    for file_grid in "$dir_n"/*.sud; do
+        for args in -s -sp '-s -e dlx' '-s -e fixed' -up; do
+            $file_exe $n "$file_grid" -m $args >/dev/null 2>&1
+        done
+    done
+done
@@ -0,0 +1,31 @@
+#!/bin/env bash
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+    echo >&2 "Usage : $0 <exe:file> <grids:dir>"
+    exit 1
+fi
+
+# Resolve arguments
+file_exe=$(realpath -e "$1")
+dir_grids=$(realpath -e "$2")
+dir_scripts=$(dirname "$(realpath -e "$0")")
+
+# Every grid of the N* directories is solved and checked, with and without
+# propagation. A grid with a .unique file next to it must also have the solution
+# count it holds, with and without propagation.
+for dir_n in "$dir_grids"/N*; do
+    n=${dir_n##*/N}
+    for file_grid in "$dir_n"/*.sud; do
+        for opt_p in '' -p; do
+            echo "N=$n ${file_grid#"$dir_grids"/} $opt_p"
+            result=$("$file_exe" $n -sb $opt_p <"$file_grid" | "$dir_scripts"/check.py -q $n)
+            echo "$result"
+            [[ $result == 'Sudoku grid valid.' ]]
+            file_unique=${file_grid%.sud}.unique
+            if [[ -f $file_unique ]]; then
+                diff <("$file_exe" $n -u $opt_p <"$file_grid") "$file_unique"
+            fi
+        done
+    done
+done
@@ -2,9 +2,14 @@
 
 import sys
 
-from grid import grid_decode, grid_print
+from grid import grid_decode, grid_decode_packed, grid_print, PACKED_MAGIC
 
 if __name__ == "__main__":
+    # Packed streams carry N in their header
+    if sys.stdin.buffer.peek(4)[:4] == PACKED_MAGIC:
+        for g in grid_decode_packed(sys.stdin.buffer):
+            grid_print(g, sys.stdout)
+        sys.exit(0)
     if (len(sys.argv) != 2 or not sys.argv[1].isdecimal()):
         print(f"Usage: {sys.argv[0]} N", file=sys.stderr)
         sys.exit(1)
@@ -2,8 +2,16 @@
 
 import sys
 
-from grid import grid_parse, grid_encode
+from grid import grid_parse, grid_encode, grid_encode_packed_header, grid_encode_packed, PACKED_FLAG_RLE
 
 if __name__ == "__main__":
+    if len(sys.argv) > 2 or len(sys.argv) == 2 and sys.argv[1] not in ("--packed", "--packed=rle"):
+        print(f"Usage: {sys.argv[0]} [--packed[=rle]]", file=sys.stderr)
+        sys.exit(1)
     g = grid_parse(sys.stdin).grid
-    grid_encode(g, sys.stdout.buffer)
+    if len(sys.argv) == 2:
+        flags = PACKED_FLAG_RLE if sys.argv[1] == "--packed=rle" else 0
+        grid_encode_packed_header(int(len(g) ** 0.5), flags, 1, sys.stdout.buffer)
+        grid_encode_packed(g, flags, sys.stdout.buffer)
+    else:
+        grid_encode(g, sys.stdout.buffer)
@@ -0,0 +1,99 @@
+/** @file
+ * @brief Arena allocator
+ * @author 5cover, Matteo-K
+ *
+ * A bump allocator over a single block of memory sized up front. Blocks are
+ * never freed individually: freeing the arena frees them all at once.
+ *
+ * In debug builds, the blocks are registered in the memory debugger, so that
+ * they can be checked with @ref check_alloc and are reported if the arena is
+ * never freed.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "memdbg.c"
+
+/// @brief Integer: alignment of the blocks of an arena.
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+
+#ifdef NDEBUG
+#define ARENA_OFFSET 0
+#else
+/// @brief Integer: offset of the first block in the memory of an arena.
+/// @remark In debug builds, keeps the first block from having the same address
+/// as the arena memory in the memory debugger.
+#define ARENA_OFFSET ARENA_ALIGNMENT
+#endif // NDEBUG
+
+/// @brief An arena allocator
+typedef struct {
+    /// @brief Memory of the arena.
+    char *memory;
+    /// @brief Size of the memory, in bytes.
+    size_t size;
+    /// @brief Number of bytes used.
+    size_t used;
+} tArena;
+
+/// @brief Gets the number of bytes a block of @p size bytes takes in an arena.
+#define arena_blockSize(size) (((size) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+/// @brief Allocates an array in an arena.
+#define arena_array(arena, name, length) arena_alloc((arena), sizeof *(name) * (length))
+
+/// @brief Creates an arena.
+/// @param size in: the number of bytes of the arena. Must account for the
+/// alignment of the blocks: see @ref arena_blockSize.
+/// @return A new arena. Must be freed with @ref arena_free.
+tArena arena_create(size_t size);
+
+/// @brief Frees an arena and all its blocks.
+/// @param arena in/out: the arena to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created arena.
+void arena_free(tArena *arena);
+
+/// @brief Allocates a block in an arena.
+/// @param arena in/out: the arena
+/// @param size in: the number of bytes to allocate
+/// @return A pointer to the uninitialized block, or NULL if the arena is full.
+void *arena_alloc(tArena *arena, size_t size);
+
+/////////////////////////////////////////////////////////////////////////
+
+tArena arena_create(size_t size) {
+    tArena arena = {
+        .size = ARENA_OFFSET + size,
+        .used = ARENA_OFFSET,
+    };
+    arena.memory = check_alloc(malloc(arena.size), "arena of %zu bytes", size);
+    return arena;
+}
+
+void arena_free(tArena *arena) {
+#ifndef NDEBUG
+    if (arena->memory != NULL) {
+        dbg_untrack(__FILE__, __LINE__, arena->memory, arena->size);
+    }
+#endif // NDEBUG
+    free(arena->memory);
+}
+
+void *arena_alloc(tArena *arena, size_t size) {
+    size_t const blockSize = arena_blockSize(size);
+    if (blockSize > arena->size - arena->used) {
+        return NULL;
+    }
+
+    void *block = arena->memory + arena->used;
+    arena->used += blockSize;
+
+#ifndef NDEBUG
+    dbg_track(__FILE__, __LINE__, block, size);
+#endif // NDEBUG
+
+    return block;
+}
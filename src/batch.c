@@ -0,0 +1,491 @@
+/** @file
+ * @brief Multi-threaded batch solver
+ * @author 5cover, Matteo-K
+ *
+ * Solves a stream of Sud grids with a pool of worker threads, each owning a
+ * solver.
+ *
+ * The grids flow through a pipeline of three stages, connected by a ring of
+ * slots, one slot per grid in flight. Grid i is in slot i % slot count.
+ *
+ * - A reader thread parses the input into free slots, by runs of consecutive
+ *   slots. The slots point into the memory mapping of the input file when
+ *   possible, and hold a copy of the grid otherwise.
+ * - The workers claim the grids read in input order and store the result in
+ *   their slot, so that a few hard grids don't leave the other workers idle.
+ * - The main thread writes the slots in input order as soon as they're done,
+ *   which frees them for the reader.
+ *
+ * The stages communicate through counters and slot statuses updated with
+ * atomic operations: a stage only blocks, on a condition variable, when it has
+ * nothing to do. The reader never gets more than the ring ahead of the output,
+ * which bounds the memory used whatever the size of the input.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cache.c"
+#include "grid.c"
+#include "input.c"
+#include "memdbg.c"
+#include "packed.c"
+#include "solver.c"
+#include "types.c"
+
+/// @brief Integer: number of slots of the ring, per worker.
+/// @remark A multiple of @ref BATCH_READ_GRIDS.
+#define BATCH_SLOTS_PER_WORKER 64
+
+/// @brief Integer: number of grids read at once by the reader.
+#define BATCH_READ_GRIDS 16
+
+/// @brief Integer: status of a slot that hasn't been processed yet.
+/// @remark Distinct from 0 and the negative error codes returned by @ref
+/// grid_loadSudValues.
+#define SLOT_PENDING 1
+
+/// @brief Options of a batch.
+typedef struct {
+    /// @brief Whether to solve the grids.
+    bool solve;
+    /// @brief Whether to output in binary (Sud) format.
+    bool binary;
+    /// @brief Whether to output in the packed format, whose header has been
+    /// written. Takes precedence over @ref binary.
+    bool packed;
+    /// @brief Flags of the packed output.
+    uint8_t packedFlags;
+    /// @brief Whether to check the uniqueness of the solutions of the grids
+    /// instead of outputting them.
+    bool checkUniqueness;
+    /// @brief Engine used to solve the grids.
+    tEngine engine;
+    /// @brief Whether to propagate singletons while backtracking.
+    bool propagate;
+    /// @brief Number of worker threads.
+    unsigned workerCount;
+    /// @brief Cache of the solutions, shared by the workers, or NULL.
+    tCache *cache;
+} tBatchOptions;
+
+/// @brief A condition a pipeline stage waits for.
+/// @remark The condition is set without the lock: the lock is only taken when
+/// a thread is waiting.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    /// @brief Number of threads waiting for the condition.
+    atomic_uint waiterCount;
+} tBatchSignal;
+
+struct sBatch;
+
+/// @brief A worker thread of a batch.
+typedef struct {
+    /// @brief The batch this worker belongs to.
+    struct sBatch *batch;
+    /// @brief The solver of this worker.
+    tSolver solver;
+    /// @brief The cache key of this worker, if the batch has a cache.
+    tCacheKey cacheKey;
+    /// @brief The thread of this worker.
+    pthread_t thread;
+} tWorker;
+
+/// @brief A multi-threaded batch solver.
+typedef struct sBatch {
+    /// @brief Options of the batch.
+    tBatchOptions options;
+
+    /// @brief Workers of the batch.
+    /// @remark Dimensions: [workerIndex]
+    tWorker *workers;
+
+    /// @brief The input, only used by the reader.
+    tInput *input;
+
+    /// @brief The reader thread.
+    pthread_t reader;
+
+    /// @brief Grid used by the main thread to output the slots.
+    tGrid output;
+
+    /// @brief Buffer used by the main thread to encode the slots in the
+    /// packed format, or NULL.
+    uint8_t *packedBuffer;
+
+    /// @brief Sud values of the input grid of each slot: either in the input
+    /// mapping or in @ref slots.
+    /// @remark Dimensions: [slotIndex]
+    uint32_t const **slotInputs;
+
+    /// @brief Sud values of the output grid of each slot.
+    /// @remark Dimensions: [slotIndex][cellIndex]
+    uint32_t *slots;
+
+    /// @brief Status of each slot: @ref SLOT_PENDING or the result of @ref
+    /// grid_loadSudValues.
+    /// @remark Dimensions: [slotIndex]
+    atomic_int *slotStatuses;
+
+    /// @brief Solution count of each slot, when checking uniqueness.
+    /// @remark Dimensions: [slotIndex]
+    unsigned *slotSolutionCounts;
+
+    /// @brief Number of slots of the ring.
+    size_t slotCount;
+
+    /// @brief Number of grids read. Only increased by the reader.
+    atomic_ulong readCount;
+
+    /// @brief Number of the next grid to claim, from 0. Increased by the
+    /// workers.
+    atomic_ulong claimCount;
+
+    /// @brief Number of grids written. Only increased by the main thread.
+    atomic_ulong writtenCount;
+
+    /// @brief Whether @ref readCount is final.
+    atomic_bool readEnded;
+
+    /// @brief Whether the reader must stop, after an invalid grid.
+    atomic_bool stopping;
+
+    /// @brief Result of the last read: 0 or @ref ERROR_INVALID_DATA.
+    /// @remark Only valid once @ref readEnded is set.
+    int readResult;
+
+    /// @brief Signaled when grids are read or the reading ends.
+    tBatchSignal gridsRead;
+
+    /// @brief Signaled when a slot is done.
+    tBatchSignal slotDone;
+
+    /// @brief Signaled when slots are written or the batch stops.
+    tBatchSignal slotsFree;
+} tBatch;
+
+/// @brief Waits for a condition of the pipeline.
+/// @param signal in/out: the signal notified when the condition may have
+/// become true (tBatchSignal *)
+/// @param condition in: the condition, evaluated repeatedly
+#define batch_waitFor(signal, condition)                             \
+    do {                                                             \
+        if (!(condition)) {                                          \
+            pthread_mutex_lock(&(signal)->lock);                     \
+            atomic_fetch_add(&(signal)->waiterCount, 1);             \
+            while (!(condition)) {                                   \
+                pthread_cond_wait(&(signal)->cond, &(signal)->lock); \
+            }                                                        \
+            atomic_fetch_sub(&(signal)->waiterCount, 1);             \
+            pthread_mutex_unlock(&(signal)->lock);                   \
+        }                                                            \
+    } while (0)
+
+/// @brief Creates a batch.
+/// @param N in: grid size factor
+/// @param options in: options of the batch
+/// @return A new batch. Must be freed with @ref batch_free.
+tBatch batch_create(tIntN N, tBatchOptions options);
+
+/// @brief Frees a batch.
+/// @param batch in/out: the batch to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created batch, as all its pointers are either NULL or valid.
+void batch_free(tBatch *batch);
+
+/// @brief Processes all the grids of a stream.
+/// @param batch in/out: the batch
+/// @param input in/out: the input to read the grids from
+/// @param outStream in: the stream to write the grids to
+/// @param gridCount out: the number of grids processed
+/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if a grid is
+/// invalid. In that case, the grids before it have been written.
+int batch_run(tBatch *batch, tInput *input, FILE *outStream, unsigned long *gridCount);
+
+/// @brief Notifies the threads waiting for a condition that it may have become
+/// true.
+/// @param signal in/out: the signal
+/// @remark The condition must be set before, with a sequentially consistent
+/// atomic operation.
+void batch_notify(tBatchSignal *signal);
+
+/// @brief Main function of the reader thread.
+/// @param batch in/out: the batch (tBatch *)
+/// @return NULL.
+/// @remark Used in @ref batch_run.
+void *batch_readerMain(void *batch);
+
+/// @brief Main function of a worker thread.
+/// @param worker in/out: the worker (tWorker *)
+/// @return NULL.
+/// @remark Used in @ref batch_run.
+void *batch_workerMain(void *worker);
+
+/// @brief Solves a grid.
+/// @param batch in/out: the batch
+/// @param worker in/out: the worker
+/// @param number in: the number of the grid, from 0
+/// @remark Used in @ref batch_workerMain.
+void batch_processGrid(tBatch *batch, tWorker *worker, unsigned long number);
+
+/// @brief Writes a run of consecutive done slots.
+/// @param batch in/out: the batch
+/// @param first in: the index of the first slot
+/// @param count in: the number of slots
+/// @param outStream in: the stream to write the grids to
+/// @remark Used in @ref batch_run.
+void batch_writeSlots(tBatch *batch, size_t first, size_t count, FILE *outStream);
+
+/////////////////////////////////////////////////////////////////////////
+
+tBatch batch_create(tIntN N, tBatchOptions options) {
+    size_t const cellCount = (size_t)(N * N) * (N * N);
+
+    tBatch batch = {
+        .options = options,
+        .output = grid_create(N, 0),
+        .slotCount = (size_t)BATCH_SLOTS_PER_WORKER * options.workerCount,
+    };
+
+    batch.workers = check_alloc(array_malloc(batch.workers, options.workerCount), "batch workers array");
+    batch.slotInputs = check_alloc(array_malloc(batch.slotInputs, batch.slotCount), "batch slot inputs array");
+    batch.slots = check_alloc(array_malloc(batch.slots, batch.slotCount * cellCount), "batch slots array");
+    batch.slotStatuses = check_alloc(array_malloc(batch.slotStatuses, batch.slotCount), "batch slot statuses array");
+    batch.slotSolutionCounts = check_alloc(array_malloc(batch.slotSolutionCounts, batch.slotCount), "batch slot solution counts array");
+    batch.packedBuffer = options.packed
+        ? check_alloc(malloc(packed_maxGridSize(N, options.packedFlags)), "batch packed buffer")
+        : NULL;
+
+    for (unsigned w = 0; w < options.workerCount; w++) {
+        batch.workers[w] = (tWorker) {
+            .solver = solver_create(N, options.engine, options.propagate),
+            .cacheKey = options.cache == NULL ? (tCacheKey) { 0 } : cache_createKey(N),
+        };
+    }
+
+    return batch;
+}
+
+void batch_free(tBatch *batch) {
+    if (batch->workers != NULL) {
+        for (unsigned w = 0; w < batch->options.workerCount; w++) {
+            solver_free(&batch->workers[w].solver);
+            cache_freeKey(&batch->workers[w].cacheKey);
+        }
+    }
+    free(batch->workers);
+    grid_free(&batch->output);
+    free(batch->slotInputs);
+    free(batch->slots);
+    free(batch->slotStatuses);
+    free(batch->slotSolutionCounts);
+    free(batch->packedBuffer);
+}
+
+int batch_run(tBatch *batch, tInput *input, FILE *outStream, unsigned long *gridCount) {
+    unsigned const workerCount = batch->options.workerCount;
+    tBatchSignal *const signals[] = { &batch->gridsRead, &batch->slotDone, &batch->slotsFree };
+
+    batch->input = input;
+    atomic_init(&batch->readCount, 0);
+    atomic_init(&batch->claimCount, 0);
+    atomic_init(&batch->writtenCount, 0);
+    atomic_init(&batch->readEnded, false);
+    atomic_init(&batch->stopping, false);
+    for (size_t i = 0; i < sizeof signals / sizeof *signals; i++) {
+        pthread_mutex_init(&signals[i]->lock, NULL);
+        pthread_cond_init(&signals[i]->cond, NULL);
+        atomic_init(&signals[i]->waiterCount, 0);
+    }
+
+    pthread_create(&batch->reader, NULL, batch_readerMain, batch);
+    for (unsigned w = 0; w < workerCount; w++) {
+        batch->workers[w].batch = batch;
+        pthread_create(&batch->workers[w].thread, NULL, batch_workerMain, &batch->workers[w]);
+    }
+
+    int result = 0;
+    unsigned long written = 0;
+
+    // Write the slots in order as they're done, by runs of consecutive done
+    // slots
+    while (true) {
+        size_t const first = written % batch->slotCount;
+        batch_waitFor(&batch->slotDone,
+            (written < atomic_load(&batch->readCount) && atomic_load(&batch->slotStatuses[first]) != SLOT_PENDING)
+                || (atomic_load(&batch->readEnded) && written >= atomic_load(&batch->readCount)));
+
+        unsigned long const readCount = atomic_load(&batch->readCount);
+        if (written >= readCount) {
+            // End of input. It must end at a grid boundary.
+            result = batch->readResult;
+            break;
+        }
+
+        int const status = atomic_load(&batch->slotStatuses[first]);
+        if (status != 0) {
+            result = status;
+            break;
+        }
+
+        size_t end = first + 1;
+        while (end < batch->slotCount && written + (end - first) < readCount
+            && atomic_load(&batch->slotStatuses[end]) == 0) {
+            end++;
+        }
+
+        batch_writeSlots(batch, first, end - first, outStream);
+        written += end - first;
+        atomic_store(&batch->writtenCount, written);
+        batch_notify(&batch->slotsFree);
+    }
+
+    if (result != 0) {
+        // Don't read past the invalid grid
+        atomic_store(&batch->stopping, true);
+        batch_notify(&batch->slotsFree);
+    }
+
+    pthread_join(batch->reader, NULL);
+    for (unsigned w = 0; w < workerCount; w++) {
+        pthread_join(batch->workers[w].thread, NULL);
+    }
+
+    for (size_t i = 0; i < sizeof signals / sizeof *signals; i++) {
+        pthread_cond_destroy(&signals[i]->cond);
+        pthread_mutex_destroy(&signals[i]->lock);
+    }
+
+    *gridCount = written;
+    return result;
+}
+
+void batch_notify(tBatchSignal *signal) {
+    // A waiter counts itself before checking the condition: if none is counted
+    // yet, the next one will see the condition set
+    if (atomic_load(&signal->waiterCount) > 0) {
+        pthread_mutex_lock(&signal->lock);
+        pthread_cond_broadcast(&signal->cond);
+        pthread_mutex_unlock(&signal->lock);
+    }
+}
+
+void *batch_readerMain(void *batch) {
+    tBatch *self = batch;
+    size_t const cellCount = (size_t)grid_size(self->output) * grid_size(self->output);
+    unsigned long readCount = 0;
+    int result = 0;
+
+    while (true) {
+        // Wait for the next run of slots to be written
+        size_t const first = readCount % self->slotCount;
+        size_t const maxCount = min((size_t)BATCH_READ_GRIDS, self->slotCount - first);
+        batch_waitFor(&self->slotsFree,
+            readCount + maxCount <= atomic_load(&self->writtenCount) + self->slotCount
+                || atomic_load(&self->stopping));
+        if (atomic_load(&self->stopping)) {
+            break;
+        }
+
+        uint32_t const *grids;
+        size_t count;
+        result = input_readGrids(self->input, cellCount, maxCount, &self->slots[first * cellCount], &grids, &count);
+
+        for (size_t i = 0; i < count; i++) {
+            self->slotInputs[first + i] = &grids[i * cellCount];
+            atomic_store(&self->slotStatuses[first + i], SLOT_PENDING);
+        }
+        readCount += count;
+        atomic_store(&self->readCount, readCount);
+        batch_notify(&self->gridsRead);
+
+        if (count < maxCount || result != 0) {
+            break;
+        }
+    }
+
+    self->readResult = result;
+    atomic_store(&self->readEnded, true);
+    batch_notify(&self->gridsRead);
+    batch_notify(&self->slotDone);
+    return NULL;
+}
+
+void *batch_workerMain(void *worker) {
+    tWorker *self = worker;
+    tBatch *batch = self->batch;
+
+    while (true) {
+        // Claim the next grid, and wait for it to be read
+        unsigned long const number = atomic_fetch_add(&batch->claimCount, 1);
+        batch_waitFor(&batch->gridsRead,
+            number < atomic_load(&batch->readCount) || atomic_load(&batch->readEnded));
+        if (number >= atomic_load(&batch->readCount)) {
+            return NULL;
+        }
+
+        batch_processGrid(batch, self, number);
+    }
+}
+
+void batch_processGrid(tBatch *batch, tWorker *worker, unsigned long number) {
+    size_t const cellCount = (size_t)grid_size(worker->solver.grid) * grid_size(worker->solver.grid);
+    size_t const slot = number % batch->slotCount;
+
+    // The slot is ours until its status is set
+    int const status = grid_loadSudValues(&worker->solver.grid, batch->slotInputs[slot]);
+    stats_reset(worker->solver.grid.stats);
+    if (status == 0 && batch->options.checkUniqueness) {
+        batch->slotSolutionCounts[slot] = solver_countSolutions(&worker->solver, SOLVER_UNIQUENESS_LIMIT);
+    } else if (status == 0) {
+        tCache *cache = batch->options.cache;
+        if (batch->options.solve
+            && (cache == NULL || !cache_lookup(cache, &worker->solver.grid, &worker->cacheKey))) {
+            solver_solve(&worker->solver);
+            if (cache != NULL) {
+                cache_store(cache, &worker->solver.grid, &worker->cacheKey);
+            }
+        }
+        grid_storeSudValues(&worker->solver.grid, &batch->slots[slot * cellCount]);
+    }
+
+#ifdef SUDONE_STATS
+    if (status == 0 && stats_enabled) {
+        stats_print(&worker->solver.grid.stats, number + 1, stderr);
+    }
+#endif
+
+    atomic_store(&batch->slotStatuses[slot], status);
+    batch_notify(&batch->slotDone);
+}
+
+void batch_writeSlots(tBatch *batch, size_t first, size_t count, FILE *outStream) {
+    size_t const cellCount = (size_t)grid_size(batch->output) * grid_size(batch->output);
+
+    if (batch->options.checkUniqueness) {
+        for (size_t i = first; i < first + count; i++) {
+            fprintf(outStream, "%s\n", solver_uniquenessName(batch->slotSolutionCounts[i]));
+        }
+    } else if (batch->options.packed) {
+        for (size_t i = first; i < first + count; i++) {
+            size_t const size = packed_encode(&batch->slots[i * cellCount], batch->output.N,
+                batch->options.packedFlags, batch->packedBuffer);
+            fwrite(batch->packedBuffer, 1, size, outStream);
+        }
+    } else if (batch->options.binary) {
+        // The slots are contiguous: write the run in a single call
+        fwrite(&batch->slots[first * cellCount], sizeof *batch->slots, count * cellCount, outStream);
+    } else {
+        for (size_t i = first; i < first + count; i++) {
+            grid_loadSudValues(&batch->output, &batch->slots[i * cellCount]);
+            grid_print(&batch->output, outStream);
+        }
+    }
+}
@@ -0,0 +1,403 @@
+/** @file
+ * @brief Sudone benchmark
+ * @author 5cover, Matteo-K
+ *
+ * Times the solving engines in-process on the sample grids, found in the N*
+ * subdirectories of a directory, which give the grid size factor.
+ *
+ * Each grid is solved a few times to warm up the caches and the branch
+ * predictors, then timed over many iterations. An iteration loads the grid
+ * from memory and solves it. The latencies of all the grids of a size are
+ * reported together, per engine, as text or as JSON lines to compare versions.
+ */
+
+#include <ctype.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memdbg.c"
+#include "solver.c"
+
+/// @brief Integer: default number of timed iterations per grid.
+#define BENCH_DEFAULT_ITERATIONS 200
+
+/// @brief Integer: default number of warm-up iterations per grid.
+#define BENCH_DEFAULT_WARMUP 20
+
+/// @brief An engine configuration to benchmark.
+typedef struct {
+    /// @brief Name of the configuration in the report.
+    char const *name;
+    /// @brief Engine of the solver.
+    tEngine engine;
+    /// @brief Whether the solver propagates singletons while backtracking.
+    bool propagate;
+} tBenchEngine;
+
+/// @brief The benchmarked engine configurations.
+static tBenchEngine const gs_engines[] = {
+    { .name = "techniques", .engine = ENGINE_TECHNIQUES, .propagate = false },
+    { .name = "techniques-p", .engine = ENGINE_TECHNIQUES, .propagate = true },
+    { .name = "dlx", .engine = ENGINE_DLX, .propagate = false },
+    { .name = "fixed", .engine = ENGINE_FIXED, .propagate = false },
+};
+
+/// @brief The sample grids of a size.
+typedef struct {
+    /// @brief Grid size factor.
+    tIntN N;
+    /// @brief Number of grids.
+    size_t count;
+    /// @brief Sud values of the grids.
+    /// @remark Dimensions: [gridIndex][cellIndex]
+    uint32_t *values;
+} tBenchSet;
+
+/// @brief Latency statistics of an engine on a set.
+typedef struct {
+    double min, median, p99;
+    /// @brief Number of solves per second of run time.
+    double gridsPerSecond;
+    /// @brief Number of grids that couldn't be solved.
+    size_t failures;
+} tBenchStats;
+
+static tSolver gs_solver; // Automatically zero-initialized
+static tBenchSet gs_sets[MAX_N + 1]; // Indexed by grid size factor, automatically zero-initialized
+
+void perform_emergencyMemoryCleanup(void) {
+    solver_free(&gs_solver);
+    for (int N = 1; N <= MAX_N; N++) {
+        free(gs_sets[N].values);
+        gs_sets[N] = (tBenchSet) { 0 };
+    }
+}
+
+/// @brief Gets the current time of the monotonic clock, in seconds.
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/// @brief Compares two doubles for qsort.
+static int compareDoubles(void const *a, void const *b) {
+    double const x = *(double const *)a, y = *(double const *)b;
+    return (x > y) - (x < y);
+}
+
+/// @brief Parses an iteration count argument.
+/// @param arg in: the argument: an integer
+/// @param minCount in: the minimum count
+/// @param count out: the count
+/// @return Whether the argument is valid.
+static bool parse_count(char const *arg, long minCount, long *count) {
+    char *end;
+    *count = strtol(arg, &end, 10);
+    return *arg != '\0' && *end == '\0' && *count >= minCount;
+}
+
+/// @brief Reads the grids of a text file: a character per cell, row by row,
+/// the digit of the value or '.' for an empty cell. Whitespace is skipped.
+/// @param text in: the contents of the file
+/// @param length in: the length of @p text
+/// @param N in: grid size factor. At most 3, as the values are single digits.
+/// @param values out: assigned to the Sud values of the grids. Must have room
+/// for @p length values.
+/// @return The number of grids read, or 0 if the text isn't made of whole
+/// grids.
+static size_t bench_readText(char const *text, size_t length, int N, uint32_t *values) {
+    size_t const cellCount = (size_t)(N * N) * (N * N);
+    size_t valueCount = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '.') {
+            values[valueCount++] = 0;
+        } else if (text[i] >= '0' && text[i] - '0' <= N * N) {
+            values[valueCount++] = text[i] - '0';
+        } else if (!isspace((unsigned char)text[i])) {
+            return 0;
+        }
+    }
+
+    return valueCount % cellCount == 0 ? valueCount / cellCount : 0;
+}
+
+/// @brief Loads the grids of a file into the set of their size.
+/// @param path in: the path of the file, in a directory named N followed by the
+/// grid size factor. A Sud file, or a text file (.txt) for N=3 at most.
+/// @return Whether the file could be loaded.
+static bool bench_loadFile(char const *path) {
+    char const *slash = strrchr(path, '/');
+    char const *dirName = slash;
+    while (dirName > path && dirName[-1] != '/') {
+        dirName--;
+    }
+
+    int N;
+    if (slash == NULL || sscanf(dirName, "N%d/", &N) != 1 || N <= 0 || N > MAX_N) {
+        fprintf(stderr, PROGRAM_NAME " bench: %s: no grid size in the directory name\n", path);
+        return false;
+    }
+
+    size_t const length = strlen(path);
+    bool const isText = length >= 4 && strcmp(path + length - 4, ".txt") == 0;
+    if (isText && N > 3) {
+        fprintf(stderr, PROGRAM_NAME " bench: %s: text grids are only supported up to N=3\n", path);
+        return false;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    long fileBytes = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        fileBytes = ftell(file);
+        rewind(file);
+    }
+    if (fileBytes <= 0) {
+        fprintf(stderr, PROGRAM_NAME " bench: %s: no grids\n", path);
+        fclose(file);
+        return false;
+    }
+
+    char *contents = check_alloc(malloc(fileBytes), "bench file contents");
+    bool const read = fread(contents, 1, fileBytes, file) == (size_t)fileBytes;
+    fclose(file);
+    if (!read) {
+        perror(path);
+        free(contents);
+        return false;
+    }
+
+    // Append the grids of the file to the set
+    size_t const gridBytes = sizeof(uint32_t) * (N * N) * (N * N);
+    tBenchSet *set = &gs_sets[N];
+    // A text file has at most a value per byte
+    size_t const fileValuesBytes = isText ? sizeof(uint32_t) * fileBytes : (size_t)fileBytes;
+    uint32_t *values = check_alloc(malloc(gridBytes * set->count + fileValuesBytes), "bench set values array");
+    if (set->count > 0) {
+        memcpy(values, set->values, gridBytes * set->count);
+    }
+    uint32_t *fileValues = values + gridBytes / sizeof(uint32_t) * set->count;
+
+    size_t fileGridCount;
+    if (isText) {
+        fileGridCount = bench_readText(contents, fileBytes, N, fileValues);
+    } else {
+        fileGridCount = fileBytes % gridBytes == 0 ? fileBytes / gridBytes : 0;
+        memcpy(fileValues, contents, fileGridCount * gridBytes);
+    }
+    free(contents);
+    free(set->values);
+    set->values = values;
+    set->N = N;
+    set->count += fileGridCount;
+
+    if (fileGridCount == 0) {
+        fprintf(stderr, PROGRAM_NAME " bench: %s: not a stream of %s grids of size N=%d\n", path,
+            isText ? "text" : "Sud", N);
+    }
+    return fileGridCount > 0;
+}
+
+/// @brief Times an engine on the grids of a set.
+/// @param set in: the set
+/// @param engine in: the engine configuration
+/// @param warmup in: the number of untimed solves per grid
+/// @param iterations in: the number of timed solves per grid
+/// @param latencies out: room for the latency of each timed solve, in seconds
+/// @return The latency statistics.
+static tBenchStats bench_run(tBenchSet const *set, tBenchEngine engine,
+    long warmup, long iterations, double *latencies) {
+    size_t const cellCount = (size_t)(set->N * set->N) * (set->N * set->N);
+    size_t const sampleCount = set->count * iterations;
+    tBenchStats stats = { .failures = 0 };
+    double total = 0;
+
+    gs_solver = solver_create(set->N, engine.engine, engine.propagate);
+
+    for (size_t g = 0; g < set->count; g++) {
+        uint32_t const *values = &set->values[g * cellCount];
+        bool solved = true;
+
+        for (long i = 0; i < warmup; i++) {
+            grid_loadSudValues(&gs_solver.grid, values);
+            solved &= solver_solve(&gs_solver);
+        }
+
+        for (long i = 0; i < iterations; i++) {
+            double const start = monotonicSeconds();
+            grid_loadSudValues(&gs_solver.grid, values);
+            solved &= solver_solve(&gs_solver);
+            double const latency = monotonicSeconds() - start;
+
+            latencies[g * iterations + i] = latency;
+            total += latency;
+        }
+
+        stats.failures += !solved;
+    }
+
+    solver_free(&gs_solver);
+    gs_solver = (tSolver) { 0 };
+
+    // Nearest-rank percentiles
+    qsort(latencies, sampleCount, sizeof *latencies, compareDoubles);
+    stats.min = latencies[0];
+    stats.median = latencies[(sampleCount - 1) / 2];
+    stats.p99 = latencies[(sampleCount * 99 + 99) / 100 - 1];
+    stats.gridsPerSecond = total > 0 ? sampleCount / total : 0;
+
+    return stats;
+}
+
+static void print_help(void) {
+    puts("Sudone benchmark - times the solving engines on sample grids");
+    puts("The grids are the Sud files and the text files (.txt, up to N=3) of the "
+         "N* subdirectories of DIR (default: sample_grids), where N* gives the "
+         "grid size factor. A text file has a character per cell, row by row: "
+         "the digit of the value, or '.' for an empty cell.");
+    puts("");
+    puts("Usage: bench_" PROGRAM_NAME " [DIR]");
+    puts("");
+    puts("Options:");
+    puts("");
+    puts("-n ITERATIONS, --iterations=ITERATIONS");
+    puts("\t number of timed solves per grid");
+    puts("-w WARMUP, --warmup=WARMUP");
+    puts("\t number of untimed solves per grid before timing");
+    puts("--json\t print one JSON object per line instead of a table");
+    puts("--help\t print this help and exit");
+}
+
+int main(int argc, char **argv) {
+    long opt_iterations = BENCH_DEFAULT_ITERATIONS, opt_warmup = BENCH_DEFAULT_WARMUP;
+    bool opt_json = false;
+
+    // Parse command-line options
+    {
+        struct option longOptions[] = {
+            (struct option) { .name = "help", .has_arg = 0, .flag = NULL, .val = 'h' },
+            (struct option) { .name = "iterations", .has_arg = 1, .flag = NULL, .val = 'n' },
+            (struct option) { .name = "warmup", .has_arg = 1, .flag = NULL, .val = 'w' },
+            (struct option) { .name = "json", .has_arg = 0, .flag = NULL, .val = 'J' },
+            { 0 }
+        };
+
+        int opt;
+        while ((opt = getopt_long(argc, argv, "n:w:", longOptions, NULL)) != -1) {
+            switch (opt) {
+            case 'n':
+                if (!parse_count(optarg, 1, &opt_iterations)) {
+                    fprintf(stderr, PROGRAM_NAME " bench: invalid number of iterations: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            case 'w':
+                if (!parse_count(optarg, 0, &opt_warmup)) {
+                    fprintf(stderr, PROGRAM_NAME " bench: invalid number of warm-up iterations: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            case 'J':
+                opt_json = true;
+                break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            case '?':
+                return EXIT_INVALID_ARG;
+            default:
+                abort();
+            }
+        }
+    }
+
+    // Load the sample grids
+
+    char const *dir = optind < argc ? argv[optind] : "sample_grids";
+    char *pattern = check_alloc(malloc(strlen(dir) + sizeof "/N*/*.sud"), "bench glob pattern");
+    glob_t paths;
+    strcpy(pattern, dir);
+    strcat(pattern, "/N*/*.sud");
+    int const sudResult = glob(pattern, 0, NULL, &paths);
+    strcpy(pattern, dir);
+    strcat(pattern, "/N*/*.txt");
+    int const textResult = glob(pattern, sudResult == 0 ? GLOB_APPEND : 0, NULL, &paths);
+    free(pattern);
+    if (sudResult != 0 && textResult != 0) {
+        fprintf(stderr, PROGRAM_NAME " bench: %s: no sample grids\n", dir);
+        return EXIT_INVALID_ARG;
+    }
+
+    bool loaded = true;
+    for (size_t p = 0; p < paths.gl_pathc && loaded; p++) {
+        loaded = bench_loadFile(paths.gl_pathv[p]);
+    }
+    globfree(&paths);
+    if (!loaded) {
+        perform_emergencyMemoryCleanup();
+        return EXIT_INVALID_DATA;
+    }
+
+    // Time every engine on every size
+
+    if (!opt_json) {
+        printf("%-4s %-14s %6s %12s %12s %12s %12s\n",
+            "N", "engine", "grids", "min (us)", "median (us)", "p99 (us)", "grids/s");
+    }
+
+    size_t failures = 0;
+    for (int N = 1; N <= MAX_N; N++) {
+        tBenchSet const *set = &gs_sets[N];
+        if (set->count == 0) {
+            continue;
+        }
+        double *latencies = check_alloc(array_malloc(latencies, set->count * opt_iterations), "bench latencies array");
+
+        for (size_t e = 0; e < sizeof gs_engines / sizeof *gs_engines; e++) {
+            // Other sizes would benchmark the techniques engine twice
+            if (gs_engines[e].engine == ENGINE_FIXED && !fixed_isSpecialized(set->N)) {
+                continue;
+            }
+
+            tBenchStats const stats = bench_run(set, gs_engines[e], opt_warmup, opt_iterations, latencies);
+            failures += stats.failures;
+
+            if (opt_json) {
+                printf("{\"n\":%d,\"engine\":\"%s\",\"grids\":%zu,\"iterations\":%ld,"
+                       "\"min_us\":%.3f,\"median_us\":%.3f,\"p99_us\":%.3f,"
+                       "\"grids_per_s\":%.1f,\"failures\":%zu}\n",
+                    set->N, gs_engines[e].name, set->count, opt_iterations,
+                    stats.min * 1e6, stats.median * 1e6, stats.p99 * 1e6,
+                    stats.gridsPerSecond, stats.failures);
+            } else {
+                printf("%-4d %-14s %6zu %12.3f %12.3f %12.3f %12.1f\n",
+                    set->N, gs_engines[e].name, set->count,
+                    stats.min * 1e6, stats.median * 1e6, stats.p99 * 1e6, stats.gridsPerSecond);
+            }
+            fflush(stdout);
+        }
+
+        free(latencies);
+    }
+
+    perform_emergencyMemoryCleanup();
+
+    if (failures > 0) {
+        fprintf(stderr, PROGRAM_NAME " bench: %zu grids could not be solved\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+/** @file
+ * @brief Packed bitset functions
+ * @author 5cover, Matteo-K
+ *
+ * The occurrence counting kernel is vectorized with AVX2 or NEON when the
+ * target supports them (e.g. with <tt>make cf=-march=native</tt>), and falls
+ * back to scalar code otherwise.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/// @brief Word type of a packed bitset.
+typedef uint64_t tBitWord;
+
+/// @brief Integer: number of bits in a @ref tBitWord.
+#define BITWORD_BITS 64
+
+// Using macros to maximize the performance of these simple functions called
+// very frequently in the program.
+
+#ifdef __GNUC__
+
+/// @brief Counts the set bits of a word.
+#define bitword_count(word) ((unsigned)__builtin_popcountll(word))
+
+/// @brief Gets the index of the lowest set bit of a nonzero word.
+#define bitword_first(word) ((unsigned)__builtin_ctzll(word))
+
+#else
+
+static inline unsigned bitword_count(tBitWord word) {
+    unsigned count = 0;
+    for (; word != 0; word &= word - 1) {
+        count++;
+    }
+    return count;
+}
+
+static inline unsigned bitword_first(tBitWord word) {
+    unsigned index = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+}
+
+#endif // __GNUC__
+
+/// @brief Gets the number of words needed to store a bitset.
+/// @param bitCount in: the number of bits of the bitset
+#define bitset_wordCount(bitCount) (((bitCount) + BITWORD_BITS - 1) / BITWORD_BITS)
+
+/// @brief Gets the mask of a bit inside its word.
+#define bitset_mask(bit) ((tBitWord)1 << ((bit) % BITWORD_BITS))
+
+/// @brief Determines whether a bit is set.
+#define bitset_has(words, bit) (((words)[(bit) / BITWORD_BITS] & bitset_mask(bit)) != 0)
+
+/// @brief Sets a bit.
+#define bitset_add(words, bit) ((words)[(bit) / BITWORD_BITS] |= bitset_mask(bit))
+
+/// @brief Clears a bit.
+#define bitset_remove(words, bit) ((words)[(bit) / BITWORD_BITS] &= ~bitset_mask(bit))
+
+/// @brief Counts the set bits of a bitset.
+/// @param words in: the bitset
+/// @param wordCount in: the number of words of @p words
+/// @return The number of set bits in @p words.
+unsigned bitset_count(tBitWord const *words, size_t wordCount);
+
+/// @brief Gets the index of the lowest set bit of a bitset.
+/// @param words in: the bitset. Must have at least one set bit.
+/// @return The index of the first set bit of @p words.
+size_t bitset_first(tBitWord const *words);
+
+/// @brief Gets the index of the nth set bit of a bitset.
+/// @param words in: the bitset. Must have at least @p n set bits.
+/// @param n in: the one-based index of the set bit to find
+/// @return The index of the nth set bit of @p words.
+size_t bitset_nth(tBitWord const *words, size_t n);
+
+/// @brief Gets the index of the next set bit strictly after a bit.
+/// @param words in: the bitset
+/// @param wordCount in: the number of words of @p words
+/// @param bit in: the bit to search after
+/// @return The index of the first set bit after @p bit, or
+/// <tt>wordCount * BITWORD_BITS</tt> if there is none.
+size_t bitset_next(tBitWord const *words, size_t wordCount, size_t bit);
+
+/// @brief Counts the occurrences of each bit in a list of words, saturating at
+/// three.
+/// @param words in: the words
+/// @param indexes in: the indexes of the words of the list in @p words, in
+/// units of @p stride
+/// @param stride in: the scale of the indexes, in words
+/// @param count in: the number of words of the list
+/// @param once in/out: accumulates the bits set in at least one word
+/// @param twice in/out: accumulates the bits set in at least two words
+/// @param thrice in/out: accumulates the bits set in at least three words
+/// @remark The bits set exactly once are <tt>once & ~twice</tt>, and exactly
+/// twice <tt>twice & ~thrice</tt>.
+void bitword_countOccurrences(tBitWord const *words, uint_least32_t const *indexes,
+    size_t stride, size_t count, tBitWord *once, tBitWord *twice, tBitWord *thrice);
+
+/////////////////////////////////////////////////////////////////////////
+
+unsigned bitset_count(tBitWord const *words, size_t wordCount) {
+    unsigned count = 0;
+    for (size_t w = 0; w < wordCount; w++) {
+        count += bitword_count(words[w]);
+    }
+    return count;
+}
+
+size_t bitset_first(tBitWord const *words) {
+    size_t w = 0;
+    while (words[w] == 0) {
+        w++;
+    }
+    return w * BITWORD_BITS + bitword_first(words[w]);
+}
+
+size_t bitset_nth(tBitWord const *words, size_t n) {
+    assert(n > 0);
+
+    size_t w = 0;
+    unsigned count;
+    // Skip whole words while they hold less than n bits
+    while ((count = bitword_count(words[w])) < n) {
+        n -= count;
+        w++;
+    }
+
+    tBitWord word = words[w];
+    // Drop the n - 1 lowest set bits of the word
+    while (--n > 0) {
+        word &= word - 1;
+    }
+
+    return w * BITWORD_BITS + bitword_first(word);
+}
+
+size_t bitset_next(tBitWord const *words, size_t wordCount, size_t bit) {
+    size_t w = ++bit / BITWORD_BITS;
+    if (w >= wordCount) {
+        return wordCount * BITWORD_BITS;
+    }
+
+    // Mask out the bits before the starting bit in its word
+    tBitWord word = words[w] & (~(tBitWord)0 << (bit % BITWORD_BITS));
+
+    while (word == 0) {
+        if (++w == wordCount) {
+            return wordCount * BITWORD_BITS;
+        }
+        word = words[w];
+    }
+
+    return w * BITWORD_BITS + bitword_first(word);
+}
+
+void bitword_countOccurrences(tBitWord const *words, uint_least32_t const *indexes,
+    size_t stride, size_t count, tBitWord *once, tBitWord *twice, tBitWord *thrice) {
+    tBitWord o = *once, tw = *twice, th = *thrice;
+    size_t i = 0;
+
+#if defined(__AVX2__) || defined(__ARM_NEON)
+#if defined(__AVX2__)
+#define LANES 4
+    if (count >= LANES) {
+        __m256i vo = _mm256_setzero_si256(), vtw = vo, vth = vo;
+        __m128i const scale = _mm_set1_epi32(stride);
+        for (; i + LANES <= count; i += LANES) {
+            __m128i offsets = _mm_loadu_si128((__m128i const *)&indexes[i]);
+            if (stride != 1) {
+                offsets = _mm_mullo_epi32(offsets, scale);
+            }
+            __m256i const v = _mm256_i32gather_epi64((long long const *)words, offsets, sizeof *words);
+            vth = _mm256_or_si256(vth, _mm256_and_si256(vtw, v));
+            vtw = _mm256_or_si256(vtw, _mm256_and_si256(vo, v));
+            vo = _mm256_or_si256(vo, v);
+        }
+        tBitWord lo[LANES], ltw[LANES], lth[LANES];
+        _mm256_storeu_si256((__m256i *)lo, vo);
+        _mm256_storeu_si256((__m256i *)ltw, vtw);
+        _mm256_storeu_si256((__m256i *)lth, vth);
+#else
+#define LANES 2
+    if (count >= LANES) {
+        uint64x2_t vo = vdupq_n_u64(0), vtw = vo, vth = vo;
+        for (; i + LANES <= count; i += LANES) {
+            // NEON has no gather: the lanes are loaded one by one
+            uint64x2_t const v = vcombine_u64(vld1_u64(&words[indexes[i] * stride]),
+                vld1_u64(&words[indexes[i + 1] * stride]));
+            vth = vorrq_u64(vth, vandq_u64(vtw, v));
+            vtw = vorrq_u64(vtw, vandq_u64(vo, v));
+            vo = vorrq_u64(vo, v);
+        }
+        tBitWord lo[LANES], ltw[LANES], lth[LANES];
+        vst1q_u64(lo, vo);
+        vst1q_u64(ltw, vtw);
+        vst1q_u64(lth, vth);
+#endif
+        // Merge the counts of the lanes
+        for (unsigned l = 0; l < LANES; l++) {
+            th |= lth[l] | (tw & lo[l]) | (o & ltw[l]);
+            tw |= ltw[l] | (o & lo[l]);
+            o |= lo[l];
+        }
+    }
+#undef LANES
+#endif // __AVX2__ || __ARM_NEON
+
+    for (; i < count; i++) {
+        tBitWord const word = words[indexes[i] * stride];
+        th |= tw & word;
+        tw |= o & word;
+        o |= word;
+    }
+
+    *once = o;
+    *twice = tw;
+    *thrice = th;
+}
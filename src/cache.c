@@ -0,0 +1,896 @@
+/** @file
+ * @brief Solution cache
+ * @author 5cover, Matteo-K
+ *
+ * Caches the solutions of the grids solved, keyed by the canonical form of their
+ * clues, so that a grid solved before, or an equivalent one, is not solved
+ * again.
+ *
+ * Two grids are equivalent when one is the other with its digits relabelled,
+ * its bands, its stacks, the rows of a band or the columns of a stack permuted,
+ * or transposed. Such grids have the same solutions up to the same transform.
+ *
+ * The canonical form of a grid is the smallest of its transforms, in row-major
+ * order, among those that sort the bands, stacks, rows and columns by keys that
+ * don't depend on the transform: the numbers of clues of the lines and of the
+ * lines they cross. The digits are relabelled in order of first appearance.
+ * The transforms are tried for every order of the lines with equal keys. When
+ * there are too many of them, a single transform is used: equivalent grids may
+ * then miss each other, but the cache stays correct, as entries are compared by
+ * their whole canonical form.
+ *
+ * The cache holds a bounded number of entries and evicts the least recently
+ * used. It is protected by a mutex, so it can be shared by threads. It can be
+ * saved to and loaded from a snapshot file.
+ */
+
+#pragma once
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "types.c"
+
+/// @brief Integer: end of a list of cache entries.
+#define CACHE_NIL SIZE_MAX
+
+/// @brief Integer: largest number of transforms tried to find the canonical
+/// form of a grid.
+#define CACHE_MAX_TRANSFORMS 4096
+
+/// @brief Integer: default number of entries of a cache.
+#define CACHE_DEFAULT_CAPACITY 65536
+
+/// @brief Integer: magic number of a cache snapshot file ("SUDC").
+#define CACHE_SNAPSHOT_MAGIC 0x43445553
+/// @brief Integer: version of the cache snapshot format.
+#define CACHE_SNAPSHOT_VERSION 1
+
+/// @brief An entry of a cache.
+typedef struct {
+    /// @brief Hash of @ref values.
+    uint64_t hash;
+    /// @brief Canonical form of the clues, then the canonical solution.
+    /// @remark Dimensions: [2][cellIndex]
+    uint32_t *values;
+    /// @brief More and less recently used entries, or @ref CACHE_NIL.
+    size_t prev, next;
+    /// @brief Next entry of the hash bucket, or @ref CACHE_NIL.
+    size_t chainNext;
+} tCacheEntry;
+
+/// @brief A cache of solutions of grids of a size.
+typedef struct {
+    /// @brief Grid size factor.
+    tIntN N;
+    /// @brief Maximum number of entries.
+    size_t capacity;
+    /// @brief Number of entries.
+    size_t count;
+    /// @brief Entries. Their values are allocated on first use.
+    /// @remark Dimensions: [entryIndex]
+    tCacheEntry *entries;
+    /// @brief First entry of each hash bucket, or @ref CACHE_NIL.
+    /// @remark Dimensions: [hash & bucketMask]
+    size_t *buckets;
+    size_t bucketMask;
+    /// @brief Most and least recently used entries, or @ref CACHE_NIL.
+    size_t mru, lru;
+    /// @brief Number of lookups that found an entry, and that didn't.
+    unsigned long hits, misses;
+    /// @brief Protects all of the above.
+    pthread_mutex_t lock;
+} tCache;
+
+/// @brief The order of the lines of an axis (rows or columns) of a transform.
+typedef struct {
+    /// @brief Key of each line.
+    /// @remark Dimensions: [line]
+    uint64_t *lineKeys;
+    /// @brief Key of each band (or stack).
+    /// @remark Dimensions: [band]
+    uint64_t *bandKeys;
+    /// @brief Band at each band position.
+    /// @remark Dimensions: [bandPosition]
+    tIntSize *bandOrder;
+    /// @brief Line at each line position of each band.
+    /// @remark Dimensions: [band][linePosition]
+    tIntSize *lineOrder;
+    /// @brief Line at each position of the axis, from @ref bandOrder and @ref
+    /// lineOrder.
+    /// @remark Dimensions: [position]
+    tIntSize *map;
+} tCacheAxis;
+
+/// @brief The canonical form of a grid and the transform that gives it.
+/// @remark Also holds the scratch state of the canonicalization, so that it is
+/// allocated once per thread.
+typedef struct {
+    /// @brief Grid size factor.
+    tIntN N;
+    /// @brief Whether the grid is transposed.
+    bool transposed;
+    /// @brief Original row and column of each canonical row and column (or
+    /// column and row if transposed).
+    /// @remark Dimensions: [position]
+    tIntSize *rows, *columns;
+    /// @brief Canonical label of each original digit, 0 for 0.
+    /// @remark Dimensions: [value] (SIZE + 1)
+    tIntSize *labels;
+    /// @brief The canonical form.
+    /// @remark Dimensions: [cellIndex]
+    uint32_t *values;
+    /// @brief Hash of @ref values.
+    uint64_t hash;
+
+    /// @brief Values of the grid, the transform being tried, and a buffer.
+    uint32_t *gridValues, *candidate, *buffer;
+    tIntSize *candidateLabels;
+    tCacheAxis rowAxis, columnAxis;
+} tCacheKey;
+
+/// @brief Creates a cache.
+/// @param N in: grid size factor
+/// @param capacity in: maximum number of entries. At least 1.
+/// @return A new cache. Must be freed with @ref cache_free.
+tCache cache_create(tIntN N, size_t capacity);
+
+/// @brief Frees a cache.
+/// @param cache in/out: the cache to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created cache.
+void cache_free(tCache *cache);
+
+/// @brief Creates a cache key for grids of a size.
+/// @param N in: grid size factor
+/// @return A new key. Must be freed with @ref cache_freeKey.
+tCacheKey cache_createKey(tIntN N);
+
+/// @brief Frees a cache key.
+/// @param key in/out: the key to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created key.
+void cache_freeKey(tCacheKey *key);
+
+/// @brief Looks up the solution of a grid.
+/// @param cache in/out: the cache
+/// @param grid in/out: the grid. Loaded with its solution on a hit.
+/// @param key out: assigned to the canonical form of the grid, to be passed to
+/// @ref cache_store on a miss
+/// @return Whether the solution was found.
+bool cache_lookup(tCache *cache, tGrid *grid, tCacheKey *key);
+
+/// @brief Stores the solution of a grid.
+/// @param cache in/out: the cache
+/// @param grid in: the solved grid
+/// @param key in: the canonical form of the grid before solving, from @ref
+/// cache_lookup
+/// @remark Nothing is stored if the grid isn't solved, as the engines may fail
+/// on grids without solutions.
+void cache_store(tCache *cache, tGrid const *grid, tCacheKey const *key);
+
+/// @brief Loads the entries of a snapshot file for the size of a cache.
+/// @param cache in/out: the cache
+/// @param path in: the path of the snapshot
+/// @return Whether the snapshot could be loaded. A missing file is an empty
+/// snapshot. If not, the error has been reported.
+/// @remark A snapshot with an entry that isn't valid (see @ref
+/// cache_isValidEntry) is rejected.
+bool cache_loadSnapshot(tCache *cache, char const *path);
+
+/// @brief Saves the entries of caches to a snapshot file.
+/// @param caches in: the caches, of distinct sizes. Zero-initialized ones are
+/// skipped.
+/// @param count in: the number of caches
+/// @param path in: the path of the snapshot
+/// @return Whether the snapshot could be saved. If not, the error has been
+/// reported.
+/// @remark The file is replaced atomically. The sections of the snapshot it
+/// replaces for the sizes of no cache are kept.
+bool cache_saveSnapshot(tCache *caches, size_t count, char const *path);
+
+/// @brief Copies the sections of a snapshot file for the sizes of no cache.
+/// @param out in/out: the snapshot being written
+/// @param path in: the path of the snapshot to copy from
+/// @param caches in: the caches written. Zero-initialized ones are skipped.
+/// @param count in: the number of caches
+/// @return Whether the sections could be written. A missing, invalid or
+/// truncated snapshot has no sections, or none from the first truncated one.
+/// @remark Used in @ref cache_saveSnapshot.
+bool cache_copyOtherSections(FILE *out, char const *path, tCache const *caches, size_t count);
+
+/// @brief Determines whether a cache entry is valid: its values are at most
+/// SIZE, its solution is a solved grid and each of its clues is the value of
+/// the solution on its cell.
+/// @param N in: grid size factor
+/// @param values in: the canonical form, then the canonical solution
+/// @param seen in/out: scratch of SIZE + 1 booleans
+/// @return Whether the entry is valid.
+/// @remark Used in @ref cache_loadSnapshot.
+bool cache_isValidEntry(tIntN N, uint32_t const *values, bool *seen);
+
+/// @brief Computes the canonical form of a grid.
+/// @param key in/out: the key. Assigned to the canonical form.
+/// @param grid in: the grid
+/// @remark Used in @ref cache_lookup.
+void cache_canonicalize(tCacheKey *key, tGrid const *grid);
+
+/// @brief Inserts an entry in a cache, evicting the least recently used one if
+/// the cache is full.
+/// @param cache in/out: the cache. Must be locked.
+/// @param hash in: the hash of the canonical form
+/// @param values in: the canonical form, then the canonical solution
+/// @remark Used in @ref cache_store and @ref cache_loadSnapshot.
+void cache_insert(tCache *cache, uint64_t hash, uint32_t const *values);
+
+/////////////////////////////////////////////////////////////////////////
+
+/// @brief Gets the size of the entries of a snapshot section.
+/// @param N in: the grid size factor of the section
+/// @param count in: the number of entries of the section
+/// @return The number of bytes of the entries.
+#define cache_sectionBytes(N, count) \
+    ((long)(count) * 2 * (long)sizeof(uint32_t) * (N) * (N) * (N) * (N))
+
+/// @brief Mixes the bits of an integer (splitmix64 finalizer).
+#define cache_mix(x)                                          \
+    __extension__({                                           \
+        uint64_t _z = (x) + 0x9e3779b97f4a7c15u;              \
+        _z = (_z ^ (_z >> 30)) * 0xbf58476d1ce4e5b9u;         \
+        _z = (_z ^ (_z >> 27)) * 0x94d049bb133111ebu;         \
+        _z ^ (_z >> 31);                                      \
+    })
+
+/// @brief Unlinks an entry from the recency list of a cache.
+#define cache_unlinkRecency(cache, e)                                  \
+    do {                                                               \
+        tCacheEntry *_entry = &(cache)->entries[e];                    \
+        if (_entry->prev == CACHE_NIL) {                               \
+            (cache)->mru = _entry->next;                               \
+        } else {                                                       \
+            (cache)->entries[_entry->prev].next = _entry->next;        \
+        }                                                              \
+        if (_entry->next == CACHE_NIL) {                               \
+            (cache)->lru = _entry->prev;                               \
+        } else {                                                       \
+            (cache)->entries[_entry->next].prev = _entry->prev;        \
+        }                                                              \
+    } while (0)
+
+/// @brief Links an entry as the most recently used of a cache.
+#define cache_linkRecency(cache, e)                          \
+    do {                                                     \
+        tCacheEntry *_entry = &(cache)->entries[e];          \
+        _entry->prev = CACHE_NIL;                            \
+        _entry->next = (cache)->mru;                         \
+        if ((cache)->mru == CACHE_NIL) {                     \
+            (cache)->lru = (e);                              \
+        } else {                                             \
+            (cache)->entries[(cache)->mru].prev = (e);       \
+        }                                                    \
+        (cache)->mru = (e);                                  \
+    } while (0)
+
+tCache cache_create(tIntN N, size_t capacity) {
+    // At least twice as many buckets as entries, as a power of 2
+    size_t bucketCount = 1;
+    while (bucketCount < 2 * capacity) {
+        bucketCount *= 2;
+    }
+
+    tCache cache = {
+        .N = N,
+        .capacity = capacity,
+        .count = 0,
+        .bucketMask = bucketCount - 1,
+        .mru = CACHE_NIL,
+        .lru = CACHE_NIL,
+        .hits = 0,
+        .misses = 0,
+    };
+    cache.entries = check_alloc(array_malloc(cache.entries, capacity), "cache entries array");
+    cache.buckets = check_alloc(array_malloc(cache.buckets, bucketCount), "cache buckets array");
+    for (size_t b = 0; b < bucketCount; b++) {
+        cache.buckets[b] = CACHE_NIL;
+    }
+    pthread_mutex_init(&cache.lock, NULL);
+
+    return cache;
+}
+
+void cache_free(tCache *cache) {
+    if (cache->entries == NULL) {
+        return;
+    }
+    for (size_t e = 0; e < cache->count; e++) {
+        free(cache->entries[e].values);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    pthread_mutex_destroy(&cache->lock);
+    *cache = (tCache) { 0 };
+}
+
+/// @brief Allocates the arrays of an axis of a key.
+#define cache_allocAxis(axis, N)                                                                                    \
+    do {                                                                                                            \
+        (axis).lineKeys = check_alloc(array_malloc((axis).lineKeys, (N) * (N)), "cache key line keys array");      \
+        (axis).bandKeys = check_alloc(array_malloc((axis).bandKeys, (N)), "cache key band keys array");            \
+        (axis).bandOrder = check_alloc(array_malloc((axis).bandOrder, (N)), "cache key band order array");         \
+        (axis).lineOrder = check_alloc(array_malloc((axis).lineOrder, (N) * (N)), "cache key line order array");   \
+        (axis).map = check_alloc(array_malloc((axis).map, (N) * (N)), "cache key axis map array");                 \
+    } while (0)
+
+/// @brief Frees the arrays of an axis of a key.
+#define cache_freeAxis(axis)      \
+    do {                          \
+        free((axis).lineKeys);    \
+        free((axis).bandKeys);    \
+        free((axis).bandOrder);   \
+        free((axis).lineOrder);   \
+        free((axis).map);         \
+    } while (0)
+
+tCacheKey cache_createKey(tIntN N) {
+    size_t const size = (size_t)N * N, cellCount = size * size;
+    tCacheKey key = { .N = N };
+
+    key.rows = check_alloc(array_malloc(key.rows, size), "cache key rows array");
+    key.columns = check_alloc(array_malloc(key.columns, size), "cache key columns array");
+    key.labels = check_alloc(array_malloc(key.labels, size + 1), "cache key labels array");
+    key.values = check_alloc(array_malloc(key.values, cellCount), "cache key values array");
+    key.gridValues = check_alloc(array_malloc(key.gridValues, cellCount), "cache key grid values array");
+    key.candidate = check_alloc(array_malloc(key.candidate, cellCount), "cache key candidate array");
+    key.buffer = check_alloc(array_malloc(key.buffer, 2 * cellCount), "cache key buffer array");
+    key.candidateLabels = check_alloc(array_malloc(key.candidateLabels, size + 1), "cache key candidate labels array");
+    cache_allocAxis(key.rowAxis, N);
+    cache_allocAxis(key.columnAxis, N);
+
+    return key;
+}
+
+void cache_freeKey(tCacheKey *key) {
+    if (key->rows == NULL) {
+        return;
+    }
+    free(key->rows);
+    free(key->columns);
+    free(key->labels);
+    free(key->values);
+    free(key->gridValues);
+    free(key->candidate);
+    free(key->buffer);
+    free(key->candidateLabels);
+    cache_freeAxis(key->rowAxis);
+    cache_freeAxis(key->columnAxis);
+    *key = (tCacheKey) { 0 };
+}
+
+/// @brief Sorts indexes in ascending order of their keys, then of their
+/// values.
+/// @param indexes in/out: the indexes
+/// @param count in: the number of indexes
+/// @param keys in: the key of each index
+static void cache_sortByKey(tIntSize *indexes, tIntSize count, uint64_t const *keys) {
+    for (tIntSize i = 1; i < count; i++) {
+        tIntSize const index = indexes[i];
+        tIntSize j = i;
+        while (j > 0 && (keys[indexes[j - 1]] > keys[index] || (keys[indexes[j - 1]] == keys[index] && indexes[j - 1] > index))) {
+            indexes[j] = indexes[j - 1];
+            j--;
+        }
+        indexes[j] = index;
+    }
+}
+
+/// @brief Advances indexes with equal keys to their next permutation.
+/// @param indexes in/out: the indexes, sorted by key
+/// @param count in: the number of indexes
+/// @param keys in: the key of each index
+/// @return Whether there is a next permutation. If not, the indexes are back to
+/// their first permutation: in ascending order within equal keys.
+static bool cache_nextTiePermutation(tIntSize *indexes, tIntSize count, uint64_t const *keys) {
+    tIntSize first = 0;
+    while (first < count) {
+        tIntSize end = first + 1;
+        while (end < count && keys[indexes[end]] == keys[indexes[first]]) {
+            end++;
+        }
+
+        // Next lexicographic permutation of [first ; end[, which wraps around
+        tIntSize i = end - 1;
+        while (i > first && indexes[i - 1] > indexes[i]) {
+            i--;
+        }
+        if (i > first) {
+            tIntSize j = end - 1;
+            while (indexes[j] < indexes[i - 1]) {
+                j--;
+            }
+            tIntSize const swap = indexes[i - 1];
+            indexes[i - 1] = indexes[j];
+            indexes[j] = swap;
+        }
+        for (tIntSize a = i, b = end - 1; a < b; a++, b--) {
+            tIntSize const swap = indexes[a];
+            indexes[a] = indexes[b];
+            indexes[b] = swap;
+        }
+        if (i > first) {
+            return true;
+        }
+
+        first = end;
+    }
+    return false;
+}
+
+/// @brief Counts the permutations of indexes with equal keys, up to a limit.
+static size_t cache_tiePermutationCount(tIntSize const *indexes, tIntSize count, uint64_t const *keys, size_t limit) {
+    size_t permutations = 1;
+    for (tIntSize first = 0, end; first < count; first = end) {
+        for (end = first + 1; end < count && keys[indexes[end]] == keys[indexes[first]]; end++) {
+            permutations = min(limit, permutations * (end - first + 1));
+        }
+    }
+    return permutations;
+}
+
+/// @brief Sorts the bands and lines of an axis by key, and counts the orders
+/// of the lines with equal keys.
+/// @return The number of orders, up to @p limit.
+static size_t cache_initAxis(tCacheAxis *axis, tIntN N, size_t limit) {
+    size_t orders = 1;
+
+    for (tIntSize b = 0; b < N; b++) {
+        axis->bandKeys[b] = 0;
+        for (tIntSize i = 0; i < N; i++) {
+            tIntSize const line = b * N + i;
+            // Order independent combination of the keys of the lines
+            axis->bandKeys[b] += cache_mix(axis->lineKeys[line]);
+            axis->lineOrder[line] = line;
+        }
+        cache_sortByKey(&axis->lineOrder[b * N], N, axis->lineKeys);
+        orders = min(limit, orders * cache_tiePermutationCount(&axis->lineOrder[b * N], N, axis->lineKeys, limit));
+        axis->bandOrder[b] = b;
+    }
+    cache_sortByKey(axis->bandOrder, N, axis->bandKeys);
+    orders = min(limit, orders * cache_tiePermutationCount(axis->bandOrder, N, axis->bandKeys, limit));
+
+    return orders;
+}
+
+/// @brief Advances an axis to its next order of the lines with equal keys.
+/// @return Whether there is a next order. If not, the axis is back to its first
+/// order.
+static bool cache_nextAxisOrder(tCacheAxis *axis, tIntN N) {
+    for (tIntSize b = 0; b < N; b++) {
+        if (cache_nextTiePermutation(&axis->lineOrder[b * N], N, axis->lineKeys)) {
+            return true;
+        }
+    }
+    return cache_nextTiePermutation(axis->bandOrder, N, axis->bandKeys);
+}
+
+/// @brief Computes the line at each position of an axis.
+static void cache_mapAxis(tCacheAxis *axis, tIntN N) {
+    for (tIntSize p = 0; p < N * N; p++) {
+        axis->map[p] = axis->lineOrder[axis->bandOrder[p / N] * N + p % N];
+    }
+}
+
+/// @brief Tries the current transform of a key, and keeps it if it gives a
+/// smaller form.
+/// @param key in/out: the key
+/// @param transposed in: whether to transpose the grid
+/// @param hasBest in: whether the key has a form already
+static void cache_tryTransform(tCacheKey *key, bool transposed, bool hasBest) {
+    tIntSize const size = key->N * key->N;
+    tIntSize const *rowMap = key->rowAxis.map, *columnMap = key->columnAxis.map;
+    tIntSize nextLabel = 1;
+    int order = hasBest ? 0 : -1; // the comparison of the candidate to the best
+
+    memset(key->candidateLabels, 0, sizeof *key->candidateLabels * (size + 1));
+
+    for (tIntSize i = 0; i < size; i++) {
+        for (tIntSize j = 0; j < size; j++) {
+            uint32_t const value = transposed
+                ? key->gridValues[at2d(size, rowMap[j], columnMap[i])]
+                : key->gridValues[at2d(size, rowMap[i], columnMap[j])];
+            if (value != 0 && key->candidateLabels[value] == 0) {
+                key->candidateLabels[value] = nextLabel++;
+            }
+            uint32_t const label = key->candidateLabels[value];
+
+            size_t const iCell = at2d(size, i, j);
+            if (order == 0) {
+                if (label > key->values[iCell]) {
+                    return;
+                }
+                order = label < key->values[iCell] ? -1 : 0;
+            }
+            key->candidate[iCell] = label;
+        }
+    }
+
+    if (order < 0) {
+        uint32_t *swap = key->values;
+        key->values = key->candidate;
+        key->candidate = swap;
+        key->transposed = transposed;
+        memcpy(key->rows, rowMap, sizeof *key->rows * size);
+        memcpy(key->columns, columnMap, sizeof *key->columns * size);
+        memcpy(key->labels, key->candidateLabels, sizeof *key->labels * (size + 1));
+    }
+}
+
+void cache_canonicalize(tCacheKey *key, tGrid const *grid) {
+    tIntN const N = key->N;
+    tIntSize const size = N * N;
+    tIntSize *rowCounts = key->rows, *columnCounts = key->columns; // free until the end
+
+    // Clue counts of the lines
+    memset(rowCounts, 0, sizeof *rowCounts * size);
+    memset(columnCounts, 0, sizeof *columnCounts * size);
+    for (tIntSize r = 0; r < size; r++) {
+        for (tIntSize c = 0; c < size; c++) {
+            uint32_t const value = cell_value(grid_cellAt(*grid, r, c));
+            key->gridValues[at2d(size, r, c)] = value;
+            rowCounts[r] += value != 0;
+            columnCounts[c] += value != 0;
+        }
+    }
+
+    // Keys of the lines: their clue count and the clue counts of the lines
+    // crossing them on their clues. Transforms permute them with the lines.
+    for (tIntSize line = 0; line < size; line++) {
+        key->rowAxis.lineKeys[line] = cache_mix(rowCounts[line]);
+        key->columnAxis.lineKeys[line] = cache_mix(columnCounts[line]);
+    }
+    for (tIntSize r = 0; r < size; r++) {
+        for (tIntSize c = 0; c < size; c++) {
+            if (key->gridValues[at2d(size, r, c)] != 0) {
+                key->rowAxis.lineKeys[r] += cache_mix(size + 1 + columnCounts[c]);
+                key->columnAxis.lineKeys[c] += cache_mix(size + 1 + rowCounts[r]);
+            }
+        }
+    }
+
+    size_t const transformCount = 2
+        * cache_initAxis(&key->rowAxis, N, CACHE_MAX_TRANSFORMS)
+        * cache_initAxis(&key->columnAxis, N, CACHE_MAX_TRANSFORMS);
+
+    // Transposing the grid swaps the row and column keys: both orientations
+    // use the same orders of the original rows and columns.
+    bool hasBest = false;
+    for (int transposed = 0; transposed <= 1; transposed++) {
+        if (transformCount > CACHE_MAX_TRANSFORMS) {
+            // Too many: settle for the first transform
+            cache_mapAxis(&key->rowAxis, N);
+            cache_mapAxis(&key->columnAxis, N);
+            cache_tryTransform(key, transposed, hasBest);
+            hasBest = true;
+            continue;
+        }
+
+        do {
+            cache_mapAxis(&key->rowAxis, N);
+            do {
+                cache_mapAxis(&key->columnAxis, N);
+                cache_tryTransform(key, transposed, hasBest);
+                hasBest = true;
+            } while (cache_nextAxisOrder(&key->columnAxis, N));
+        } while (cache_nextAxisOrder(&key->rowAxis, N));
+    }
+
+    // Label the digits missing from the clues, so that the labels are a
+    // permutation
+    tIntSize nextLabel = 1;
+    for (tIntSize value = 1; value <= size; value++) {
+        nextLabel += key->labels[value] != 0;
+    }
+    for (tIntSize value = 1; value <= size; value++) {
+        if (key->labels[value] == 0) {
+            key->labels[value] = nextLabel++;
+        }
+    }
+
+    key->hash = 0xcbf29ce484222325u;
+    for (size_t iCell = 0; iCell < (size_t)size * size; iCell++) {
+        key->hash = cache_mix(key->hash ^ key->values[iCell]);
+    }
+}
+
+bool cache_lookup(tCache *cache, tGrid *grid, tCacheKey *key) {
+    size_t const cellCount = (size_t)grid_size(*grid) * grid_size(*grid);
+    uint32_t *canonicalSolution = key->buffer, *solution = key->buffer + cellCount;
+
+    cache_canonicalize(key, grid);
+
+    pthread_mutex_lock(&cache->lock);
+    size_t e = cache->buckets[key->hash & cache->bucketMask];
+    while (e != CACHE_NIL
+        && (cache->entries[e].hash != key->hash
+            || memcmp(cache->entries[e].values, key->values, sizeof *key->values * cellCount) != 0)) {
+        e = cache->entries[e].chainNext;
+    }
+    if (e != CACHE_NIL) {
+        cache_unlinkRecency(cache, e);
+        cache_linkRecency(cache, e);
+        memcpy(canonicalSolution, cache->entries[e].values + cellCount, sizeof *canonicalSolution * cellCount);
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (e == CACHE_NIL) {
+        return false;
+    }
+
+    // Map the solution back through the inverse transform
+    tIntSize const size = grid_size(*grid);
+    tIntSize *digits = key->candidateLabels; // free after canonicalization
+    for (tIntSize value = 1; value <= size; value++) {
+        digits[key->labels[value]] = value;
+    }
+    for (tIntSize i = 0; i < size; i++) {
+        for (tIntSize j = 0; j < size; j++) {
+            size_t const iCell = key->transposed
+                ? at2d(size, key->rows[j], key->columns[i])
+                : at2d(size, key->rows[i], key->columns[j]);
+            solution[iCell] = digits[canonicalSolution[at2d(size, i, j)]];
+        }
+    }
+
+    // A solution that can't be loaded is a miss: the grid is given its clues
+    // back to be solved
+    bool const hit = grid_loadSudValues(grid, solution) == 0;
+    if (!hit) {
+        grid_loadSudValues(grid, key->gridValues);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if (hit) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return true;
+}
+
+void cache_store(tCache *cache, tGrid const *grid, tCacheKey const *key) {
+    tIntSize const size = grid_size(*grid);
+    size_t const cellCount = (size_t)size * size;
+    uint32_t *values = key->buffer;
+
+    if (!grid_isSolved(grid)) {
+        return;
+    }
+
+    // The canonical form, then the solution through the same transform
+    memcpy(values, key->values, sizeof *values * cellCount);
+    for (tIntSize i = 0; i < size; i++) {
+        for (tIntSize j = 0; j < size; j++) {
+            tIntSize const value = key->transposed
+                ? cell_value(grid_cellAt(*grid, key->rows[j], key->columns[i]))
+                : cell_value(grid_cellAt(*grid, key->rows[i], key->columns[j]));
+            values[cellCount + at2d(size, i, j)] = key->labels[value];
+        }
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache_insert(cache, key->hash, values);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cache_insert(tCache *cache, uint64_t hash, uint32_t const *values) {
+    size_t const cellCount = (size_t)(cache->N * cache->N) * (cache->N * cache->N);
+    size_t *bucket = &cache->buckets[hash & cache->bucketMask];
+
+    // Another thread may have stored the same grid meanwhile
+    for (size_t e = *bucket; e != CACHE_NIL; e = cache->entries[e].chainNext) {
+        if (cache->entries[e].hash == hash && memcmp(cache->entries[e].values, values, sizeof *values * cellCount) == 0) {
+            return;
+        }
+    }
+
+    size_t e;
+    if (cache->count < cache->capacity) {
+        e = cache->count++;
+        cache->entries[e].values = check_alloc(array_malloc(cache->entries[e].values, 2 * cellCount), "cache entry values array");
+    } else {
+        // Evict the least recently used entry, and reuse its storage
+        e = cache->lru;
+        cache_unlinkRecency(cache, e);
+        size_t *link = &cache->buckets[cache->entries[e].hash & cache->bucketMask];
+        while (*link != e) {
+            link = &cache->entries[*link].chainNext;
+        }
+        *link = cache->entries[e].chainNext;
+    }
+
+    tCacheEntry *entry = &cache->entries[e];
+    entry->hash = hash;
+    memcpy(entry->values, values, sizeof *values * 2 * cellCount);
+    entry->chainNext = *bucket;
+    *bucket = e;
+    cache_linkRecency(cache, e);
+}
+
+bool cache_loadSnapshot(tCache *cache, char const *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return errno == ENOENT;
+    }
+
+    size_t const cellCount = (size_t)(cache->N * cache->N) * (cache->N * cache->N);
+    uint32_t header[2];
+    bool valid = fread(header, sizeof *header, 2, file) == 2
+        && header[0] == CACHE_SNAPSHOT_MAGIC && header[1] == CACHE_SNAPSHOT_VERSION;
+
+    // Sections: N, entry count, then the entries from the least recently used
+    uint32_t section[2];
+    uint32_t *values = NULL;
+    bool *seen = NULL;
+    while (valid && fread(section, sizeof *section, 2, file) == 2) {
+        if (section[0] != cache->N) {
+            valid = fseek(file, cache_sectionBytes(section[0], section[1]), SEEK_CUR) == 0;
+            continue;
+        }
+
+        if (values == NULL) {
+            values = check_alloc(array_malloc(values, 2 * cellCount), "cache snapshot values array");
+            seen = check_alloc(array_malloc(seen, cache->N * cache->N + 1), "cache snapshot seen array");
+        }
+        for (uint32_t i = 0; i < section[1] && valid; i++) {
+            valid = fread(values, sizeof *values, 2 * cellCount, file) == 2 * cellCount
+                && cache_isValidEntry(cache->N, values, seen);
+            if (valid) {
+                uint64_t hash = 0xcbf29ce484222325u;
+                for (size_t iCell = 0; iCell < cellCount; iCell++) {
+                    hash = cache_mix(hash ^ values[iCell]);
+                }
+                pthread_mutex_lock(&cache->lock);
+                cache_insert(cache, hash, values);
+                pthread_mutex_unlock(&cache->lock);
+            }
+        }
+    }
+    valid = valid && feof(file);
+
+    free(values);
+    free(seen);
+    fclose(file);
+
+    if (!valid) {
+        fprintf(stderr, PROGRAM_NAME ": %s: invalid cache snapshot\n", path);
+    }
+    return valid;
+}
+
+bool cache_isValidEntry(tIntN N, uint32_t const *values, bool *seen) {
+    tIntSize const size = N * N;
+    size_t const cellCount = (size_t)size * size;
+    uint32_t const *solution = values + cellCount;
+
+    for (size_t iCell = 0; iCell < cellCount; iCell++) {
+        if (solution[iCell] == 0 || solution[iCell] > size
+            || (values[iCell] != 0 && values[iCell] != solution[iCell])) {
+            return false;
+        }
+    }
+
+    // Each row, column and block holds SIZE values: they must be distinct
+    for (tIntSize unit = 0; unit < size; unit++) {
+        for (unsigned kind = 0; kind < 3; kind++) {
+            memset(seen, 0, sizeof *seen * (size + 1));
+            for (tIntSize i = 0; i < size; i++) {
+                size_t const iCell = kind == 0 ? at2d(size, unit, i)
+                    : kind == 1              ? at2d(size, i, unit)
+                                             : at2d(size, unit / N * N + i / N, unit % N * N + i % N);
+                if (seen[solution[iCell]]) {
+                    return false;
+                }
+                seen[solution[iCell]] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool cache_saveSnapshot(tCache *caches, size_t count, char const *path) {
+    // Write to a temporary file, then replace the snapshot with it
+    char *tmpPath = check_alloc(malloc(strlen(path) + sizeof ".tmp"), "cache snapshot path");
+    strcpy(tmpPath, path);
+    strcat(tmpPath, ".tmp");
+
+    FILE *file = fopen(tmpPath, "wb");
+    bool ok = file != NULL;
+
+    uint32_t const header[2] = { CACHE_SNAPSHOT_MAGIC, CACHE_SNAPSHOT_VERSION };
+    ok = ok && fwrite(header, sizeof *header, 2, file) == 2;
+
+    for (size_t c = 0; c < count && ok; c++) {
+        tCache *cache = &caches[c];
+        if (cache->entries == NULL) {
+            continue;
+        }
+        size_t const cellCount = (size_t)(cache->N * cache->N) * (cache->N * cache->N);
+
+        pthread_mutex_lock(&cache->lock);
+        uint32_t const section[2] = { cache->N, cache->count };
+        ok = fwrite(section, sizeof *section, 2, file) == 2;
+        for (size_t e = cache->lru; e != CACHE_NIL && ok; e = cache->entries[e].prev) {
+            ok = fwrite(cache->entries[e].values, sizeof(uint32_t), 2 * cellCount, file) == 2 * cellCount;
+        }
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    ok = ok && cache_copyOtherSections(file, path, caches, count);
+
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    ok = ok && rename(tmpPath, path) == 0;
+
+    if (!ok) {
+        fprintf(stderr, PROGRAM_NAME ": %s: %s\n", path, strerror(errno));
+        remove(tmpPath);
+    }
+    free(tmpPath);
+
+    return ok;
+}
+
+bool cache_copyOtherSections(FILE *out, char const *path, tCache const *caches, size_t count) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        return true;
+    }
+
+    long fileBytes = -1;
+    if (fseek(in, 0, SEEK_END) == 0) {
+        fileBytes = ftell(in);
+    }
+    rewind(in);
+
+    uint32_t header[2];
+    bool valid = fileBytes >= 0 && fread(header, sizeof *header, 2, in) == 2
+        && header[0] == CACHE_SNAPSHOT_MAGIC && header[1] == CACHE_SNAPSHOT_VERSION;
+    bool ok = true;
+
+    uint32_t section[2];
+    while (valid && ok && fread(section, sizeof *section, 2, in) == 2) {
+        long const sectionBytes = cache_sectionBytes(section[0], section[1]);
+        valid = sectionBytes <= fileBytes - ftell(in);
+
+        bool isWritten = false;
+        for (size_t c = 0; c < count && !isWritten; c++) {
+            isWritten = caches[c].entries != NULL && caches[c].N == section[0];
+        }
+        if (!valid || isWritten) {
+            valid = valid && fseek(in, sectionBytes, SEEK_CUR) == 0;
+            continue;
+        }
+
+        ok = fwrite(section, sizeof *section, 2, out) == 2;
+        char buffer[4096];
+        for (long left = sectionBytes; left > 0 && ok;) {
+            size_t const chunk = left < (long)sizeof buffer ? (size_t)left : sizeof buffer;
+            ok = fread(buffer, 1, chunk, in) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+            left -= (long)chunk;
+        }
+    }
+
+    fclose(in);
+    return ok;
+}
@@ -9,6 +9,8 @@
 
 /// @brief Integer: error code for invalid data in a file
 #define ERROR_INVALID_DATA (-1)
+/// @brief Integer: error code for a file that has no more data
+#define ERROR_END_OF_FILE (-2)
 
 /// @brief Integer: exit code for invalid arguments
 #define EXIT_INVALID_ARG 1
@@ -18,6 +20,14 @@
 /// @brief Integer: size of a pair of candidates
 #define PAIR_SIZE 2
 
+/// @brief Integer: largest size of the fish searched by the fish technique: 2
+/// is X-Wing, 3 Swordfish and 4 Jellyfish
+#define FISH_MAX_SIZE 4
+
+/// @brief Integer: grid size factor from which a grid doesn't store the peers
+/// of its cells, whose table takes SIZE³ memory, but lists them on the fly
+#define GRID_LARGE_N 10
+
 /// @brief Defines that the memory debugger should give verbose output.
 // #define MEMDBG_VERBOSE
 
@@ -0,0 +1,314 @@
+/** @file
+ * @brief Dancing Links solving engine
+ * @author 5cover, Matteo-K
+ *
+ * Solves a grid as an exact cover problem with Knuth's Algorithm X, using
+ * Dancing Links.
+ *
+ * The constraint matrix has 4 * SIZE² columns, SIZE² of each kind:
+ * - cell: the cell has a value,
+ * - row-value: the row contains the value,
+ * - column-value: the column contains the value,
+ * - block-value: the block contains the value.
+ *
+ * Each candidate (cell, value) is a matrix row covering 4 columns. Only the
+ * possible values of the empty cells get a row, and the columns already
+ * satisfied by the values of the grid are left out of the header list.
+ *
+ * All nodes live in a single arena allocated once, and are linked by index.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "types.c"
+
+/// @brief Integer: number of constraint kinds of the exact cover matrix.
+#define DLX_CONSTRAINT_COUNT 4
+
+/// @brief Index of a node in the arena.
+typedef uint32_t tDlxIndex;
+
+/// @brief A node of the Dancing Links matrix.
+typedef struct {
+    /// @brief Neighbor nodes.
+    tDlxIndex left, right, up, down;
+    /// @brief Header node of the column of this node.
+    tDlxIndex column;
+    union {
+        /// @brief For row nodes: the candidate, as <tt>cellIndex * SIZE + value
+        /// - 1</tt>.
+        tDlxIndex candidate;
+        /// @brief For column headers: the number of nodes in the column.
+        tDlxIndex size;
+    };
+} tDlxNode;
+
+/// @brief A Dancing Links exact cover matrix built from a grid.
+typedef struct {
+    /// @brief Node arena.
+    /// @remark Layout: [0] is the root, [1 ; 4 * SIZE²] are the column
+    /// headers, then come the row nodes, 4 per candidate.
+    tDlxNode *nodes;
+
+    /// @brief Row nodes of the current partial solution.
+    /// @remark Capacity: SIZE².
+    tDlxIndex *solution;
+
+    /// @brief Number of rows in @ref solution.
+    tDlxIndex solutionCount;
+} tDlx;
+
+/// @brief Index of the root node.
+#define DLX_ROOT 0
+
+/// @brief Inserts a column header at the end of the header list.
+#define dlx_insertHeader(nodes, header)                  \
+    do {                                                 \
+        (nodes)[header].left = (nodes)[DLX_ROOT].left;   \
+        (nodes)[header].right = DLX_ROOT;                \
+        (nodes)[(nodes)[DLX_ROOT].left].right = (header); \
+        (nodes)[DLX_ROOT].left = (header);               \
+    } while (0)
+
+/// @brief Builds the exact cover matrix of a grid.
+/// @param grid in: the grid
+/// @return A new matrix. Must be freed with @ref dlx_free.
+tDlx dlx_create(tGrid const *grid);
+
+/// @brief Frees a matrix.
+/// @param dlx in/out: the matrix to free
+void dlx_free(tDlx *dlx);
+
+/// @brief Solves a grid with Dancing Links.
+/// @param dlx in/out: the exact cover matrix of @p grid
+/// @param grid in/out: the grid
+/// @return Whether the grid has been solved.
+/// @remark The matrix is left in an unspecified state and must not be reused.
+bool dlx_solve(tDlx *dlx, tGrid *grid);
+
+/// @brief Searches for an exact cover.
+/// @param dlx in/out: the matrix
+/// @return Whether a cover has been found. If so, it is in @c dlx->solution.
+/// @remark Used in @ref dlx_solve.
+bool dlx_search(tDlx *dlx);
+
+/// @brief Removes a column and all the rows it contains from the matrix.
+/// @param nodes in/out: the node arena
+/// @param column in: the column header
+void dlx_cover(tDlxNode *nodes, tDlxIndex column);
+
+/// @brief Restores a column removed with @ref dlx_cover.
+/// @param nodes in/out: the node arena
+/// @param column in: the column header
+void dlx_uncover(tDlxNode *nodes, tDlxIndex column);
+
+/////////////////////////////////////////////////////////////////////////
+
+tDlx dlx_create(tGrid const *grid) {
+    tIntSize const size = grid_size(*grid);
+    size_t const cellCount = (size_t)size * size;
+
+    // Count the candidate rows to size the arena exactly
+    size_t rowCount = 0;
+    for (tIntSize r = 0; r < size; r++) {
+        for (tIntSize c = 0; c < size; c++) {
+            if (!cell_hasValue(grid_cellAt(*grid, r, c))) {
+                grid_cellPossibleValuesCount(*grid, r, c, possibleCount);
+                rowCount += possibleCount;
+            }
+        }
+    }
+
+    size_t const nodeCount = 1 + DLX_CONSTRAINT_COUNT * cellCount + DLX_CONSTRAINT_COUNT * rowCount;
+    assert(nodeCount <= UINT32_MAX);
+
+    tDlx dlx = { .solutionCount = 0 };
+    dlx.nodes = check_alloc(array_malloc(dlx.nodes, nodeCount), "dlx nodes arena");
+    dlx.solution = check_alloc(array_malloc(dlx.solution, cellCount), "dlx solution array");
+
+    tDlxNode *nodes = dlx.nodes;
+
+    // Column headers start alone in their column and out of the header list
+    nodes[DLX_ROOT] = (tDlxNode) { .left = DLX_ROOT, .right = DLX_ROOT };
+    for (tDlxIndex h = 1; h <= DLX_CONSTRAINT_COUNT * cellCount; h++) {
+        nodes[h] = (tDlxNode) {
+            .left = h,
+            .right = h,
+            .up = h,
+            .down = h,
+            .column = h,
+            .size = 0,
+        };
+    }
+
+    // Insert the columns of the constraints not satisfied by the grid values in
+    // the header list. A column left without rows then makes the search fail.
+    for (tIntSize i = 0; i < size; i++) {
+        for (tIntSize j = 0; j < size; j++) {
+            tIntSize const value = j + 1;
+            // i is a row, a column and a block index, j a column index and a
+            // value index.
+            if (!cell_hasValue(grid_cellAt(*grid, i, j))) {
+                dlx_insertHeader(nodes, 1 + at2d(size, i, j));
+            }
+            if (!bitset_has(grid_rowValues(*grid, i), value)) {
+                dlx_insertHeader(nodes, 1 + cellCount + at2d(size, i, j));
+            }
+            if (!bitset_has(grid_columnValues(*grid, i), value)) {
+                dlx_insertHeader(nodes, 1 + 2 * cellCount + at2d(size, i, j));
+            }
+            if (!bitset_has(grid_unitValues(*grid, grid_unit(*grid, UNIT_BLOCK, i)), value)) {
+                dlx_insertHeader(nodes, 1 + 3 * cellCount + at2d(size, i, j));
+            }
+        }
+    }
+
+    tDlxIndex next = 1 + DLX_CONSTRAINT_COUNT * cellCount;
+
+    for (tIntSize r = 0; r < size; r++) {
+        for (tIntSize c = 0; c < size; c++) {
+            if (cell_hasValue(grid_cellAt(*grid, r, c))) {
+                continue;
+            }
+
+            tIntSize const block = grid_blockAt(*grid, r, c);
+
+            for (tIntSize word = 0; word < grid->_candidateWordCount; word++) {
+                for (tBitWord possibleValues = grid_cellPossibleValuesWord(*grid, r, c, word);
+                    possibleValues != 0; possibleValues &= possibleValues - 1) {
+                    tIntSize const iValue = word * BITWORD_BITS + bitword_first(possibleValues) - 1;
+
+                    tDlxIndex const headers[DLX_CONSTRAINT_COUNT] = {
+                        1 + at2d(size, r, c),
+                        1 + cellCount + at2d(size, r, iValue),
+                        1 + 2 * cellCount + at2d(size, c, iValue),
+                        1 + 3 * cellCount + at2d(size, block, iValue),
+                    };
+
+                    tDlxIndex const first = next;
+                    for (unsigned k = 0; k < DLX_CONSTRAINT_COUNT; k++) {
+                        tDlxIndex const node = next++;
+                        tDlxIndex const header = headers[k];
+
+                        // Link horizontally in a circular list
+                        nodes[node].left = k == 0 ? first + DLX_CONSTRAINT_COUNT - 1 : node - 1;
+                        nodes[node].right = k == DLX_CONSTRAINT_COUNT - 1 ? first : node + 1;
+
+                        // Append at the bottom of the column
+                        nodes[node].column = header;
+                        nodes[node].candidate = at2d(size, at2d(size, r, c), iValue);
+                        nodes[node].up = nodes[header].up;
+                        nodes[node].down = header;
+                        nodes[nodes[header].up].down = node;
+                        nodes[header].up = node;
+                        nodes[header].size++;
+                    }
+                }
+            }
+        }
+    }
+
+    assert(next == nodeCount);
+
+    return dlx;
+}
+
+void dlx_free(tDlx *dlx) {
+    free(dlx->nodes);
+    free(dlx->solution);
+}
+
+bool dlx_solve(tDlx *dlx, tGrid *grid) {
+    assert(dlx->solutionCount == 0);
+
+    if (!dlx_search(dlx)) {
+        return false;
+    }
+
+    for (tDlxIndex i = 0; i < dlx->solutionCount; i++) {
+        tDlxIndex const candidate = dlx->nodes[dlx->solution[i]].candidate;
+        tDlxIndex const iCell = candidate / grid_size(*grid);
+        grid_cell_provideValue(grid, iCell / grid_size(*grid), iCell % grid_size(*grid),
+            candidate % grid_size(*grid) + 1);
+    }
+
+    return true;
+}
+
+bool dlx_search(tDlx *dlx) {
+    tDlxNode *nodes = dlx->nodes;
+
+    // All constraints are satisfied
+    if (nodes[DLX_ROOT].right == DLX_ROOT) {
+        return true;
+    }
+
+    // Choose the column with the least rows
+    tDlxIndex column = nodes[DLX_ROOT].right;
+    for (tDlxIndex h = nodes[column].right; h != DLX_ROOT && nodes[column].size > 1; h = nodes[h].right) {
+        if (nodes[h].size < nodes[column].size) {
+            column = h;
+        }
+    }
+
+    if (nodes[column].size == 0) {
+        return false;
+    }
+
+    dlx_cover(nodes, column);
+
+    for (tDlxIndex row = nodes[column].down; row != column; row = nodes[row].down) {
+        dlx->solution[dlx->solutionCount++] = row;
+
+        for (tDlxIndex j = nodes[row].right; j != row; j = nodes[j].right) {
+            dlx_cover(nodes, nodes[j].column);
+        }
+
+        // The matrix is left as is when solved, as it is not reused.
+        if (dlx_search(dlx)) {
+            return true;
+        }
+
+        for (tDlxIndex j = nodes[row].left; j != row; j = nodes[j].left) {
+            dlx_uncover(nodes, nodes[j].column);
+        }
+
+        dlx->solutionCount--;
+    }
+
+    dlx_uncover(nodes, column);
+
+    return false;
+}
+
+void dlx_cover(tDlxNode *nodes, tDlxIndex column) {
+    nodes[nodes[column].right].left = nodes[column].left;
+    nodes[nodes[column].left].right = nodes[column].right;
+
+    for (tDlxIndex i = nodes[column].down; i != column; i = nodes[i].down) {
+        for (tDlxIndex j = nodes[i].right; j != i; j = nodes[j].right) {
+            nodes[nodes[j].down].up = nodes[j].up;
+            nodes[nodes[j].up].down = nodes[j].down;
+            nodes[nodes[j].column].size--;
+        }
+    }
+}
+
+void dlx_uncover(tDlxNode *nodes, tDlxIndex column) {
+    for (tDlxIndex i = nodes[column].up; i != column; i = nodes[i].up) {
+        for (tDlxIndex j = nodes[i].left; j != i; j = nodes[j].left) {
+            nodes[nodes[j].column].size++;
+            nodes[nodes[j].down].up = j;
+            nodes[nodes[j].up].down = j;
+        }
+    }
+
+    nodes[nodes[column].right].left = column;
+    nodes[nodes[column].left].right = column;
+}
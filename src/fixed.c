@@ -0,0 +1,63 @@
+/** @file
+ * @brief Solvers specialized for common grid sizes
+ * @author 5cover, Matteo-K
+ *
+ * Instantiates the fixed_n.c template for N=3, 4 and 5, and selects the
+ * instance matching a grid at run time.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "grid.c"
+#include "types.c"
+
+/// @brief Pastes the specialized grid size factor between a prefix and a
+/// suffix, e.g. @c fixed3_solve.
+#define fixed_name(prefix, suffix) fixed_nameExpanded(prefix, FIXED_N, suffix)
+#define fixed_nameExpanded(prefix, n, suffix) fixed_namePasted(prefix, n, suffix)
+#define fixed_namePasted(prefix, n, suffix) prefix##n##suffix
+
+#define FIXED_N 3
+#define tFixedMask uint16_t
+#include "fixed_n.c"
+#undef tFixedMask
+#undef FIXED_N
+
+#define FIXED_N 4
+#define tFixedMask uint32_t
+#include "fixed_n.c"
+#undef tFixedMask
+#undef FIXED_N
+
+#define FIXED_N 5
+#define tFixedMask uint32_t
+#include "fixed_n.c"
+#undef tFixedMask
+#undef FIXED_N
+
+/// @brief Determines whether a grid size factor has a specialized solver.
+#define fixed_isSpecialized(N) ((N) >= 3 && (N) <= 5)
+
+/// @brief Solves a grid with the solver specialized for its size.
+/// @param grid in/out: the grid. Its size must be specialized: see @ref
+/// fixed_isSpecialized.
+/// @return Whether the grid has been solved.
+bool fixed_solve(tGrid *grid);
+
+/////////////////////////////////////////////////////////////////////////
+
+bool fixed_solve(tGrid *grid) {
+    switch (grid->N) {
+    case 3:
+        return fixed3_solve(grid);
+    case 4:
+        return fixed4_solve(grid);
+    case 5:
+        return fixed5_solve(grid);
+    default:
+        abort();
+    }
+}
@@ -0,0 +1,227 @@
+/** @file
+ * @brief Solver specialized for a fixed grid size
+ * @author 5cover, Matteo-K
+ *
+ * Template included by fixed.c once per specialized grid size, with @c FIXED_N
+ * defined to the grid size factor and @c tFixedMask to an unsigned integer type
+ * of at least FIXED_N² + 1 bits.
+ *
+ * As the grid size is a compile-time constant, the group of a cell is found
+ * without actual divisions, the value sets of the groups are single masks and
+ * the whole state lives in a fixed-size structure on the stack.
+ */
+
+// No include guard: this file is included once per specialized grid size.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bitset.c"
+#include "grid.c"
+#include "stats.c"
+#include "types.c"
+
+/// @brief Integer: the grid size, SIZE.
+#define FIXED_SIZE (FIXED_N * FIXED_N)
+/// @brief Integer: the number of cells, SIZE².
+#define FIXED_CELL_COUNT (FIXED_SIZE * FIXED_SIZE)
+/// @brief Mask of all the values: bits 1 to SIZE.
+#define FIXED_ALL_VALUES ((tFixedMask)((((uint64_t)1 << FIXED_SIZE) - 1) << 1))
+
+#define fixed_row(iCell) ((iCell) / FIXED_SIZE)
+#define fixed_column(iCell) ((iCell) % FIXED_SIZE)
+#define fixed_block(iCell) (fixed_row(iCell) / FIXED_N * FIXED_N + fixed_column(iCell) / FIXED_N)
+
+/// @brief Gets the flat index of the ith cell of a unit: rows are in [0 ;
+/// SIZE[, columns in [SIZE ; 2 * SIZE[ and blocks in [2 * SIZE ; 3 * SIZE[.
+#define fixed_unitCell(unit, i)                                                                    \
+    ((unit) < FIXED_SIZE       ? (unit) * FIXED_SIZE + (i)                                         \
+            : (unit) < 2 * FIXED_SIZE ? (i) * FIXED_SIZE + (unit) - FIXED_SIZE                     \
+                                      : ((((unit) - 2 * FIXED_SIZE) / FIXED_N * FIXED_N + (i) / FIXED_N) * FIXED_SIZE \
+                                          + ((unit) - 2 * FIXED_SIZE) % FIXED_N * FIXED_N + (i) % FIXED_N))
+
+/// @brief Gets the mask of the values present in a unit.
+#define fixed_unitValues(g, unit)                                     \
+    ((unit) < FIXED_SIZE       ? (g)->rowValues[unit]                 \
+            : (unit) < 2 * FIXED_SIZE ? (g)->columnValues[(unit) - FIXED_SIZE] \
+                                      : (g)->blockValues[(unit) - 2 * FIXED_SIZE])
+
+/// @brief Gets the mask of the possible values of a cell.
+#define fixed_possibleValues(g, iCell)                                         \
+    (FIXED_ALL_VALUES                                                          \
+        & ~((g)->rowValues[fixed_row(iCell)] | (g)->columnValues[fixed_column(iCell)] \
+            | (g)->blockValues[fixed_block(iCell)]))
+
+/// @brief Toggles a value in the groups of a cell.
+#define fixed_toggleValue(g, iCell, valueBit)                  \
+    do {                                                       \
+        (g)->rowValues[fixed_row(iCell)] ^= (valueBit);        \
+        (g)->columnValues[fixed_column(iCell)] ^= (valueBit);  \
+        (g)->blockValues[fixed_block(iCell)] ^= (valueBit);    \
+    } while (0)
+
+/// @brief State of a grid of fixed size.
+typedef struct {
+    /// @brief Mask of the values present in each row.
+    tFixedMask rowValues[FIXED_SIZE];
+    /// @brief Mask of the values present in each column.
+    tFixedMask columnValues[FIXED_SIZE];
+    /// @brief Mask of the values present in each block.
+    tFixedMask blockValues[FIXED_SIZE];
+    /// @brief Value of each cell, 0 if empty.
+    uint8_t values[FIXED_CELL_COUNT];
+    /// @brief Possible values of each empty cell at the current search depth.
+    /// @remark Scratch state, recomputed by each search step.
+    tFixedMask possibleValues[FIXED_CELL_COUNT];
+    /// @brief Flat indexes of the cells empty in the input. The cells before
+    /// the search depth are filled.
+    uint16_t emptyCells[FIXED_CELL_COUNT];
+    /// @brief Number of cells in @ref emptyCells.
+    unsigned emptyCount;
+#ifdef SUDONE_STATS
+    /// @brief Solving statistics of the grid solved.
+    tStats *stats;
+#endif
+} fixed_name(tFixed, Grid);
+
+/// @brief Solves a grid of the specialized size.
+/// @param grid in/out: the grid
+/// @return Whether the grid has been solved.
+bool fixed_name(fixed, _solve)(tGrid *grid);
+
+/// @brief Fills the empty cells of a fixed grid from a search depth on.
+/// @param g in/out: the fixed grid
+/// @param depth in: the number of empty cells already filled
+/// @return Whether the cells have all been filled.
+/// @remark Used in the solve function.
+bool fixed_name(fixed, _search)(fixed_name(tFixed, Grid) * g, unsigned depth);
+
+/////////////////////////////////////////////////////////////////////////
+
+bool fixed_name(fixed, _solve)(tGrid *grid) {
+    fixed_name(tFixed, Grid) g = { .emptyCount = 0 };
+#ifdef SUDONE_STATS
+    g.stats = &grid->stats;
+#endif
+
+    for (unsigned iCell = 0; iCell < FIXED_CELL_COUNT; iCell++) {
+        tIntSize const value = grid->values[iCell];
+        tFixedMask const valueBit = (tFixedMask)1 << value;
+
+        g.values[iCell] = value;
+        if (value == 0) {
+            g.emptyCells[g.emptyCount++] = iCell;
+        } else if ((fixed_possibleValues(&g, iCell) & valueBit) == 0) {
+            return false; // The value is already in a group of the cell
+        } else {
+            fixed_toggleValue(&g, iCell, valueBit);
+        }
+    }
+
+    if (!fixed_name(fixed, _search)(&g, 0)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < g.emptyCount; i++) {
+        unsigned const iCell = g.emptyCells[i];
+        grid_cell_provideValue(grid, fixed_row(iCell), fixed_column(iCell), g.values[iCell]);
+    }
+
+    return true;
+}
+
+bool fixed_name(fixed, _search)(fixed_name(tFixed, Grid) * g, unsigned depth) {
+    stats_enterNode(*g->stats);
+
+    if (depth == g->emptyCount) {
+        stats_leaveNode(*g->stats, false);
+        return true;
+    }
+
+    // Select the cell with the least possible values
+    unsigned best = depth;
+    tFixedMask bestValues = 0;
+    unsigned bestCount = FIXED_SIZE + 1;
+    for (unsigned i = depth; i < g->emptyCount; i++) {
+        unsigned const iCell = g->emptyCells[i];
+        tFixedMask const possibleValues = fixed_possibleValues(g, iCell);
+        unsigned const count = bitword_count(possibleValues);
+
+        if (count == 0) {
+            stats_leaveNode(*g->stats, true);
+            return false;
+        }
+        g->possibleValues[iCell] = possibleValues;
+        if (count < bestCount) {
+            best = i;
+            bestValues = possibleValues;
+            bestCount = count;
+        }
+    }
+
+    // Without a naked single, look for a value with a single place in a unit
+    // (hidden single). A value with no place at all is a dead end.
+    for (unsigned unit = 0; unit < 3 * FIXED_SIZE && bestCount > 1; unit++) {
+        tFixedMask once = 0, twice = 0;
+        for (unsigned i = 0; i < FIXED_SIZE; i++) {
+            unsigned const iCell = fixed_unitCell(unit, i);
+            if (g->values[iCell] == 0) {
+                twice |= once & g->possibleValues[iCell];
+                once |= g->possibleValues[iCell];
+            }
+        }
+
+        if ((once | fixed_unitValues(g, unit)) != FIXED_ALL_VALUES) {
+            stats_leaveNode(*g->stats, true);
+            return false;
+        }
+
+        tFixedMask const hiddenSingles = once & ~twice;
+        if (hiddenSingles != 0) {
+            tFixedMask const valueBit = hiddenSingles & -hiddenSingles;
+            unsigned i = 0, iCell;
+            while (iCell = fixed_unitCell(unit, i),
+                g->values[iCell] != 0 || (g->possibleValues[iCell] & valueBit) == 0) {
+                i++;
+            }
+
+            best = depth;
+            while (g->emptyCells[best] != iCell) {
+                best++;
+            }
+            bestValues = valueBit;
+            bestCount = 1;
+        }
+    }
+
+    unsigned const iCell = g->emptyCells[best];
+    g->emptyCells[best] = g->emptyCells[depth];
+    g->emptyCells[depth] = iCell;
+
+    for (; bestValues != 0; bestValues &= bestValues - 1) {
+        tFixedMask const valueBit = bestValues & -bestValues;
+
+        fixed_toggleValue(g, iCell, valueBit);
+        g->values[iCell] = bitword_first(valueBit);
+        if (fixed_name(fixed, _search)(g, depth + 1)) {
+            stats_leaveNode(*g->stats, false);
+            return true;
+        }
+        fixed_toggleValue(g, iCell, valueBit);
+    }
+
+    g->values[iCell] = 0;
+    stats_leaveNode(*g->stats, true);
+    return false;
+}
+
+#undef FIXED_SIZE
+#undef FIXED_CELL_COUNT
+#undef FIXED_ALL_VALUES
+#undef fixed_row
+#undef fixed_column
+#undef fixed_block
+#undef fixed_unitCell
+#undef fixed_unitValues
+#undef fixed_possibleValues
+#undef fixed_toggleValue
@@ -0,0 +1,318 @@
+/** @file
+ * @brief Multi-threaded puzzle generator
+ * @author 5cover, Matteo-K
+ *
+ * Generates puzzles with a unique solution on a pool of worker threads.
+ *
+ * A puzzle starts as a random solution, found by backtracking on an empty grid
+ * in a random value order. Its clues are then removed one by one in a random
+ * order, each removal being kept if the puzzle still has a unique solution,
+ * which the solution count mode checks. The result is a minimal puzzle: no clue
+ * can be removed without losing the uniqueness.
+ *
+ * A difficulty can be targeted: the lowest tier of logic techniques of the
+ * solver that solves the puzzle. Removals that would raise the tier above the
+ * target are rejected, and puzzles that end below it are started over.
+ *
+ * Each puzzle is generated from its own seed, derived from the seed of the run
+ * and its number, so that a run is reproducible whatever the number of
+ * threads. The workers store the puzzles in a ring of slots, which the main
+ * thread outputs in order.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "packed.c"
+#include "solver.c"
+#include "types.c"
+
+/// @brief Integer: number of slots of the output ring, per worker.
+#define GENERATE_SLOTS_PER_WORKER 4
+
+/// @brief Integer: difficulty of a generator that targets none.
+#define GENERATE_ANY_TIER TIER_COUNT
+
+/// @brief Options of a generator.
+typedef struct {
+    /// @brief Number of puzzles to generate.
+    unsigned long count;
+    /// @brief Tier of the puzzles, or @ref GENERATE_ANY_TIER.
+    tTier tier;
+    /// @brief Seed of the pseudo-random generator.
+    uint64_t seed;
+    /// @brief Number of worker threads.
+    unsigned workerCount;
+    /// @brief Whether to output in binary (Sud) format.
+    bool binary;
+    /// @brief Whether to output in the packed format, whose header has been
+    /// written. Takes precedence over @ref binary.
+    bool packed;
+    /// @brief Flags of the packed output.
+    uint8_t packedFlags;
+} tGenerateOptions;
+
+struct sGenerator;
+
+/// @brief A worker thread of a generator.
+typedef struct {
+    /// @brief The generator this worker belongs to.
+    struct sGenerator *generator;
+    /// @brief The solver of this worker.
+    tSolver solver;
+    /// @brief The cells of a grid, in the order their clues are removed.
+    /// @remark Dimensions: [cellCount]
+    tIntCell *cellOrder;
+    /// @brief The thread of this worker.
+    pthread_t thread;
+} tGenerateWorker;
+
+/// @brief A multi-threaded puzzle generator.
+typedef struct sGenerator {
+    /// @brief Options of the generator.
+    tGenerateOptions options;
+
+    /// @brief Workers of the generator.
+    /// @remark Dimensions: [workerIndex]
+    tGenerateWorker *workers;
+
+    /// @brief Grid used by the main thread to output the puzzles.
+    tGrid output;
+
+    /// @brief Buffer used by the main thread to encode the puzzles in the
+    /// packed format, or NULL.
+    uint8_t *packedBuffer;
+
+    /// @brief Sud values of the puzzles of the ring. Puzzle i is in slot i %
+    /// @ref slotCount.
+    /// @remark Dimensions: [slotIndex][cellIndex]
+    uint32_t *slots;
+
+    /// @brief Whether each slot holds a puzzle yet to be output.
+    /// @remark Dimensions: [slotIndex]
+    bool *slotFull;
+
+    /// @brief Number of slots of the ring.
+    size_t slotCount;
+
+    /// @brief Protects @ref nextPuzzle, @ref outputCount and @ref slotFull.
+    pthread_mutex_t lock;
+
+    /// @brief Signaled when a slot is filled.
+    pthread_cond_t slotFilled;
+
+    /// @brief Signaled when a slot is emptied.
+    pthread_cond_t slotEmptied;
+
+    /// @brief Number of the next puzzle to generate.
+    unsigned long nextPuzzle;
+
+    /// @brief Number of puzzles output.
+    unsigned long outputCount;
+} tGenerator;
+
+/// @brief Creates a generator.
+/// @param N in: grid size factor
+/// @param options in: options of the generator
+/// @return A new generator. Must be freed with @ref generator_free.
+tGenerator generator_create(tIntN N, tGenerateOptions options);
+
+/// @brief Frees a generator.
+/// @param generator in/out: the generator to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created generator, as all its pointers are either NULL or valid.
+void generator_free(tGenerator *generator);
+
+/// @brief Generates the puzzles of a generator and writes them in order.
+/// @param generator in/out: the generator
+/// @param outStream in: the stream to write the puzzles to
+void generator_run(tGenerator *generator, FILE *outStream);
+
+/// @brief Main function of a worker thread.
+/// @param worker in/out: the worker (tGenerateWorker *)
+/// @return NULL.
+/// @remark Used in @ref generator_run.
+void *generator_workerMain(void *worker);
+
+/// @brief Generates a puzzle.
+/// @param worker in/out: the worker
+/// @param number in: the number of the puzzle, from 0
+/// @param sudValues out: the Sud values of the puzzle
+/// @remark Used in @ref generator_workerMain.
+void generator_puzzle(tGenerateWorker *worker, unsigned long number, uint32_t *sudValues);
+
+/////////////////////////////////////////////////////////////////////////
+
+tGenerator generator_create(tIntN N, tGenerateOptions options) {
+    size_t const cellCount = (size_t)(N * N) * (N * N);
+
+    tGenerator generator = {
+        .options = options,
+        .output = grid_create(N, 0),
+        .slotCount = (size_t)GENERATE_SLOTS_PER_WORKER * options.workerCount,
+        .nextPuzzle = 0,
+        .outputCount = 0,
+    };
+
+    generator.workers = check_alloc(array_malloc(generator.workers, options.workerCount), "generator workers array");
+    generator.slots = check_alloc(array_malloc(generator.slots, generator.slotCount * cellCount), "generator slots array");
+    generator.slotFull = check_alloc(array_calloc(generator.slotFull, generator.slotCount), "generator slot full array");
+    generator.packedBuffer = options.packed
+        ? check_alloc(malloc(packed_maxGridSize(N, options.packedFlags)), "generator packed buffer")
+        : NULL;
+
+    for (unsigned w = 0; w < options.workerCount; w++) {
+        generator.workers[w] = (tGenerateWorker) {
+            // Propagating singletons makes the uniqueness checks of sparse
+            // puzzles several times faster
+            .solver = solver_create(N, ENGINE_TECHNIQUES, true),
+            .cellOrder = check_alloc(array_malloc(generator.workers[w].cellOrder, cellCount), "generator cell order array"),
+        };
+    }
+
+    return generator;
+}
+
+void generator_free(tGenerator *generator) {
+    if (generator->workers != NULL) {
+        for (unsigned w = 0; w < generator->options.workerCount; w++) {
+            solver_free(&generator->workers[w].solver);
+            free(generator->workers[w].cellOrder);
+        }
+    }
+    free(generator->workers);
+    grid_free(&generator->output);
+    free(generator->packedBuffer);
+    free(generator->slots);
+    free(generator->slotFull);
+}
+
+void generator_run(tGenerator *generator, FILE *outStream) {
+    size_t const cellCount = (size_t)grid_size(generator->output) * grid_size(generator->output);
+    unsigned const workerCount = generator->options.workerCount;
+
+    pthread_mutex_init(&generator->lock, NULL);
+    pthread_cond_init(&generator->slotFilled, NULL);
+    pthread_cond_init(&generator->slotEmptied, NULL);
+
+    for (unsigned w = 0; w < workerCount; w++) {
+        generator->workers[w].generator = generator;
+        pthread_create(&generator->workers[w].thread, NULL, generator_workerMain, &generator->workers[w]);
+    }
+
+    // Output the puzzles in order as they're done
+    for (unsigned long p = 0; p < generator->options.count; p++) {
+        size_t const slot = p % generator->slotCount;
+        uint32_t const *values = &generator->slots[slot * cellCount];
+
+        pthread_mutex_lock(&generator->lock);
+        while (!generator->slotFull[slot]) {
+            pthread_cond_wait(&generator->slotFilled, &generator->lock);
+        }
+        pthread_mutex_unlock(&generator->lock);
+
+        if (generator->options.packed) {
+            size_t const size = packed_encode(values, generator->output.N, generator->options.packedFlags, generator->packedBuffer);
+            fwrite(generator->packedBuffer, 1, size, outStream);
+        } else if (generator->options.binary) {
+            fwrite(values, sizeof *values, cellCount, outStream);
+        } else {
+            grid_loadSudValues(&generator->output, values);
+            grid_print(&generator->output, outStream);
+        }
+
+        pthread_mutex_lock(&generator->lock);
+        generator->slotFull[slot] = false;
+        generator->outputCount++;
+        pthread_cond_broadcast(&generator->slotEmptied);
+        pthread_mutex_unlock(&generator->lock);
+    }
+
+    for (unsigned w = 0; w < workerCount; w++) {
+        pthread_join(generator->workers[w].thread, NULL);
+    }
+
+    pthread_cond_destroy(&generator->slotEmptied);
+    pthread_cond_destroy(&generator->slotFilled);
+    pthread_mutex_destroy(&generator->lock);
+}
+
+void *generator_workerMain(void *worker) {
+    tGenerateWorker *self = worker;
+    tGenerator *generator = self->generator;
+    size_t const cellCount = (size_t)grid_size(self->solver.grid) * grid_size(self->solver.grid);
+
+    while (true) {
+        // Take the next puzzle, and wait for its slot to be output
+        pthread_mutex_lock(&generator->lock);
+        if (generator->nextPuzzle == generator->options.count) {
+            pthread_mutex_unlock(&generator->lock);
+            return NULL;
+        }
+        unsigned long const number = generator->nextPuzzle++;
+        while (number >= generator->outputCount + generator->slotCount) {
+            pthread_cond_wait(&generator->slotEmptied, &generator->lock);
+        }
+        pthread_mutex_unlock(&generator->lock);
+
+        // The slot is ours until it is marked full
+        size_t const slot = number % generator->slotCount;
+        generator_puzzle(self, number, &generator->slots[slot * cellCount]);
+
+        pthread_mutex_lock(&generator->lock);
+        generator->slotFull[slot] = true;
+        pthread_cond_broadcast(&generator->slotFilled);
+        pthread_mutex_unlock(&generator->lock);
+    }
+}
+
+void generator_puzzle(tGenerateWorker *worker, unsigned long number, uint32_t *sudValues) {
+    tSolver *solver = &worker->solver;
+    tGrid *grid = &solver->grid;
+    tTier const target = worker->generator->options.tier;
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+
+    uint64_t random = worker->generator->options.seed;
+    random ^= random_next(&(uint64_t) { number });
+
+    while (true) {
+        // A random solution
+        memset(sudValues, 0, sizeof *sudValues * cellCount);
+        grid_loadSudValues(grid, sudValues);
+        solver_randomSolve(solver, &random);
+        grid_storeSudValues(grid, sudValues);
+
+        // Its cells in a random order (Fisher-Yates shuffle)
+        for (tIntCell i = 0; i < cellCount; i++) {
+            tIntCell const j = random_below(&random, i + 1);
+            worker->cellOrder[i] = worker->cellOrder[j];
+            worker->cellOrder[j] = i;
+        }
+
+        // Remove the clues whose removal keeps the puzzle unique, and within
+        // the target tier
+        for (tIntCell i = 0; i < cellCount; i++) {
+            tIntCell const iCell = worker->cellOrder[i];
+            uint32_t const value = sudValues[iCell];
+            sudValues[iCell] = 0;
+
+            grid_loadSudValues(grid, sudValues);
+            bool const keep = solver_countSolutions(solver, SOLVER_UNIQUENESS_LIMIT) == 1
+                && (target == GENERATE_ANY_TIER || solver_grade(solver, sudValues) <= target);
+            if (!keep) {
+                sudValues[iCell] = value;
+            }
+        }
+
+        if (target == GENERATE_ANY_TIER || solver_grade(solver, sudValues) == target) {
+            return;
+        }
+    }
+}
@@ -18,28 +18,101 @@
 
 #define grid_size(grid) ((grid).N * (grid).N)
 
+/// @brief Gets a reference to a cell from its flat index.
+#define grid_cellAtIndex(grid, iCell)                                                    \
+    ((tCell) {                                                                           \
+        ._value = &(grid).values[(iCell)],                                               \
+        .candidates = &(grid)._candidates[at2d((grid)._candidateWordCount, (iCell), 0)], \
+        ._candidateCount = &(grid)._candidateCounts[(iCell)],                            \
+    })
 #define grid_cellAt(grid, row, column) \
-    (grid).cells[at2d(grid_size(grid), (row), (column))]
+    grid_cellAtIndex(grid, at2d(grid_size(grid), (row), (column)))
 #define grid_cellAtPos(grid, pos) grid_cellAt(grid, pos.row, pos.column)
+
+/// @brief Gets the next candidate of a cell after a value.
+/// @param grid in: the grid
+/// @param cell in: a cell of @p grid
+/// @param candidate in: the value to search after (0 to get the first candidate)
+/// @return The first candidate of @p cell greater than @p candidate, or a value
+/// greater than @ref SIZE if there is none.
+#define grid_cell_nextCandidate(grid, cell, candidate) \
+    bitset_next((cell).candidates, (grid)._candidateWordCount, (candidate))
+
+/// @brief Gets the number of units (rows, columns and blocks) of a grid.
+#define grid_unitCount(grid) (UNIT_KIND_COUNT * grid_size(grid))
+
+/// @brief Gets the index of a unit.
+/// @param grid in: the grid
+/// @param kind in: the kind of the unit (@ref tUnitKind)
+/// @param index in: the row, column or block index
+#define grid_unit(grid, kind, index) ((kind) * grid_size(grid) + (index))
+
+/// @brief Gets the flat indexes of the SIZE cells of a unit.
+#define grid_unitCells(grid, unit) \
+    (&(grid)._unitCells[at2d(grid_size(grid), (unit), 0)])
+
+/// @brief Gets the row, column or block index of a cell from its flat index.
+/// @param grid in: the grid
+/// @param iCell in: the flat index of the cell
+/// @param kind in: the kind of the index (@ref tUnitKind)
+#define grid_cellUnit(grid, iCell, kind) \
+    ((grid)._cellUnits[at2d(UNIT_KIND_COUNT, (iCell), (kind))])
+
+/// @brief Gets the position of a cell from its flat index.
+#define grid_cellPosition(grid, iCell)                       \
+    ((tPosition) {                                           \
+        .row = grid_cellUnit(grid, iCell, UNIT_ROW),         \
+        .column = grid_cellUnit(grid, iCell, UNIT_COLUMN), \
+    })
+
+/// @brief Gets the number of peers of a cell: the other cells of its row,
+/// column and block.
+#define grid_peerCount(grid) ((tIntCell)(3 * grid_size(grid) - 2 * (grid).N - 1))
+
+/// @brief Determines whether a grid is large: its memory takes precedence
+/// over its speed.
+#define grid_isLarge(grid) ((grid).N >= GRID_LARGE_N)
+
+/// @brief Gets the value of a cell in a fixed solution of the empty grid, where
+/// each row is the previous one shifted by N values, or by 1 at a band
+/// boundary.
+#define grid_patternValue(grid, row, column) \
+    ((tIntSize)(((grid).N * ((row) % (grid).N) + (row) / (grid).N + (column)) % grid_size(grid) + 1))
+
+/// @brief Gets the flat index of the block containing a cell.
+#define grid_blockAt(grid, row, column) \
+    grid_cellUnit(grid, at2d(grid_size(grid), (row), (column)), UNIT_BLOCK)
+
+/// @brief Gets the value bitset of a unit.
+#define grid_unitValues(grid, unit) \
+    (&(grid)._unitValues[at2d((grid)._candidateWordCount, (unit), 0)])
+/// @brief Gets the value bitset of a column.
+#define grid_columnValues(grid, column) \
+    grid_unitValues(grid, grid_unit(grid, UNIT_COLUMN, column))
+/// @brief Gets the value bitset of a row.
+#define grid_rowValues(grid, row) \
+    grid_unitValues(grid, grid_unit(grid, UNIT_ROW, row))
+/// @brief Gets the value bitset of the block containing a cell.
+#define grid_blockValues(grid, row, column) \
+    grid_unitValues(grid, grid_unit(grid, UNIT_BLOCK, grid_blockAt(grid, row, column)))
+
 /// @brief Defines whether a value is free or not at a position on the grid.
-#define grid_markValueFree(isFree, grid, row, column, value)                       \
-    do {                                                                           \
-        assert((row) < grid_size(grid));                                               \
-        assert((column) < grid_size(grid));                                            \
-        assert((value) <= grid_size(grid));                                            \
-        (grid)._isColumnFree[at2d(grid_size(grid) + 1, (column), (value))] = (isFree); \
-        (grid)._isRowFree[at2d(grid_size(grid) + 1, (row), (value))] = (isFree);       \
-        (grid)._isBlockFree[at3d((grid).N, grid_size(grid) + 1, (row) / (grid).N,      \
-            (column) / (grid).N, (value))]                                         \
-            = (isFree);                                                            \
+#define grid_markValueFree(isFree, grid, row, column, value)             \
+    do {                                                                 \
+        assert((row) < grid_size(grid));                                 \
+        assert((column) < grid_size(grid));                              \
+        assert(1 <= (value) && (value) <= grid_size(grid));              \
+        if (isFree) {                                                    \
+            bitset_remove(grid_columnValues(grid, column), (value));     \
+            bitset_remove(grid_rowValues(grid, row), (value));           \
+            bitset_remove(grid_blockValues(grid, row, column), (value)); \
+        } else {                                                         \
+            bitset_add(grid_columnValues(grid, column), (value));        \
+            bitset_add(grid_rowValues(grid, row), (value));              \
+            bitset_add(grid_blockValues(grid, row, column), (value));    \
+        }                                                                \
     } while (0)
 
-/// @brief Gets the axis index (a row or column number) of the start of the
-/// block containing the given index.
-/// @param index in: an axis index (row or column number)
-/// @return The axis index of the start of the block containing the given index.
-#define grid_blockIndex(grid, index) (index - (index % (grid).N))
-
 /// @brief Check if a value can be added to the grid. Does not take candidates
 /// into account.
 /// @param grid in: the grid
@@ -50,14 +123,29 @@
 /// @remark According to the rules of Sudoku, a value can only be added to the
 /// grid when it is not already present in the row, in the column and in the
 /// block.
-// After running tests, it seems that the fastest access order is column, row,
-// block. This solutions is considerably faster than the naive alternative
-// (iterating over cells) But it comes at a price : we must make sure that the
-// state of candidates in the grid and the "_is*Free" arrays are synchronized
-// from the start of the resolution to the backtracking call. For this we use
-// the grid_markValueFree macro
-#define grid_possible(grid, row, column, value) \
-    ((grid)._isColumnFree[at2d(grid_size(grid) + 1, (column), (value))] && (grid)._isRowFree[at2d(grid_size(grid) + 1, (row), (value))] && (grid)._isBlockFree[at3d((grid).N, grid_size(grid) + 1, (row) / (grid).N, (column) / (grid).N, (value))])
+// This solution is considerably faster than the naive alternative (iterating
+// over cells) But it comes at a price : we must make sure that the state of
+// candidates in the grid and the "_*Values" bitsets are synchronized from the
+// start of the resolution to the backtracking call. For this we use the
+// grid_markValueFree macro
+#define grid_possible(grid, row, column, value)                          \
+    (((grid_columnValues(grid, column)[(value) / BITWORD_BITS]           \
+          | grid_rowValues(grid, row)[(value) / BITWORD_BITS]            \
+          | grid_blockValues(grid, row, column)[(value) / BITWORD_BITS]) \
+         & bitset_mask(value))                                           \
+        == 0)
+
+/// @brief Gets a word of the bitset of possible values for a cell.
+/// @param grid in: the grid
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param word in: the index of the word to get
+/// @return The values of the word for which @ref grid_possible returns @c true,
+/// as a bit mask.
+#define grid_cellPossibleValuesWord(grid, row, column, word) \
+    (~(grid_columnValues(grid, column)[word]                 \
+        | grid_rowValues(grid, row)[word]                    \
+        | grid_blockValues(grid, row, column)[word]))
 
 /// @brief Counts the number of possible values for a cell.
 /// @param grid in: the grid
@@ -65,24 +153,129 @@
 /// @param column in: the cell's column
 /// @param outVarName Name of the variable to declare and assign the result to.
 /// @return The amount of values for which @ref grid_possible returns @c true.
-#define grid_cellPossibleValuesCount(grid, row, column, outVarName) \
-    tIntSize outVarName = 0;                                        \
-    for (tIntSize val = 1; val <= grid_size(grid); val++) {             \
-        outVarName += grid_possible((grid), (row), (column), val);  \
+#define grid_cellPossibleValuesCount(grid, row, column, outVarName)                        \
+    tIntSize outVarName = 0;                                                               \
+    for (tIntSize word = 0; word < (grid)._candidateWordCount; word++) {                   \
+        outVarName += bitword_count(grid_cellPossibleValuesWord(grid, row, column, word)); \
     }
 
-tGrid grid_create(tIntN const N);
+/// @brief Gets a word of the candidates present in the last group counted with
+/// @ref grid_countGroupCandidates.
+#define grid_groupAtLeastOnce(grid, word) \
+    ((grid)._groupOccurrences[at2d((grid)._candidateWordCount, 0, word)])
+
+/// @brief Gets a word of the candidates present exactly once in the last group
+/// counted with @ref grid_countGroupCandidates.
+#define grid_groupExactlyOnce(grid, word)                                    \
+    ((grid)._groupOccurrences[at2d((grid)._candidateWordCount, 0, word)]     \
+        & ~(grid)._groupOccurrences[at2d((grid)._candidateWordCount, 1, word)])
+
+/// @brief Gets a word of the candidates present exactly twice in the last group
+/// counted with @ref grid_countGroupCandidates.
+#define grid_groupExactlyTwice(grid, word)                                   \
+    ((grid)._groupOccurrences[at2d((grid)._candidateWordCount, 1, word)]     \
+        & ~(grid)._groupOccurrences[at2d((grid)._candidateWordCount, 2, word)])
+
+/// @brief Gets the number of words of a bitset of the lines of a grid: one bit
+/// per row or column.
+#define grid_lineWordCount(grid) bitset_wordCount(grid_size(grid))
+
+/// @brief Gets the positions of a candidate in a row or a column, as mapped by
+/// @ref grid_mapCandidatePositions.
+/// @param grid in: the grid
+/// @param kind in: @ref UNIT_ROW or @ref UNIT_COLUMN
+/// @param candidate in: the candidate
+/// @param line in: the row or column index
+/// @return The bitset of the columns of the row, or the rows of the column,
+/// holding the candidate.
+#define grid_candidatePositions(grid, kind, candidate, line) \
+    (&(grid)._candidatePositions[at2d(grid_lineWordCount(grid), at3d(grid_size(grid) + 1, grid_size(grid), (kind), (candidate), (line)), 0)])
+
+/// @brief Determines whether units are queued for the logic techniques.
+#define grid_hasQueuedUnits(grid) ((grid)._unitQueueCount > 0)
+
+/// @brief Determines whether a cell of a unit has changed after a change count.
+/// @param grid in: the grid
+/// @param unit in: the unit index
+/// @param since in: a previous value of @c grid._changeCount
+#define grid_unitChangedSince(grid, unit, since) ((grid)._unitChanges[unit] > (since))
+
+/// @brief Creates a grid without allocating it.
+/// @param N in: grid size factor
+/// @param arenaReserve in: number of bytes to reserve in the arena of the grid
+/// for the solving engines, in addition to the storage of the grid
+/// @return A new grid. Must be freed with @ref grid_free.
+tGrid grid_create(tIntN const N, size_t arenaReserve);
+
+/// @brief Gets the number of bytes the storage of a grid takes in its arena.
+/// @param grid in: a grid created with @ref grid_create.
+size_t grid_arenaSize(tGrid const *grid);
+
+/// @brief Allocates the storage of a grid in its arena.
+/// @param grid in/out: a grid created with @ref grid_create.
+/// @remark The grid must then be cleared with @ref grid_clear.
+void grid_alloc(tGrid *grid);
+
+/// @brief Empties an allocated grid: no values, no candidates.
+/// @param grid in/out: the grid
+/// @remark This is the fast reset path, the storage is reused.
+/// @remark Every unit is marked as changed and the rows are queued, so that the
+/// logic techniques first examine every cell once, in row-major order.
+void grid_clear(tGrid *grid);
 
 /// @brief Loads a grid from a file in the Sud format.
 /// @param inStream in: the file to read
-/// @param N in: grid size factor
-/// @param grid out: the loaded grid.
-/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if the file
-/// contains invalid data.
+/// @param grid in/out: the grid to load into. Its storage is allocated on the
+/// first load and reused by the next ones.
+/// @return 0 if everything went well, @ref ERROR_END_OF_FILE if the file has
+/// no more data, or @ref ERROR_INVALID_DATA if the file contains invalid data.
+/// @remark Loading grids one after another reads a stream of concatenated Sud
+/// grids.
 int grid_load(FILE *inStream, tGrid *g);
 
+/// @brief Loads a grid from values in the Sud format.
+/// @param grid in/out: the grid to load into. Its storage is allocated on the
+/// first load and reused by the next ones.
+/// @param sudValues in: the SIZE² values of the grid, row by row
+/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if the values
+/// are invalid.
+int grid_loadSudValues(tGrid *g, uint32_t const *sudValues);
+
+/// @brief Determines whether a value of a grid is also the value of one of the
+/// peers of its cell.
+/// @param grid in: the grid
+/// @return Whether the grid has a conflict, in which case it has no solutions.
+/// @remark Loading a grid doesn't check for conflicts.
+bool grid_hasConflicts(tGrid const *grid);
+
+/// @brief Determines whether all the cells of a grid have a value.
+/// @param grid in: the grid
+bool grid_isFilled(tGrid const *grid);
+
+/// @brief Determines whether a grid is solved: all its cells have a value, and
+/// no value conflicts with another.
+/// @param grid in: the grid
+bool grid_isSolved(tGrid const *grid);
+
+/// @brief Gets the next possible value of a cell after a value.
+/// @param grid in: the grid
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param value in: the value to search after (0 to get the first possible value)
+/// @return The first value greater than @p value for which @ref grid_possible
+/// returns @c true, or a value greater than @ref SIZE if there is none.
+/// @remark Like @ref grid_cell_nextCandidate, but on the value bitsets of the
+/// units of the cell rather than on its candidates.
+tIntSize grid_cellNextPossibleValue(tGrid const *grid, tIntSize row,
+    tIntSize column, tIntSize value);
+
+/// @brief Stores the values of a grid in the Sud format.
+/// @param grid in: the grid
+/// @param sudValues out: filled with the SIZE² values of the grid, row by row
+void grid_storeSudValues(tGrid const *grid, uint32_t *sudValues);
+
 /// @brief Writes a grid to a file in the Sud format.
-/// @param grid in: the grid to write
+/// @param grid in: the grid to write. Its Sud buffer is overwritten.
 /// @param outStream in: the file to write to
 void grid_write(tGrid const *grid, FILE *outStream);
 
@@ -108,6 +301,45 @@ bool grid_cell_removeCandidate(tGrid *grid, tIntSize row, tIntSize column,
 void grid_cell_provideValue(tGrid *grid, tIntSize row, tIntSize column,
     tIntSize value);
 
+/// @brief Records a change of the candidates or the value of a cell: its units
+/// are marked as changed and queued for the logic techniques.
+/// @param grid in/out: the grid
+/// @param iCell in: the flat index of the cell
+void grid_markCellChanged(tGrid *grid, tIntCell iCell);
+
+/// @brief Queues the units changed after a change count for the logic
+/// techniques.
+/// @param grid in/out: the grid
+/// @param since in: a previous value of @c grid->_changeCount
+void grid_queueChangedUnits(tGrid *grid, size_t since);
+
+/// @brief Pops the first unit queued for the logic techniques.
+/// @param grid in/out: the grid. Must have queued units: see @ref
+/// grid_hasQueuedUnits.
+/// @return The unit index.
+tIntCell grid_popQueuedUnit(tGrid *grid);
+
+/// @brief Maps the positions of every candidate in the rows and columns of a
+/// grid.
+/// @param grid in/out: the grid. The result is stored in its scratch buffer: see
+/// @ref grid_candidatePositions.
+void grid_mapCandidatePositions(tGrid *grid);
+
+/// @brief Counts the occurrences of the candidates of a unit, up to three.
+/// @param grid in: the grid. The result is stored in its scratch buffer: see
+/// @ref grid_groupExactlyOnce and @ref grid_groupExactlyTwice.
+/// @param unit in: the unit index
+void grid_countGroupCandidates(tGrid const *grid, tIntCell unit);
+
+/// @brief Removes a candidate from a list of cells.
+/// @param grid in/out: the grid
+/// @param cells in: the flat indexes of the cells
+/// @param count in: the number of cells
+/// @param candidate in: the candidate to remove
+/// @return Whether progress has been made.
+bool grid_removeCandidateFromCells(tGrid *grid, tIntCell const *cells,
+    size_t count, tIntSize candidate);
+
 /// @brief Removes a candidate from all cells of a row.
 /// @param grid in/out: the grid
 /// @param row in: the row
@@ -139,88 +371,306 @@ bool grid_removeCandidateFromBlock(tGrid *grid, tIntSize row, tIntSize column,
 /// @param outStream in: the file to write to
 void grid_print(tGrid const *grid, FILE *outStream);
 
-/// @brief Prints a block separation line.
-/// @param grid in: the grid
-/// @param padding in: value padding
-/// @param outStream in: the file to write to
-void printBlockSeparationLine(tGrid const *grid, int padding, FILE *outStream);
+/// @brief Gets the length of a line of the text rendering of a grid.
+/// @remark A line starts with a separator, then each block has N values with a
+/// space on each side and ends with a separator. Then comes the newline.
+#define grid_textLineLength(grid) \
+    (1 + (grid).N * ((grid).N * ((grid)._textPadding + 2) + 1) + 1)
+
+/// @brief Gets the length of the text rendering of a grid: SIZE value lines and
+/// N + 1 block separation lines.
+#define grid_textLength(grid) \
+    ((size_t)(grid_size(grid) + (grid).N + 1) * grid_textLineLength(grid))
+
+/// @brief Gets the offset of the value of a cell in the text rendering of a
+/// grid.
+#define grid_textValueOffset(grid, row, column)                                    \
+    (((size_t)(row) + (row) / (grid).N + 1) * grid_textLineLength(grid)             \
+        + 1 + (column) / (grid).N * ((grid).N * ((grid)._textPadding + 2) + 1)     \
+        + (column) % (grid).N * ((grid)._textPadding + 2) + 1)
+
+/// @brief Renders the separators and the value table of the text rendering of
+/// an allocated grid.
+/// @param grid in/out: the grid
+/// @remark Used in @ref grid_alloc.
+void grid_renderTextTemplate(tGrid *grid);
 
-/// @brief Prints a grid row.
-/// @param grid in: @ref tGrid : the grid
-/// @param row in: index of the row to print (between 0 and @ref SIZE - 1)
-/// @param padding in: value padding
-/// @param outStream in: the file to write to
-void grid_printRow(tGrid const *grid, tIntSize row, int padding,
-    FILE *outStream);
+/// @brief Builds the unit, cell unit and peer tables of a grid.
+/// @param grid in/out: the grid
+/// @remark Used in @ref grid_alloc.
+void grid_buildUnitTables(tGrid *grid);
 
-/// @brief Prints a grid value as a number or @ref DISPLAY_EMPTY_VALUE for empty
-/// values.
-/// @param value in: the value to print
-/// @param padding in: value padding
-/// @param outStream in: the file to write to
-void printValue(tIntSize value, int padding, FILE *outStream);
+/// @brief Gets the flat indexes of the peers of a cell.
+/// @param grid in: the grid
+/// @param iCell in: the flat index of the cell
+/// @return The @ref grid_peerCount peers of the cell. For a large grid, they
+/// are only valid until the next call.
+tIntCell const *grid_cellPeers(tGrid const *grid, tIntCell iCell);
 
-/// @brief Prints a character a specific amount of times.
-/// @param character in: the character to print
-/// @param times in: amount of times
-/// @param outStream in: the file to write to
-void printMultipleTimes(char character, unsigned times, FILE *outStream);
+/// @brief Lists the peers of a cell: the row and column cells outside of the
+/// block interleaved, then the other cells of the block.
+/// @param grid in: the grid
+/// @param iCell in: the flat index of the cell
+/// @param peers out: the @ref grid_peerCount peers of the cell
+/// @remark Used in @ref grid_buildUnitTables and @ref grid_cellPeers.
+void grid_listPeers(tGrid const *grid, tIntCell iCell, tIntCell *peers);
 
 ////////////////////////////////////////////////////////////////////////////
 
-tGrid grid_create(tIntN const N) {
+tGrid grid_create(tIntN const N, size_t arenaReserve) {
     return (tGrid) {
         .N = N,
-        .cells = NULL,
-        ._isBlockFree = NULL,
-        ._isColumnFree = NULL,
-        ._isRowFree = NULL,
+        ._candidateWordCount = bitset_wordCount(N * N + 1),
+        .values = NULL,
+        ._candidateCounts = NULL,
+        ._candidates = NULL,
+        ._unitValues = NULL,
+        ._unitCells = NULL,
+        ._cellUnits = NULL,
+        ._peers = NULL,
+        ._peerBuffer = NULL,
+        ._sudValues = NULL,
+        ._groupOccurrences = NULL,
+        ._candidatePositions = NULL,
+        ._fishCovers = NULL,
+        ._unitQueue = NULL,
+        ._unitQueueFirst = 0,
+        ._unitQueueCount = 0,
+        ._isUnitQueued = NULL,
+        ._unitChanges = NULL,
+        ._changeCount = 0,
+        ._workCount = 0,
+        ._text = NULL,
+        ._textValues = NULL,
+        ._textPadding = digitCount(N * N, 10),
+        ._arena = { 0 },
+        ._arenaReserve = arenaReserve,
     };
 }
 
-int grid_load(FILE *inStream, tGrid *g) {
-#define fail_invalid_data()        \
-    do {                           \
-        free(gridValues);          \
-        return ERROR_INVALID_DATA; \
-    } while (0);
+size_t grid_arenaSize(tGrid const *g) {
+    size_t const cellCount = (size_t)grid_size(*g) * grid_size(*g);
+
+    return arena_blockSize(sizeof *g->values * cellCount)
+        + arena_blockSize(sizeof *g->_candidateCounts * cellCount)
+        + arena_blockSize(sizeof *g->_candidates * cellCount * g->_candidateWordCount)
+        + arena_blockSize(sizeof *g->_unitValues * grid_unitCount(*g) * g->_candidateWordCount)
+        + arena_blockSize(sizeof *g->_unitCells * grid_unitCount(*g) * grid_size(*g))
+        + arena_blockSize(sizeof *g->_cellUnits * cellCount * UNIT_KIND_COUNT)
+        + (grid_isLarge(*g)
+                ? arena_blockSize(sizeof *g->_peerBuffer * grid_peerCount(*g))
+                : arena_blockSize(sizeof *g->_peers * cellCount * grid_peerCount(*g)))
+        + arena_blockSize(sizeof *g->_sudValues * cellCount)
+        + arena_blockSize(sizeof *g->_groupOccurrences * 3 * g->_candidateWordCount)
+        + arena_blockSize(sizeof *g->_candidatePositions * 2 * (grid_size(*g) + 1) * grid_size(*g) * grid_lineWordCount(*g))
+        + arena_blockSize(sizeof *g->_fishCovers * (FISH_MAX_SIZE + 1) * grid_lineWordCount(*g))
+        + arena_blockSize(sizeof *g->_unitQueue * grid_unitCount(*g))
+        + arena_blockSize(sizeof *g->_isUnitQueued * grid_unitCount(*g))
+        + arena_blockSize(sizeof *g->_unitChanges * grid_unitCount(*g))
+        + arena_blockSize(sizeof *g->_text * grid_textLength(*g))
+        + arena_blockSize(sizeof *g->_textValues * (grid_size(*g) + 1) * g->_textPadding);
+}
+
+void grid_alloc(tGrid *g) {
+    size_t const cellCount = (size_t)grid_size(*g) * grid_size(*g);
+
+    g->_arena = arena_create(grid_arenaSize(g) + g->_arenaReserve);
+
+    // Allocate the fields of the cells in separate arrays
+    g->values = check_alloc(arena_array(&g->_arena, g->values, cellCount),
+        "grid values array");
+    g->_candidateCounts = check_alloc(arena_array(&g->_arena, g->_candidateCounts, cellCount),
+        "grid _candidateCounts array");
+
+    // Allocate the candidate bitsets of all cells in a single block
+    g->_candidates = check_alloc(arena_array(&g->_arena, g->_candidates, cellCount * g->_candidateWordCount),
+        "grid candidates array");
+
+    // Allocate row, column and block bitsets and tables
+    g->_unitValues = check_alloc(arena_array(&g->_arena, g->_unitValues, grid_unitCount(*g) * g->_candidateWordCount),
+        "grid _unitValues array");
+    g->_unitCells = check_alloc(arena_array(&g->_arena, g->_unitCells, grid_unitCount(*g) * grid_size(*g)),
+        "grid _unitCells array");
+    g->_cellUnits = check_alloc(arena_array(&g->_arena, g->_cellUnits, cellCount * UNIT_KIND_COUNT),
+        "grid _cellUnits array");
+    if (grid_isLarge(*g)) {
+        g->_peerBuffer = check_alloc(arena_array(&g->_arena, g->_peerBuffer, grid_peerCount(*g)),
+            "grid _peerBuffer array");
+    } else {
+        g->_peers = check_alloc(arena_array(&g->_arena, g->_peers, cellCount * grid_peerCount(*g)),
+            "grid _peers array");
+    }
+    grid_buildUnitTables(g);
 
     // As the .sud files only contain the grid values, we need a temporary integer
     // grid to store them.
-    uint32_t *gridValues = check_alloc(array2d_malloc(gridValues, grid_size(*g), grid_size(*g)), "gridValues");
+    g->_sudValues = check_alloc(arena_array(&g->_arena, g->_sudValues, cellCount),
+        "grid _sudValues array");
+
+    g->_groupOccurrences = check_alloc(arena_array(&g->_arena, g->_groupOccurrences, 3 * g->_candidateWordCount),
+        "grid _groupOccurrences array");
+
+    g->_candidatePositions = check_alloc(arena_array(&g->_arena, g->_candidatePositions, 2 * (grid_size(*g) + 1) * grid_size(*g) * grid_lineWordCount(*g)),
+        "grid _candidatePositions array");
+    g->_fishCovers = check_alloc(arena_array(&g->_arena, g->_fishCovers, (FISH_MAX_SIZE + 1) * grid_lineWordCount(*g)),
+        "grid _fishCovers array");
+
+    g->_unitQueue = check_alloc(arena_array(&g->_arena, g->_unitQueue, grid_unitCount(*g)),
+        "grid _unitQueue array");
+    g->_isUnitQueued = check_alloc(arena_array(&g->_arena, g->_isUnitQueued, grid_unitCount(*g)),
+        "grid _isUnitQueued array");
+    g->_unitChanges = check_alloc(arena_array(&g->_arena, g->_unitChanges, grid_unitCount(*g)),
+        "grid _unitChanges array");
+
+    g->_text = check_alloc(arena_array(&g->_arena, g->_text, grid_textLength(*g)),
+        "grid _text array");
+    g->_textValues = check_alloc(arena_array(&g->_arena, g->_textValues, (grid_size(*g) + 1) * g->_textPadding),
+        "grid _textValues array");
+    grid_renderTextTemplate(g);
+}
+
+void grid_renderTextTemplate(tGrid *g) {
+    size_t const lineLength = grid_textLineLength(*g);
+    tIntSize const blockWidth = g->N * (g->_textPadding + 2);
+
+    // Block separation lines come before each block of rows and at the end
+    for (tIntSize line = 0; line < grid_size(*g) + g->N + 1; line++) {
+        char *text = &g->_text[line * lineLength];
+        bool const isSeparation = line % (g->N + 1) == 0;
+
+        *text++ = isSeparation ? DISPLAY_INTERSECTION : DISPLAY_VERTICAL_LINE;
+        for (tIntSize block = 0; block < g->N; block++) {
+            memset(text, isSeparation ? DISPLAY_HORIZONTAL_LINE : DISPLAY_SPACE, blockWidth);
+            text += blockWidth;
+            *text++ = isSeparation ? DISPLAY_INTERSECTION : DISPLAY_VERTICAL_LINE;
+        }
+        *text = '\n';
+    }
+
+    // Values are right-aligned, the empty value is a dot
+    for (tIntSize value = 0; value <= grid_size(*g); value++) {
+        char *field = &g->_textValues[value * g->_textPadding];
+        memset(field, DISPLAY_SPACE, g->_textPadding);
+        if (value == 0) {
+            field[g->_textPadding - 1] = DISPLAY_EMPTY_VALUE;
+        }
+        for (tIntSize n = value, i = g->_textPadding; n != 0; n /= 10) {
+            field[--i] = '0' + n % 10;
+        }
+    }
+}
+
+void grid_buildUnitTables(tGrid *g) {
+    tIntSize const size = grid_size(*g);
+
+    for (tIntSize r = 0; r < size; r++) {
+        for (tIntSize c = 0; c < size; c++) {
+            tIntCell const iCell = at2d(size, r, c);
+            tIntSize const block = at2d(g->N, r / g->N, c / g->N);
+            tIntSize const iInBlock = at2d(g->N, r % g->N, c % g->N);
+
+            grid_cellUnit(*g, iCell, UNIT_ROW) = r;
+            grid_cellUnit(*g, iCell, UNIT_COLUMN) = c;
+            grid_cellUnit(*g, iCell, UNIT_BLOCK) = block;
+
+            grid_unitCells(*g, grid_unit(*g, UNIT_ROW, r))[c] = iCell;
+            grid_unitCells(*g, grid_unit(*g, UNIT_COLUMN, c))[r] = iCell;
+            grid_unitCells(*g, grid_unit(*g, UNIT_BLOCK, block))[iInBlock] = iCell;
+        }
+    }
+
+    if (!grid_isLarge(*g)) {
+        tIntCell const cellCount = (tIntCell)size * size;
+        for (tIntCell iCell = 0; iCell < cellCount; iCell++) {
+            grid_listPeers(g, iCell, &g->_peers[at2d(grid_peerCount(*g), iCell, 0)]);
+        }
+    }
+}
+
+tIntCell const *grid_cellPeers(tGrid const *grid, tIntCell iCell) {
+    if (grid->_peers != NULL) {
+        return &grid->_peers[at2d(grid_peerCount(*grid), iCell, 0)];
+    }
+    grid_listPeers(grid, iCell, grid->_peerBuffer);
+    return grid->_peerBuffer;
+}
+
+void grid_listPeers(tGrid const *grid, tIntCell iCell, tIntCell *peers) {
+    tIntSize const size = grid_size(*grid);
+    tIntSize const r = iCell / size, c = iCell % size;
+    tIntSize const blockRow = r - r % grid->N, blockCol = c - c % grid->N;
+
+    for (tIntSize i = 0; i < size; i++) {
+        if (i < blockCol || i >= blockCol + grid->N) *peers++ = at2d(size, r, i);
+        if (i < blockRow || i >= blockRow + grid->N) *peers++ = at2d(size, i, c);
+    }
+    for (tIntSize br = blockRow; br < blockRow + grid->N; br++) {
+        for (tIntSize bc = blockCol; bc < blockCol + grid->N; bc++) {
+            if (br != r || bc != c) *peers++ = at2d(size, br, bc);
+        }
+    }
+}
 
-    if (fread(gridValues, sizeof *gridValues, grid_size(*g) * grid_size(*g), inStream) != grid_size(*g) * grid_size(*g)) fail_invalid_data();
+void grid_clear(tGrid *g) {
+    size_t const cellCount = (size_t)grid_size(*g) * grid_size(*g);
+    memset(g->values, 0, sizeof *g->values * cellCount);
+    memset(g->_candidateCounts, 0, sizeof *g->_candidateCounts * cellCount);
+    memset(g->_candidates, 0, sizeof *g->_candidates * cellCount * g->_candidateWordCount);
+
+    // Mark bit 0 and the padding bits as present so that the complement of the
+    // bitsets only contains actual free values
+    tIntSize const lastWord = g->_candidateWordCount - 1;
+    tBitWord const lastWordPadding = (grid_size(*g) + 1) % BITWORD_BITS == 0
+        ? 0
+        : ~(tBitWord)0 << ((grid_size(*g) + 1) % BITWORD_BITS);
+
+    for (tIntCell unit = 0; unit < grid_unitCount(*g); unit++) {
+        for (tIntSize word = 0; word <= lastWord; word++) {
+            grid_unitValues(*g, unit)[word] = (word == 0 ? 1 : 0) | (word == lastWord ? lastWordPadding : 0);
+        }
+    }
 
-    // Allocate and initialize all cells to 0 (candidates array is NULL, no value,
-    // 0 candidates)
-    g->cells = check_alloc(array2d_calloc(g->cells, grid_size(*g), grid_size(*g)),
-        "grid cells array");
+    // Everything has changed, and examining the cells of the rows covers them
+    // all
+    g->_changeCount = 1;
+    g->_workCount = 0;
+    g->_unitQueueFirst = 0;
+    g->_unitQueueCount = grid_size(*g);
+    for (tIntCell unit = 0; unit < grid_unitCount(*g); unit++) {
+        g->_unitChanges[unit] = g->_changeCount;
+        g->_isUnitQueued[unit] = unit < grid_size(*g);
+        g->_unitQueue[unit] = unit;
+    }
+}
 
-    // Allocate row, column and block arrays
-    g->_isColumnFree = check_alloc(array2d_malloc(g->_isColumnFree, grid_size(*g), grid_size(*g) + 1),
-        "grid _isColumnFree array");
-    g->_isRowFree = check_alloc(array2d_malloc(g->_isRowFree, grid_size(*g), grid_size(*g) + 1),
-        "grid _isRowFree array");
-    g->_isBlockFree = check_alloc(array3d_malloc(g->_isBlockFree, g->N, g->N, grid_size(*g) + 1),
-        "grid _isBlockFree array");
+int grid_load(FILE *inStream, tGrid *g) {
+    if (g->values == NULL) {
+        grid_alloc(g);
+    }
 
-    // Initialize all rows, columns and blocks to free
-    memset(g->_isRowFree, true, sizeof(bool) * grid_size(*g) * (grid_size(*g) + 1));
-    memset(g->_isColumnFree, true, sizeof(bool) * grid_size(*g) * (grid_size(*g) + 1));
-    memset(g->_isBlockFree, true, sizeof(bool) * g->N * g->N * (grid_size(*g) + 1));
+    size_t const cellCount = (size_t)grid_size(*g) * grid_size(*g);
+    size_t const readCount = fread(g->_sudValues, sizeof *g->_sudValues, cellCount, inStream);
+    if (readCount == 0 && feof(inStream)) return ERROR_END_OF_FILE;
+    if (readCount != cellCount) return ERROR_INVALID_DATA;
+
+    return grid_loadSudValues(g, g->_sudValues);
+}
+
+int grid_loadSudValues(tGrid *g, uint32_t const *sudValues) {
+    if (g->values == NULL) {
+        grid_alloc(g);
+    }
+
+    grid_clear(g);
 
     // Initialize cells and mark them as not free
     for (tIntSize r = 0; r < grid_size(*g); r++) {
         for (tIntSize c = 0; c < grid_size(*g); c++) {
-            tIntSize value = gridValues[at2d(grid_size(*g), r, c)];
-            tCell *cell = &grid_cellAt(*g, r, c);
-
-            cell->hasCandidate = check_alloc(array_calloc(cell->hasCandidate, grid_size(*g) + 1),
-                "grid cell %d,%d hasCandidate array", r, c);
+            uint32_t value = sudValues[at2d(grid_size(*g), r, c)];
 
             if (value != 0) {
-                if (value > grid_size(*g)) fail_invalid_data();
-                cell->_value = value;
+                if (value > grid_size(*g)) return ERROR_INVALID_DATA;
+                cell_value(grid_cellAt(*g, r, c)) = value;
                 grid_markValueFree(false, *g, r, c, value);
             }
         }
@@ -229,60 +679,61 @@ int grid_load(FILE *inStream, tGrid *g) {
     // Add candidates
     for (tIntSize r = 0; r < grid_size(*g); r++) {
         for (tIntSize c = 0; c < grid_size(*g); c++) {
-            tCell *cell = &grid_cellAt(*g, r, c);
+            tCell const cell = grid_cellAt(*g, r, c);
             // No need to compute the candidates of a cell that already has a value.
-            if (!cell_hasValue(*cell)) {
-                // compute the cell's candidates
-                for (tIntSize candidate = 1; candidate <= grid_size(*g); candidate++) {
-                    bool possible = grid_possible(*g, r, c, candidate);
-                    // add the candidate
-                    cell->hasCandidate[candidate] = possible;
-                    cell->_candidateCount += possible;
+            if (!cell_hasValue(cell)) {
+                // compute the cell's candidates: its possible values
+                for (tIntSize word = 0; word < g->_candidateWordCount; word++) {
+                    cell.candidates[word] = grid_cellPossibleValuesWord(*g, r, c, word);
                 }
+                cell_candidate_count(cell) = bitset_count(cell.candidates, g->_candidateWordCount);
             }
         }
     }
 
-    free(gridValues);
     return 0;
 }
 
-void grid_free(tGrid *grid) {
-    for (tIntSize r = 0; r < grid_size(*grid); r++) {
-        for (tIntSize c = 0; c < grid_size(*grid); c++) {
-            free(grid_cellAt(*grid, r, c).hasCandidate);
-        }
+void grid_storeSudValues(tGrid const *grid, uint32_t *sudValues) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+    for (tIntCell iCell = 0; iCell < cellCount; iCell++) {
+        sudValues[iCell] = grid->values[iCell];
     }
-    free(grid->cells);
-    free(grid->_isBlockFree);
-    free(grid->_isColumnFree);
-    free(grid->_isRowFree);
+}
+
+void grid_free(tGrid *grid) {
+    // All the storage of the grid lives in its arena
+    arena_free(&grid->_arena);
 }
 
 bool grid_cell_removeCandidate(tGrid *grid, tIntSize row, tIntSize column,
     tIntSize candidate) {
-    tCell *cell = &grid_cellAt(*grid, row, column);
+    tCell const cell = grid_cellAt(*grid, row, column);
 
     assert(1 <= candidate && candidate <= grid_size(*grid));
 
     // If the cell has only one candidate remaining and it's the one we want to
     // remove, set it as the cell's value and remove it.
-    if (cell_candidate_count(*cell) == 1) {
-        cell_get_first_candidate(*cell, onlyCandidate);
+    if (cell_candidate_count(cell) == 1) {
+        cell_get_first_candidate(cell, onlyCandidate);
         if (onlyCandidate == candidate) {
-            cell->_value = onlyCandidate;
-            cell->hasCandidate[candidate] = false;
-            cell->_candidateCount = 0;
+            cell_value(cell) = onlyCandidate;
+            bitset_remove(cell.candidates, candidate);
+            cell_candidate_count(cell) = 0;
             grid_markValueFree(false, *grid, row, column, candidate);
+            grid_markCellChanged(grid, at2d(grid_size(*grid), row, column));
+            stats_add(grid->stats, placed, 1);
             return true;
         }
     }
 
     // Otherwise proceed as usual
-    bool possible = cell_hasCandidate(*cell, candidate);
+    bool possible = cell_hasCandidate(cell, candidate);
     if (possible) {
-        cell->hasCandidate[candidate] = false;
-        cell->_candidateCount--;
+        bitset_remove(cell.candidates, candidate);
+        cell_candidate_count(cell)--;
+        grid_markCellChanged(grid, at2d(grid_size(*grid), row, column));
+        stats_add(grid->stats, eliminated, 1);
     }
 
     return possible;
@@ -292,121 +743,183 @@ void grid_cell_provideValue(tGrid *grid, tIntSize row, tIntSize column,
     tIntSize value) {
     assert(grid_possible(*grid, row, column, value));
 
-    tCell *cell = &grid_cellAt(*grid, row, column);
+    tCell const cell = grid_cellAt(*grid, row, column);
 
     assert(1 <= value && value <= grid_size(*grid));
-    assert(!cell_hasValue(*cell));
+    assert(!cell_hasValue(cell));
 
-    cell->_value = value;
-    cell->_candidateCount = 0;
-    memset(cell->hasCandidate, false, sizeof(bool) * grid_size(*grid) + 1);
+    cell_value(cell) = value;
+    cell_candidate_count(cell) = 0;
+    memset(cell.candidates, 0, sizeof *cell.candidates * grid->_candidateWordCount);
     grid_markValueFree(false, *grid, row, column, value);
+    grid_markCellChanged(grid, at2d(grid_size(*grid), row, column));
+    stats_add(grid->stats, placed, 1);
 }
 
-bool grid_removeCandidateFromRow(tGrid *grid, tIntSize row,
-    tIntSize candidate) {
-    bool progress = false;
-    for (tIntSize c = 0; c < grid_size(*grid); c++) {
-        progress |= grid_cell_removeCandidate(grid, row, c, candidate);
+void grid_markCellChanged(tGrid *grid, tIntCell iCell) {
+    grid->_changeCount++;
+
+    for (tUnitKind kind = 0; kind < UNIT_KIND_COUNT; kind++) {
+        tIntCell const unit = grid_unit(*grid, kind, grid_cellUnit(*grid, iCell, kind));
+
+        grid->_unitChanges[unit] = grid->_changeCount;
+        if (!grid->_isUnitQueued[unit]) {
+            grid->_isUnitQueued[unit] = true;
+            grid->_unitQueue[(grid->_unitQueueFirst + grid->_unitQueueCount++) % grid_unitCount(*grid)] = unit;
+        }
     }
-    return progress;
 }
 
-bool grid_removeCandidateFromColumn(tGrid *grid, tIntSize column,
-    tIntSize candidate) {
-    bool progress = false;
-    for (tIntSize r = 0; r < grid_size(*grid); r++) {
-        progress |= grid_cell_removeCandidate(grid, r, column, candidate);
+void grid_queueChangedUnits(tGrid *grid, size_t since) {
+    for (tIntCell unit = 0; unit < grid_unitCount(*grid); unit++) {
+        if (grid_unitChangedSince(*grid, unit, since) && !grid->_isUnitQueued[unit]) {
+            grid->_isUnitQueued[unit] = true;
+            grid->_unitQueue[(grid->_unitQueueFirst + grid->_unitQueueCount++) % grid_unitCount(*grid)] = unit;
+        }
     }
-    return progress;
 }
 
-bool grid_removeCandidateFromBlock(tGrid *grid, tIntSize row, tIntSize column,
-    tIntSize candidate) {
-    bool progress = false;
+tIntCell grid_popQueuedUnit(tGrid *grid) {
+    assert(grid_hasQueuedUnits(*grid));
+
+    tIntCell const unit = grid->_unitQueue[grid->_unitQueueFirst];
+    grid->_unitQueueFirst = (grid->_unitQueueFirst + 1) % grid_unitCount(*grid);
+    grid->_unitQueueCount--;
+    grid->_isUnitQueued[unit] = false;
+
+    return unit;
+}
 
-    tIntSize const blockRow = grid_blockIndex(*grid, row);
-    tIntSize const blockCol = grid_blockIndex(*grid, column);
+bool grid_hasConflicts(tGrid const *grid) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
 
-    for (tIntSize r = blockRow; r < blockRow + grid->N; r++) {
-        for (tIntSize c = blockCol; c < blockCol + grid->N; c++) {
-            progress |= grid_cell_removeCandidate(grid, r, c, candidate);
+    for (tIntCell iCell = 0; iCell < cellCount; iCell++) {
+        tIntSize const value = grid->values[iCell];
+        if (value != 0) {
+            tIntCell const *peers = grid_cellPeers(grid, iCell);
+            for (tIntCell i = 0; i < grid_peerCount(*grid); i++) {
+                if (grid->values[peers[i]] == value) {
+                    return true;
+                }
+            }
         }
     }
 
-    return progress;
+    return false;
 }
 
-void grid_write(tGrid const *grid, FILE *outStream) {
-    for (tIntSize r = 0; r < grid_size(*grid); r++) {
-        for (tIntSize c = 0; c < grid_size(*grid); c++) {
-            uint32_t value32 = grid_cellAt(*grid, r, c)._value;
-            fwrite(&value32, sizeof(uint32_t), 1, outStream);
+bool grid_isFilled(tGrid const *grid) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+
+    for (tIntCell iCell = 0; iCell < cellCount; iCell++) {
+        if (grid->values[iCell] == 0) {
+            return false;
         }
     }
+
+    return true;
 }
 
-void grid_print(tGrid const *grid, FILE *outStream) {
-    // Print grid body
-    int padding = digitCount(grid_size(*grid), 10);
+bool grid_isSolved(tGrid const *grid) {
+    return grid_isFilled(grid) && !grid_hasConflicts(grid);
+}
 
-    for (tIntSize block = 0; block < grid->N; block++) {
-        printBlockSeparationLine(grid, padding, outStream);
+tIntSize grid_cellNextPossibleValue(tGrid const *grid, tIntSize row,
+    tIntSize column, tIntSize value) {
+    tIntSize word = (value + 1) / BITWORD_BITS;
+    if (word >= grid->_candidateWordCount) {
+        return grid->_candidateWordCount * BITWORD_BITS;
+    }
 
-        // For eahc line in the block:
-        for (tIntSize blockRow = 0; blockRow < grid->N; blockRow++) {
-            // Find the actual line and print it
-            grid_printRow(grid, block * grid->N + blockRow, padding, outStream);
+    // Mask out the values up to the starting one in its word. Bit 0 and the
+    // padding bits are present in the units, so they are never possible.
+    tBitWord possibleValues = grid_cellPossibleValuesWord(*grid, row, column, word)
+        & (~(tBitWord)0 << ((value + 1) % BITWORD_BITS));
+
+    while (possibleValues == 0) {
+        if (++word == grid->_candidateWordCount) {
+            return grid->_candidateWordCount * BITWORD_BITS;
         }
+        possibleValues = grid_cellPossibleValuesWord(*grid, row, column, word);
     }
 
-    // Print the last separation line all the way down
-    printBlockSeparationLine(grid, padding, outStream);
+    return word * BITWORD_BITS + bitword_first(possibleValues);
 }
 
-void printBlockSeparationLine(tGrid const *grid, int padding, FILE *outStream) {
-    putc(DISPLAY_INTERSECTION, outStream);
+void grid_mapCandidatePositions(tGrid *grid) {
+    memset(grid->_candidatePositions, 0,
+        sizeof *grid->_candidatePositions * 2 * (grid_size(*grid) + 1) * grid_size(*grid) * grid_lineWordCount(*grid));
 
-    for (tIntSize block = 0; block < grid->N; block++) {
-        // Add 2 to account for horizontal value margin (1 space left and right)
-        printMultipleTimes(DISPLAY_HORIZONTAL_LINE, grid->N * (padding + 2),
-            outStream);
-        putc(DISPLAY_INTERSECTION, outStream);
+    for (tIntSize r = 0; r < grid_size(*grid); r++) {
+        for (tIntSize c = 0; c < grid_size(*grid); c++) {
+            tCell const cell = grid_cellAt(*grid, r, c);
+            for (unsigned candidate = grid_cell_nextCandidate(*grid, cell, 0);
+                candidate <= grid_size(*grid);
+                candidate = grid_cell_nextCandidate(*grid, cell, candidate)) {
+                bitset_add(grid_candidatePositions(*grid, UNIT_ROW, candidate, r), c);
+                bitset_add(grid_candidatePositions(*grid, UNIT_COLUMN, candidate, c), r);
+            }
+        }
     }
-
-    putc('\n', outStream);
 }
 
-void grid_printRow(tGrid const *grid, tIntSize row, int padding,
-    FILE *outStream) {
-    putc(DISPLAY_VERTICAL_LINE, outStream);
+void grid_countGroupCandidates(tGrid const *grid, tIntCell unit) {
+    tIntSize const wordCount = grid->_candidateWordCount;
+    tBitWord *once = &grid->_groupOccurrences[at2d(wordCount, 0, 0)];
+    tBitWord *twice = &grid->_groupOccurrences[at2d(wordCount, 1, 0)];
+    tBitWord *thrice = &grid->_groupOccurrences[at2d(wordCount, 2, 0)];
 
-    // Print line content
-    for (tIntSize block = 0; block < grid->N; block++) {
-        for (tIntSize blockCol = 0; blockCol < grid->N; blockCol++) {
-            printValue(grid_cellAt(*grid, row, block * grid->N + blockCol)._value,
-                padding, outStream);
-        }
-        putc(DISPLAY_VERTICAL_LINE, outStream);
+    memset(grid->_groupOccurrences, 0, sizeof *grid->_groupOccurrences * 3 * wordCount);
+
+    for (tIntSize word = 0; word < wordCount; word++) {
+        bitword_countOccurrences(&grid->_candidates[word], grid_unitCells(*grid, unit), wordCount,
+            grid_size(*grid), &once[word], &twice[word], &thrice[word]);
     }
+}
 
-    putc('\n', outStream);
+bool grid_removeCandidateFromCells(tGrid *grid, tIntCell const *cells,
+    size_t count, tIntSize candidate) {
+    bool progress = false;
+    for (size_t i = 0; i < count; i++) {
+        tPosition const pos = grid_cellPosition(*grid, cells[i]);
+        progress |= grid_cell_removeCandidate(grid, pos.row, pos.column, candidate);
+    }
+    return progress;
 }
 
-void printValue(tIntSize value, int padding, FILE *outStream) {
-    putc(DISPLAY_SPACE, outStream);
+bool grid_removeCandidateFromRow(tGrid *grid, tIntSize row,
+    tIntSize candidate) {
+    return grid_removeCandidateFromCells(grid, grid_unitCells(*grid, grid_unit(*grid, UNIT_ROW, row)),
+        grid_size(*grid), candidate);
+}
 
-    if (value == 0) {
-        fprintf(outStream, "%*c", padding, DISPLAY_EMPTY_VALUE);
-    } else {
-        fprintf(outStream, "%*d", padding, value);
-    }
+bool grid_removeCandidateFromColumn(tGrid *grid, tIntSize column,
+    tIntSize candidate) {
+    return grid_removeCandidateFromCells(grid, grid_unitCells(*grid, grid_unit(*grid, UNIT_COLUMN, column)),
+        grid_size(*grid), candidate);
+}
 
-    putc(DISPLAY_SPACE, outStream);
+bool grid_removeCandidateFromBlock(tGrid *grid, tIntSize row, tIntSize column,
+    tIntSize candidate) {
+    return grid_removeCandidateFromCells(grid, grid_unitCells(*grid, grid_unit(*grid, UNIT_BLOCK, grid_blockAt(*grid, row, column))),
+        grid_size(*grid), candidate);
+}
+
+void grid_write(tGrid const *grid, FILE *outStream) {
+    // Serialize the values in the Sud buffer to write them in a single call
+    grid_storeSudValues(grid, grid->_sudValues);
+    fwrite(grid->_sudValues, sizeof *grid->_sudValues, (size_t)grid_size(*grid) * grid_size(*grid), outStream);
 }
 
-void printMultipleTimes(char character, unsigned times, FILE *outStream) {
-    for (unsigned time = 0; time < times; time++) {
-        putc(character, outStream);
+void grid_print(tGrid const *grid, FILE *outStream) {
+    // Fill the values in the rendering and write it in a single call
+    for (tIntSize r = 0; r < grid_size(*grid); r++) {
+        for (tIntSize c = 0; c < grid_size(*grid); c++) {
+            memcpy(&grid->_text[grid_textValueOffset(*grid, r, c)],
+                &grid->_textValues[cell_value(grid_cellAt(*grid, r, c)) * grid->_textPadding],
+                grid->_textPadding);
+        }
     }
+
+    fwrite(grid->_text, sizeof *grid->_text, grid_textLength(*grid), outStream);
 }
@@ -0,0 +1,327 @@
+/** @file
+ * @brief Sud input
+ * @author 5cover, Matteo-K
+ *
+ * Reads Sud grids from a file or from standard input.
+ *
+ * Regular files are memory-mapped, and the grids are loaded straight from the
+ * mapping without being copied in a buffer first. Other inputs, such as pipes,
+ * are read with stdio.
+ *
+ * Like the stdio path, reading the values in place assumes a little-endian
+ * host.
+ *
+ * Inputs in the packed format are detected by their magic number, and decoded
+ * from the mapping, or from a read-ahead buffer with stdio.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "const.c"
+#include "grid.c"
+#include "memdbg.c"
+#include "packed.c"
+#include "types.c"
+
+/// @brief Integer: size of the read-ahead buffer of a packed input read with
+/// stdio, in grids.
+#define INPUT_READ_AHEAD_GRIDS 64
+
+/// @brief A Sud input
+typedef struct {
+    /// @brief The input stream.
+    FILE *stream;
+
+    /// @brief Memory mapping of the input, or NULL if it is read with stdio.
+    uint8_t const *mapping;
+
+    /// @brief Size of @ref mapping, in bytes.
+    size_t mappingSize;
+
+    /// @brief Offset of the next grid in @ref mapping, in bytes.
+    size_t offset;
+
+    /// @brief Header of the input if it is in the packed format. N is 0 for
+    /// the Sud format.
+    tPackedHeader packed;
+
+    /// @brief Number of packed grids yet to be read, or @ref
+    /// PACKED_COUNT_UNKNOWN.
+    uint32_t packedRemaining;
+
+    /// @brief Bytes read ahead with stdio: the start of a Sud input, or packed
+    /// grids. Those in [readAheadFirst ; readAheadEnd[ are yet to be consumed.
+    uint8_t *readAhead;
+    size_t readAheadFirst, readAheadEnd, readAheadCapacity;
+} tInput;
+
+/// @brief Determines whether an input is memory-mapped.
+#define input_isMapped(input) ((input).mapping != NULL)
+
+/// @brief Determines whether an input is in the packed format.
+#define input_isPacked(input) ((input).packed.N != 0)
+
+/// @brief Opens an input.
+/// @param input out: the input
+/// @param path in: the path of the file to read, or NULL for standard input
+/// @return Whether the input could be opened. If not, @c errno is set.
+/// @remark The input must be closed with @ref input_close.
+/// @remark The format is detected here. An invalid packed header is reported
+/// by the first read.
+bool input_open(tInput *input, char const *path);
+
+/// @brief Closes an input.
+/// @param input in/out: the input to close
+void input_close(tInput *input);
+
+/// @brief Loads the next grid of an input.
+/// @param input in/out: the input
+/// @param grid in/out: the grid to load into
+/// @return 0 if everything went well, @ref ERROR_END_OF_FILE if the input has no
+/// more grids, or @ref ERROR_INVALID_DATA if the grid is invalid or truncated.
+int input_nextGrid(tInput *input, tGrid *grid);
+
+/// @brief Reads the next grids of an input.
+/// @param input in/out: the input
+/// @param cellCount in: the number of cells of a grid
+/// @param maxCount in: the maximum number of grids to read
+/// @param buffer out: room for @p maxCount grids. Only used when the input isn't
+/// memory-mapped.
+/// @param grids out: assigned to the Sud values of the grids read: in the
+/// mapping, or @p buffer.
+/// @param count out: assigned to the number of grids read
+/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if the input
+/// ends with a truncated grid after the grids read.
+/// @remark Packed grids are decoded in @p buffer.
+int input_readGrids(tInput *input, size_t cellCount, size_t maxCount,
+    uint32_t *buffer, uint32_t const **grids, size_t *count);
+
+/// @brief Reads bytes of an input read with stdio, the bytes read ahead first.
+/// @param input in/out: the input
+/// @param dst out: the bytes read
+/// @param size in: the maximum number of bytes to read
+/// @return The number of bytes read.
+/// @remark Used in @ref input_nextGrid and @ref input_readGrids.
+size_t input_read(tInput *input, void *dst, size_t size);
+
+/// @brief Decodes the next grid of a packed input.
+/// @param input in/out: the input
+/// @param N in: grid size factor the input must have
+/// @param sudValues out: the Sud values of the grid
+/// @return 0 if everything went well, @ref ERROR_END_OF_FILE if the input has no
+/// more grids, or @ref ERROR_INVALID_DATA if the grid is truncated or malformed,
+/// or the input isn't of size @p N.
+/// @remark Used in @ref input_nextGrid and @ref input_readGrids.
+int input_nextPackedGrid(tInput *input, tIntN N, uint32_t *sudValues);
+
+/////////////////////////////////////////////////////////////////////////
+
+bool input_open(tInput *input, char const *path) {
+    *input = (tInput) {
+        .stream = path == NULL ? stdin : fopen(path, "rb"),
+        .mapping = NULL,
+        .mappingSize = 0,
+        .offset = 0,
+        .packed = { .N = 0 },
+        .readAhead = NULL,
+        .readAheadFirst = 0,
+        .readAheadEnd = 0,
+        .readAheadCapacity = 0,
+    };
+
+    if (input->stream == NULL) {
+        return false;
+    }
+
+    // Map regular files, starting from the current position for standard input.
+    // Otherwise, or if the mapping fails, fall back to stdio.
+    int const fd = fileno(input->stream);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            off_t const position = lseek(fd, 0, SEEK_CUR);
+            madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+            input->mapping = mapping;
+            input->mappingSize = st.st_size;
+            input->offset = position < 0 ? 0 : min((size_t)position, input->mappingSize);
+        }
+    }
+
+    // Detect the format
+    uint8_t header[PACKED_HEADER_SIZE];
+    size_t headerSize;
+    if (input_isMapped(*input)) {
+        headerSize = min(sizeof header, input->mappingSize - input->offset);
+        memcpy(header, input->mapping + input->offset, headerSize);
+    } else {
+        // Keep what was read for the Sud format
+        input->readAheadCapacity = sizeof header;
+        input->readAhead = check_alloc(malloc(input->readAheadCapacity), "input read-ahead buffer");
+        headerSize = input->readAheadEnd = fread(input->readAhead, 1, sizeof header, input->stream);
+        memcpy(header, input->readAhead, headerSize);
+    }
+
+    if (headerSize >= 4 && packed_isMagic(header)) {
+        if (headerSize < sizeof header || packed_parseHeader(header, &input->packed) != 0) {
+            // Unknown flags: reported as invalid data by the first read
+            input->packed = (tPackedHeader) { .N = UINT8_MAX, .flags = UINT8_MAX, .count = 0 };
+        }
+        input->packedRemaining = input->packed.count;
+        input->offset += sizeof header;
+        input->readAheadFirst = input->readAheadEnd;
+    }
+
+    return true;
+}
+
+void input_close(tInput *input) {
+    if (input_isMapped(*input)) {
+        munmap((void *)input->mapping, input->mappingSize);
+    }
+    if (input->stream != NULL && input->stream != stdin) {
+        fclose(input->stream);
+    }
+    free(input->readAhead);
+}
+
+int input_nextGrid(tInput *input, tGrid *grid) {
+    if (input_isPacked(*input)) {
+        if (grid->values == NULL) {
+            grid_alloc(grid);
+        }
+        int const result = input_nextPackedGrid(input, grid->N, grid->_sudValues);
+        return result == 0 ? grid_loadSudValues(grid, grid->_sudValues) : result;
+    }
+
+    if (!input_isMapped(*input)) {
+        if (grid->values == NULL) {
+            grid_alloc(grid);
+        }
+        size_t const cellCount = (size_t)grid_size(*grid) * grid_size(*grid);
+        size_t const readSize = input_read(input, grid->_sudValues, sizeof *grid->_sudValues * cellCount);
+        if (readSize == 0) return ERROR_END_OF_FILE;
+        if (readSize != sizeof *grid->_sudValues * cellCount) return ERROR_INVALID_DATA;
+        return grid_loadSudValues(grid, grid->_sudValues);
+    }
+
+    size_t const gridBytes = sizeof(uint32_t) * grid_size(*grid) * grid_size(*grid);
+    size_t const remaining = input->mappingSize - input->offset;
+
+    if (remaining == 0) return ERROR_END_OF_FILE;
+    if (remaining < gridBytes) return ERROR_INVALID_DATA;
+
+    // Grids are 4-byte aligned in the page-aligned mapping
+    uint32_t const *values = (uint32_t const *)(input->mapping + input->offset);
+    input->offset += gridBytes;
+
+    return grid_loadSudValues(grid, values);
+}
+
+int input_readGrids(tInput *input, size_t cellCount, size_t maxCount,
+    uint32_t *buffer, uint32_t const **grids, size_t *count) {
+    size_t const gridBytes = sizeof(uint32_t) * cellCount;
+    size_t byteCount;
+
+    if (input_isPacked(*input)) {
+        tIntN const N = input->packed.N;
+        int result = (size_t)(N * N) * (N * N) == cellCount ? 0 : ERROR_INVALID_DATA;
+        *grids = buffer;
+        if (result != 0) {
+            *count = 0;
+            return result;
+        }
+        for (*count = 0; *count < maxCount; ++*count) {
+            result = input_nextPackedGrid(input, N, &buffer[*count * cellCount]);
+            if (result != 0) {
+                break;
+            }
+        }
+        return result == ERROR_END_OF_FILE ? 0 : result;
+    }
+
+    if (input_isMapped(*input)) {
+        size_t const remaining = input->mappingSize - input->offset;
+        *count = min(maxCount, remaining / gridBytes);
+        *grids = (uint32_t const *)(input->mapping + input->offset);
+        input->offset += *count * gridBytes;
+        byteCount = *count < maxCount ? remaining : *count * gridBytes;
+    } else {
+        byteCount = input_read(input, buffer, maxCount * gridBytes);
+        *count = byteCount / gridBytes;
+        *grids = buffer;
+    }
+
+    // The input must end at a grid boundary
+    return byteCount % gridBytes == 0 ? 0 : ERROR_INVALID_DATA;
+}
+
+size_t input_read(tInput *input, void *dst, size_t size) {
+    size_t const readAheadSize = min(size, input->readAheadEnd - input->readAheadFirst);
+    memcpy(dst, input->readAhead + input->readAheadFirst, readAheadSize);
+    input->readAheadFirst += readAheadSize;
+
+    return readAheadSize + fread((uint8_t *)dst + readAheadSize, 1, size - readAheadSize, input->stream);
+}
+
+int input_nextPackedGrid(tInput *input, tIntN N, uint32_t *sudValues) {
+    if (input->packed.N != N || (input->packed.flags & ~PACKED_FLAG_RLE) != 0) return ERROR_INVALID_DATA;
+    if (input->packedRemaining == 0) return ERROR_END_OF_FILE;
+
+    size_t const maxGridSize = packed_maxGridSize(N, input->packed.flags);
+    uint8_t const *bytes;
+    size_t size;
+
+    if (input_isMapped(*input)) {
+        bytes = input->mapping + input->offset;
+        size = input->mappingSize - input->offset;
+    } else {
+        // Keep at least a grid read ahead, unless at the end of the stream
+        if (input->readAheadEnd - input->readAheadFirst < maxGridSize) {
+            if (input->readAheadCapacity < maxGridSize * INPUT_READ_AHEAD_GRIDS) {
+                uint8_t *readAhead = check_alloc(malloc(maxGridSize * INPUT_READ_AHEAD_GRIDS), "input read-ahead buffer");
+                memcpy(readAhead, input->readAhead + input->readAheadFirst, input->readAheadEnd - input->readAheadFirst);
+                free(input->readAhead);
+                input->readAhead = readAhead;
+                input->readAheadCapacity = maxGridSize * INPUT_READ_AHEAD_GRIDS;
+            } else {
+                memmove(input->readAhead, input->readAhead + input->readAheadFirst, input->readAheadEnd - input->readAheadFirst);
+            }
+            input->readAheadEnd -= input->readAheadFirst;
+            input->readAheadFirst = 0;
+            input->readAheadEnd += fread(input->readAhead + input->readAheadEnd, 1,
+                input->readAheadCapacity - input->readAheadEnd, input->stream);
+        }
+        bytes = input->readAhead + input->readAheadFirst;
+        size = input->readAheadEnd - input->readAheadFirst;
+    }
+
+    // Without a count, the grids go on until the end of the stream
+    if (size == 0) {
+        return input->packedRemaining == PACKED_COUNT_UNKNOWN ? ERROR_END_OF_FILE : ERROR_INVALID_DATA;
+    }
+
+    size_t used;
+    int const result = packed_decode(bytes, size, N, input->packed.flags, sudValues, &used);
+    if (result != 0) {
+        return result;
+    }
+
+    if (input_isMapped(*input)) {
+        input->offset += used;
+    } else {
+        input->readAheadFirst += used;
+    }
+    if (input->packedRemaining != PACKED_COUNT_UNKNOWN) {
+        input->packedRemaining--;
+    }
+    return 0;
+}
@@ -3,44 +3,168 @@
  * @author 5cover, Matteo-K
  */
 
+#include <errno.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
-#include "resolution.c"
+#include "batch.c"
+#include "cache.c"
+#include "generate.c"
+#include "input.c"
+#include "server.c"
+#include "solver.c"
+#include "split.c"
 
-static tGrid gs_grid; // Automatically zero-initialized
+static tSolver gs_solver; // Automatically zero-initialized
+static tBatch gs_batch; // Automatically zero-initialized
+static tCache gs_cache; // Automatically zero-initialized
+static tCacheKey gs_cacheKey; // Automatically zero-initialized
+static uint8_t *gs_packedBuffer; // Automatically zero-initialized
+static tGenerator gs_generator; // Automatically zero-initialized
 
 void perform_emergencyMemoryCleanup(void) {
-    // It's always safe to call grid_free since the pointers inside tGrid and
-    // tCell are always either NULL or valid, thanks to static member auto
-    // initialization and grid_create.
-    grid_free(&gs_grid);
+    // It's always safe to call solver_free and batch_free since the pointers
+    // inside tSolver and tBatch are always either NULL or valid, thanks to
+    // static member auto initialization and solver_create and batch_create.
+    solver_free(&gs_solver);
+    batch_free(&gs_batch);
+    cache_freeKey(&gs_cacheKey);
+    cache_free(&gs_cache);
+    free(gs_packedBuffer);
+    generator_free(&gs_generator);
+}
+
+/// @brief Gets the current time of the monotonic clock, in seconds.
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/// @brief Parses a thread count argument.
+/// @param arg in: the argument: a non-negative integer, 0 meaning one thread
+/// per CPU
+/// @param threadCount out: the thread count
+/// @return Whether the argument is valid.
+static bool parse_threadCount(char const *arg, long *threadCount) {
+    char *end;
+    *threadCount = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || *threadCount < 0) {
+        return false;
+    }
+    if (*threadCount == 0) {
+        *threadCount = max(1, sysconf(_SC_NPROCESSORS_ONLN));
+    }
+    return true;
+}
+
+/// @brief Checks that solvers fit in the physical memory, before creating
+/// them.
+/// @param N in: grid size factor
+/// @param solverCount in: the number of solvers
+/// @param propagate in: whether the solvers propagate singletons while
+/// backtracking
+/// @return Whether the solvers fit. If not, an error has been printed.
+static bool check_memory(int N, long solverCount, bool propagate) {
+    long const pageCount = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+    if (pageCount <= 0 || pageSize <= 0) {
+        // Unknown: let the allocations decide
+        return true;
+    }
+
+    double const needed = (double)solver_memorySize(N, propagate) * solverCount;
+    double const available = (double)pageCount * pageSize;
+    if (needed > available) {
+        fprintf(stderr,
+            PROGRAM_NAME ": grids of size N=%d need up to %.0f MiB of memory with %ld thread(s), more than the %.0f MiB available\n",
+            N, needed / (1 << 20), solverCount, available / (1 << 20));
+        return false;
+    }
+    return true;
 }
 
 static void print_help(void) {
     puts("Sudone - an optimized Sudoku solver");
-    puts("The input grid is read from standard input and the result is printed "
-         "to standard output.");
+    puts("The input grid is read from FILE, or standard input if omitted, and the "
+         "result is printed to standard output.");
+    puts("In batch mode, the input is a stream of concatenated Sud grids, and "
+         "the results are printed in order.");
     puts("");
-    puts("Usage: " PROGRAM_NAME " N");
+    puts("Usage: " PROGRAM_NAME " N [FILE]");
+    puts("       " PROGRAM_NAME " --listen=ADDRESS");
+    puts("       " PROGRAM_NAME " --generate=COUNT N");
     puts("");
     puts("N\tGrid size integer constant between 1 and 255");
+    puts("FILE\tSud file to read. Regular files are memory-mapped.");
     puts("");
     puts("Options:");
     puts("");
     puts("-s\t solve the grid");
     puts("-b\t binary (.sud) output");
+    puts("--packed[=rle]");
+    puts("\t packed binary output: bit-packed values, or run-length encoded");
+    puts("\t empty cells with rle. Inputs in either format are detected.");
+    puts("-p\t propagate singletons while backtracking");
+    puts("-u, --unique");
+    puts("\t check the uniqueness of the solution: print 0, 1 or many, the");
+    puts("\t number of solutions, instead of the grid. The search stops at the");
+    puts("\t second solution.");
+    puts("-e ENGINE, --engine=ENGINE");
+    puts("\t solving engine: techniques, dlx, fixed for N=3 to 5, or auto (default):");
+    puts("\t fixed when it applies and neither -p nor -t is given, techniques");
+    puts("\t otherwise");
+    puts("-m, --batch");
+    puts("\t batch mode: process every grid of the input");
+    puts("-j JOBS, --jobs=JOBS");
+    puts("\t solve the grids with JOBS threads (0: one per CPU). Implies -m.");
+    puts("-t THREADS, --split=THREADS");
+    puts("\t split the search of each grid between THREADS threads (0: one per");
+    puts("\t CPU). Lowers the latency of a single hard grid. Ignored with -j, and");
+    puts("\t with an engine other than techniques.");
+    puts("-l ADDRESS, --listen=ADDRESS");
+    puts("\t serve solve requests on a socket: a Unix socket path, or a TCP");
+    puts("\t [HOST]:PORT. Requests are N then the Sud values of a grid, replies");
+    puts("\t a status (0: solved, 1: unsolvable, 2: invalid, 3: unsupported N)");
+    puts("\t then the Sud values. Honors -e and -p.");
+    puts("-g COUNT, --generate=COUNT");
+    puts("\t generate COUNT minimal puzzles with a unique solution instead of");
+    puts("\t reading grids, on -j threads. Honors -b and --packed.");
+    puts("--difficulty=TIER");
+    puts("\t generate puzzles that need the techniques of TIER: singletons,");
+    puts("\t pairs, fish or backtracking");
+    puts("--seed=SEED");
+    puts("\t seed of the generator (default: the time). The puzzles of a seed");
+    puts("\t are the same whatever the number of threads.");
+    puts("-c ENTRIES, --cache=ENTRIES");
+    puts("\t cache the solutions of up to ENTRIES grids, keyed by their form");
+    puts("\t up to relabelling, line permutations and transposition, so that");
+    puts("\t repeated or equivalent grids are solved once (default: 65536 with");
+    puts("\t --cache-file, no cache otherwise)");
+    puts("--cache-file=PATH");
+    puts("\t load the cache from PATH, and save it there on exit (on SIGINT or");
+    puts("\t SIGTERM with -l). Implies -c.");
+    puts("--stats\t print solving statistics of each grid to standard error, as");
+    puts("\t one JSON record per line. Needs a build with cf=-DSUDONE_STATS.");
     puts("--help\t print this help and exit");
     puts("");
     puts("This is public domain software. Compiled on " __DATE__ ".");
 }
 
 int main(int argc, char **argv) {
-    bool opt_solve = false, opt_binary = false;
+    bool opt_solve = false, opt_binary = false, opt_packed = false, opt_propagate = false, opt_batch = false, opt_unique = false;
+    tEngine opt_engine = ENGINE_AUTO;
+    long opt_jobs = 1, opt_splitThreads = 1;
+    char const *opt_listen = NULL, *opt_cacheFile = NULL;
+    size_t opt_cacheCapacity = 0;
+    uint8_t opt_packedFlags = 0;
+    unsigned long opt_generate = 0;
+    tTier opt_difficulty = GENERATE_ANY_TIER;
+    uint64_t opt_seed = time(NULL);
 
     // Parse command-line options
     {
@@ -50,10 +174,88 @@ int main(int argc, char **argv) {
                                             .flag = NULL,
                                             .val = 'h',
                                         },
+            (struct option) {
+                .name = "engine",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'e',
+            },
+            (struct option) {
+                .name = "batch",
+                .has_arg = 0,
+                .flag = NULL,
+                .val = 'm',
+            },
+            (struct option) {
+                .name = "unique",
+                .has_arg = 0,
+                .flag = NULL,
+                .val = 'u',
+            },
+            (struct option) {
+                .name = "jobs",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'j',
+            },
+            (struct option) {
+                .name = "split",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 't',
+            },
+            (struct option) {
+                .name = "listen",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'l',
+            },
+            (struct option) {
+                .name = "generate",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'g',
+            },
+            (struct option) {
+                .name = "difficulty",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'D',
+            },
+            (struct option) {
+                .name = "seed",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'R',
+            },
+            (struct option) {
+                .name = "packed",
+                .has_arg = 2,
+                .flag = NULL,
+                .val = 'P',
+            },
+            (struct option) {
+                .name = "cache",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'c',
+            },
+            (struct option) {
+                .name = "cache-file",
+                .has_arg = 1,
+                .flag = NULL,
+                .val = 'C',
+            },
+            (struct option) {
+                .name = "stats",
+                .has_arg = 0,
+                .flag = NULL,
+                .val = 'S',
+            },
             { 0 } };
 
         int opt;
-        while ((opt = getopt_long(argc, argv, "sb", longOptions, NULL)) != -1) {
+        while ((opt = getopt_long(argc, argv, "sbpue:mj:t:l:c:g:", longOptions, NULL)) != -1) {
             switch (opt) {
             case 's':
                 opt_solve = true;
@@ -61,6 +263,102 @@ int main(int argc, char **argv) {
             case 'b':
                 opt_binary = true;
                 break;
+            case 'p':
+                opt_propagate = true;
+                break;
+            case 'u':
+                opt_unique = true;
+                break;
+            case 'm':
+                opt_batch = true;
+                break;
+            case 'j':
+                if (!parse_threadCount(optarg, &opt_jobs)) {
+                    fprintf(stderr, PROGRAM_NAME ": invalid number of jobs: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                opt_batch = true;
+                break;
+            case 't':
+                if (!parse_threadCount(optarg, &opt_splitThreads)) {
+                    fprintf(stderr, PROGRAM_NAME ": invalid number of threads: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "auto") == 0) {
+                    opt_engine = ENGINE_AUTO;
+                } else if (strcmp(optarg, "techniques") == 0) {
+                    opt_engine = ENGINE_TECHNIQUES;
+                } else if (strcmp(optarg, "dlx") == 0) {
+                    opt_engine = ENGINE_DLX;
+                } else if (strcmp(optarg, "fixed") == 0) {
+                    opt_engine = ENGINE_FIXED;
+                } else {
+                    fprintf(stderr, PROGRAM_NAME ": unknown engine: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            case 'l':
+                opt_listen = optarg;
+                break;
+            case 'c': {
+                char *end;
+                long const capacity = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || capacity <= 0) {
+                    fprintf(stderr, PROGRAM_NAME ": invalid number of cache entries: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                opt_cacheCapacity = capacity;
+                break;
+            }
+            case 'C':
+                opt_cacheFile = optarg;
+                break;
+            case 'g': {
+                char *end;
+                opt_generate = strtoul(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || opt_generate == 0) {
+                    fprintf(stderr, PROGRAM_NAME ": invalid number of puzzles: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            }
+            case 'D':
+                for (opt_difficulty = 0; opt_difficulty < TIER_COUNT; opt_difficulty++) {
+                    if (strcmp(optarg, solver_tierName(opt_difficulty)) == 0) {
+                        break;
+                    }
+                }
+                if (opt_difficulty == TIER_COUNT) {
+                    fprintf(stderr, PROGRAM_NAME ": unknown difficulty: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            case 'R': {
+                char *end;
+                opt_seed = strtoull(optarg, &end, 0);
+                if (*optarg == '\0' || *end != '\0') {
+                    fprintf(stderr, PROGRAM_NAME ": invalid seed: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                break;
+            }
+            case 'P':
+                if (optarg != NULL && strcmp(optarg, "rle") != 0) {
+                    fprintf(stderr, PROGRAM_NAME ": unknown packed mode: %s\n", optarg);
+                    return EXIT_INVALID_ARG;
+                }
+                opt_packed = true;
+                opt_packedFlags = optarg == NULL ? 0 : PACKED_FLAG_RLE;
+                break;
+            case 'S':
+                if (!stats_isCompiled) {
+                    fprintf(stderr, PROGRAM_NAME ": statistics are not compiled in: build with cf=-DSUDONE_STATS\n");
+                    return EXIT_INVALID_ARG;
+                }
+                stats_enabled = true;
+                break;
             case 'h':
                 print_help();
                 return EXIT_SUCCESS;
@@ -72,6 +370,20 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (opt_cacheFile != NULL && opt_cacheCapacity == 0) {
+        opt_cacheCapacity = CACHE_DEFAULT_CAPACITY;
+    }
+
+    if (opt_listen != NULL) {
+        // The grid size is given by each request
+        return server_run(opt_listen, (tServerOptions) {
+                                          .engine = opt_engine,
+                                          .propagate = opt_propagate,
+                                          .cacheCapacity = opt_cacheCapacity,
+                                          .cacheFile = opt_cacheFile,
+                                      });
+    }
+
     // parse n argument
 
     if (optind >= argc) {
@@ -88,62 +400,171 @@ int main(int argc, char **argv) {
         return EXIT_INVALID_ARG;
     }
 
-    gs_grid = grid_create(N);
+    // A thread per job, or the main thread and a thread per split of the search
+    long const solverCount = opt_generate > 0 || opt_jobs > 1 ? opt_jobs
+        : opt_splitThreads > 1                                  ? opt_splitThreads + 1
+                                                                : 1;
+    if (!check_memory(N, solverCount, opt_propagate || opt_generate > 0)) {
+        return EXIT_INVALID_ARG;
+    }
 
-    // Load the grid
-    if (grid_load(stdin, &gs_grid) == ERROR_INVALID_DATA) {
-        fprintf(stderr,
-            PROGRAM_NAME ": the input is not a Sudoku grid of size N=%d.\n",
-            gs_grid.N);
-        return EXIT_INVALID_DATA;
+    if (opt_generate > 0) {
+        if (opt_packed) {
+            packed_writeHeader((tPackedHeader) { .N = N, .flags = opt_packedFlags, .count = opt_generate }, stdout);
+        }
+
+        double const startTime = monotonicSeconds();
+        gs_generator = generator_create(N, (tGenerateOptions) {
+                                               .count = opt_generate,
+                                               .tier = opt_difficulty,
+                                               .seed = opt_seed,
+                                               .workerCount = opt_jobs,
+                                               .binary = opt_binary,
+                                               .packed = opt_packed,
+                                               .packedFlags = opt_packedFlags,
+                                           });
+        generator_run(&gs_generator, stdout);
+        generator_free(&gs_generator);
+
+        double const elapsed = monotonicSeconds() - startTime;
+        fprintf(stderr, PROGRAM_NAME ": %lu puzzles in %.6f s (%.1f puzzles/s)\n",
+            opt_generate, elapsed, elapsed > 0 ? opt_generate / elapsed : 0);
+        return EXIT_SUCCESS;
     }
 
-    // Solve the grid
-    if (opt_solve) {
-        bool progress; // if progress has been made since the last iteration
+    // parse the optional file argument
 
-        do {
-            progress = perform_simpleTechniques(&gs_grid);
-        } while (progress);
+    char const *path = optind + 1 < argc ? argv[optind + 1] : NULL;
+    tInput input;
+    if (!input_open(&input, path)) {
+        fprintf(stderr, PROGRAM_NAME ": %s: %s\n", path == NULL ? "stdin" : path, strerror(errno));
+        return EXIT_INVALID_ARG;
+    }
 
-        progress = technique_x_wing(&gs_grid);
-        while (progress) {
-            // Alternate betweeen the X-Wing technique and simple techniques
-            // The X-Wing technique could allow for more progress with simple
-            // techniques, and vice versa. The loop continues until no further
-            // progress can be made.
-            progress = technique_x_wing(&gs_grid) || perform_simpleTechniques(&gs_grid);
+    tCache *cache = NULL;
+    if (opt_cacheCapacity > 0) {
+        gs_cache = cache_create(N, opt_cacheCapacity);
+        cache = &gs_cache;
+        if (opt_cacheFile != NULL && !cache_loadSnapshot(cache, opt_cacheFile)) {
+            cache_free(&gs_cache);
+            input_close(&input);
+            return EXIT_INVALID_DATA;
         }
+    }
 
-        // Collect the positions of the remaining empty cells for backtracking
-        tPosition *emptyCellPositions = check_alloc(
-            array_malloc(emptyCellPositions, grid_size(gs_grid) * grid_size(gs_grid)),
-            "empty cell positions");
+    if (opt_packed && !opt_unique) {
+        // The grid count isn't known in advance
+        packed_writeHeader((tPackedHeader) { .N = N, .flags = opt_packedFlags, .count = PACKED_COUNT_UNKNOWN }, stdout);
+    }
 
-        int emptyCellCount = 0;
+    double const startTime = monotonicSeconds();
+    unsigned long gridCount = 0;
+    int loadResult;
 
-        for (tIntSize r = 0; r < grid_size(gs_grid); r++) {
-            for (tIntSize c = 0; c < grid_size(gs_grid); c++) {
-                if (!cell_hasValue(grid_cellAt(gs_grid, r, c))) {
-                    emptyCellPositions[emptyCellCount++] = (tPosition) { .row = r, .column = c };
+    if (opt_jobs > 1) {
+        // Solve the grids on a pool of worker threads
+        gs_batch = batch_create(N, (tBatchOptions) {
+                                       .solve = opt_solve,
+                                       .binary = opt_binary,
+                                       .packed = opt_packed,
+                                       .packedFlags = opt_packedFlags,
+                                       .checkUniqueness = opt_unique,
+                                       .engine = opt_engine,
+                                       .propagate = opt_propagate,
+                                       .workerCount = opt_jobs,
+                                       .cache = cache,
+                                   });
+        loadResult = batch_run(&gs_batch, &input, stdout, &gridCount);
+        batch_free(&gs_batch);
+    } else {
+        // The split search only applies to the techniques engine
+        gs_solver = solver_create(N, opt_engine == ENGINE_AUTO && opt_splitThreads > 1 ? ENGINE_TECHNIQUES : opt_engine,
+            opt_propagate);
+        if (cache != NULL) {
+            gs_cacheKey = cache_createKey(N);
+        }
+        if (opt_packed) {
+            gs_packedBuffer = check_alloc(malloc(packed_maxGridSize(N, opt_packedFlags)), "packed output buffer");
+        }
+
+        // Process the grids one after another, reusing the same solver
+        while ((loadResult = input_nextGrid(&input, &gs_solver.grid)) == 0) {
+            gridCount++;
+            stats_reset(gs_solver.grid.stats);
+
+            if (opt_unique) {
+                // Output the solution count instead of the grid
+                unsigned const count = solver_countSolutions(&gs_solver, SOLVER_UNIQUENESS_LIMIT);
+                printf("%s\n", solver_uniquenessName(count));
+            } else {
+                // Solve the grid
+                if (opt_solve && (cache == NULL || !cache_lookup(cache, &gs_solver.grid, &gs_cacheKey))) {
+                    split_solve(&gs_solver, opt_splitThreads);
+                    if (cache != NULL) {
+                        cache_store(cache, &gs_solver.grid, &gs_cacheKey);
+                    }
+                }
+
+                // Output the grid
+                if (opt_packed) {
+                    packed_writeGrid(&gs_solver.grid, opt_packedFlags, gs_packedBuffer, stdout);
+                } else if (opt_binary) {
+                    grid_write(&gs_solver.grid, stdout);
+                } else {
+                    grid_print(&gs_solver.grid, stdout);
                 }
             }
+
+#ifdef SUDONE_STATS
+            if (stats_enabled) {
+                stats_print(&gs_solver.grid.stats, gridCount, stderr);
+            }
+#endif
+
+            if (!opt_batch) {
+                break;
+            }
         }
 
-        // Wrap up with backtracking which will always solve the grid.
-        technique_backtracking(&gs_grid, emptyCellPositions, emptyCellCount, 0);
+        solver_free(&gs_solver);
+        cache_freeKey(&gs_cacheKey);
+        free(gs_packedBuffer);
+        gs_packedBuffer = NULL;
+    }
+
+    input_close(&input);
 
-        free(emptyCellPositions);
+    bool cacheSaved = true;
+    if (cache != NULL) {
+        if (opt_cacheFile != NULL) {
+            cacheSaved = cache_saveSnapshot(cache, 1, opt_cacheFile);
+        }
+        if (opt_batch) {
+            fprintf(stderr, PROGRAM_NAME ": cache: %lu hits, %lu misses, %zu entries\n",
+                cache->hits, cache->misses, cache->count);
+        }
+        cache_free(&gs_cache);
     }
 
-    // Output the grid
-    if (opt_binary) {
-        grid_write(&gs_grid, stdout);
-    } else {
-        grid_print(&gs_grid, stdout);
+    // In batch mode, the input ends cleanly at a grid boundary.
+    if (loadResult == ERROR_INVALID_DATA || (loadResult == ERROR_END_OF_FILE && !opt_batch)) {
+        if (opt_batch) {
+            fprintf(stderr,
+                PROGRAM_NAME ": grid %lu of the input is not a Sudoku grid of size N=%d.\n",
+                gridCount + 1, N);
+        } else {
+            fprintf(stderr,
+                PROGRAM_NAME ": the input is not a Sudoku grid of size N=%d.\n",
+                N);
+        }
+        return EXIT_INVALID_DATA;
     }
 
-    grid_free(&gs_grid);
+    if (opt_batch) {
+        double const elapsed = monotonicSeconds() - startTime;
+        fprintf(stderr, PROGRAM_NAME ": %lu grids in %.6f s (%.1f grids/s)\n",
+            gridCount, elapsed, elapsed > 0 ? gridCount / elapsed : 0);
+    }
 
-    return EXIT_SUCCESS;
+    return cacheSaved ? EXIT_SUCCESS : EXIT_FAILURE;
 }
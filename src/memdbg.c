@@ -10,6 +10,9 @@
  * freed     | 0x0008945613 | malloc | 18   | grid cell 0,1
  * allocated | 0x0008965431 | calloc | 1024 | grid
  *
+ * The allocation map is protected by a mutex, so allocations can be made from
+ * any thread.
+ *
  * Ideas for more features:
  * - Make memory allocation functions (calloc, malloc) articifially return null
  * to test error handling.
@@ -18,6 +21,7 @@
 #pragma once
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -91,6 +95,23 @@ void *dbg_malloc(char const *file, int line, size_t size) attr_malloc;
 void *dbg_calloc(char const *file, int line, size_t nmemb,
     size_t size) attr_malloc;
 
+/// @brief Registers a block carved out of a larger allocation, such as an
+/// arena block, so that it can be checked with @ref check_alloc.
+/// @param file in: current file
+/// @param line in: current line
+/// @param ptr in: the block
+/// @param size in: the size of the block, in bytes
+/// @remark Such a block must not be freed with @c free, but released with @ref
+/// dbg_untrack along with the allocation containing it.
+void dbg_track(char const *file, int line, void *ptr, size_t size);
+
+/// @brief Marks the blocks registered with @ref dbg_track in a region as freed.
+/// @param file in: current file
+/// @param line in: current line
+/// @param begin in: start of the region
+/// @param size in: size of the region, in bytes
+void dbg_untrack(char const *file, int line, void *begin, size_t size);
+
 #endif // NDEBUG
 
 /////////////////////////////////////////////////////////////////////////
@@ -109,6 +130,7 @@ void *dbg_calloc(char const *file, int line, size_t nmemb,
 typedef enum {
     AM_malloc,
     AM_calloc,
+    AM_tracked,
 } AllocationMethod;
 
 typedef enum {
@@ -130,9 +152,13 @@ typedef struct {
 
 static AllocationsMapItem *gs_allocations_map;
 
-static bool gs_initialized = false;
+/// @brief Protects @ref gs_allocations_map.
+static pthread_mutex_t gs_allocations_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t gs_initialized = PTHREAD_ONCE_INIT;
 
 static void memdbg_exit(void) {
+    pthread_mutex_lock(&gs_allocations_lock);
     // Check that everything has been freed
     bool foundUnfreedAlloc = false;
     for (size_t i = 0; i < hmlenu(gs_allocations_map); ++i) {
@@ -145,6 +171,7 @@ static void memdbg_exit(void) {
     }
 
     if (foundUnfreedAlloc) {
+        pthread_mutex_unlock(&gs_allocations_lock);
         dbg_fail("Unfreed allocations have been found.");
     }
 
@@ -153,6 +180,7 @@ static void memdbg_exit(void) {
         free(gs_allocations_map[i].value.comment);
     }
     hmfree(gs_allocations_map);
+    pthread_mutex_unlock(&gs_allocations_lock);
 }
 
 static void signalHandler(int sigid) {
@@ -164,12 +192,13 @@ static void signalHandler(int sigid) {
     }
 }
 
+static void init(void) {
+    signal(SIGABRT, signalHandler);
+    atexit(memdbg_exit);
+}
+
 void lazyInit(void) {
-    if (!gs_initialized) {
-        signal(SIGABRT, signalHandler);
-        atexit(memdbg_exit);
-    }
-    gs_initialized = true;
+    pthread_once(&gs_initialized, init);
 }
 
 void *dbg_malloc(verbose char const *file, verbose int line, size_t size) {
@@ -178,6 +207,7 @@ void *dbg_malloc(verbose char const *file, verbose int line, size_t size) {
 #ifdef MEMDBG_VERBOSE
     fprintf(stderr, "%s:%d: memdbg: malloc(%zu) -> %p\n", file, line, size, ptr);
 #endif // MEMDBG_VERBOSE
+    pthread_mutex_lock(&gs_allocations_lock);
     hmput(gs_allocations_map, ptr,
         ((Allocation) {
             .method = AM_malloc,
@@ -185,6 +215,7 @@ void *dbg_malloc(verbose char const *file, verbose int line, size_t size) {
             .status = AS_allocated,
             .comment = NULL,
         }));
+    pthread_mutex_unlock(&gs_allocations_lock);
     return ptr;
 }
 
@@ -196,6 +227,7 @@ void *dbg_calloc(verbose char const *file, verbose int line, size_t nmemb,
     fprintf(stderr, "%s:%d: memdbg: calloc(%zu, %zu) -> %p\n", file, line, nmemb,
         size, ptr);
 #endif // MEMDBG_VERBOSE
+    pthread_mutex_lock(&gs_allocations_lock);
     hmput(gs_allocations_map, ptr,
         ((Allocation) {
             .method = AM_malloc,
@@ -203,46 +235,93 @@ void *dbg_calloc(verbose char const *file, verbose int line, size_t nmemb,
             .status = AS_allocated,
             .comment = NULL,
         }));
+    pthread_mutex_unlock(&gs_allocations_lock);
     return ptr;
 }
 
 void dbg_free(char const *file, int line, void *ptr) {
     lazyInit();
+    // Like free, freeing a null pointer does nothing
+    if (ptr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&gs_allocations_lock);
     AllocationsMapItem *item = hmgetp_null(gs_allocations_map, ptr);
-    if (item != NULL) {
+    if (item != NULL && item->value.method == AM_tracked) {
+        pthread_mutex_unlock(&gs_allocations_lock);
+        fprintf(stderr, "%s:%d: memdbg: free(%p)\n", file, line, ptr);
+        dbg_fail("Tried to free a tracked block: %p", ptr);
+    } else if (item != NULL) {
 #ifdef MEMDBG_VERBOSE
         fprintf(stderr, "%s:%d: memdbg: free: %s\n", file, line,
             item->value.comment);
 #endif // MEMDBG_VERBOSE
         free(ptr);
         item->value.status = AS_freed;
+        pthread_mutex_unlock(&gs_allocations_lock);
     } else {
+        pthread_mutex_unlock(&gs_allocations_lock);
         fprintf(stderr, "%s:%d: memdbg: free(%p)\n", file, line, ptr);
         dbg_fail("Tried to free an invalid pointer: %p", ptr);
     }
 }
 
+void dbg_track(verbose char const *file, verbose int line, void *ptr, size_t size) {
+    lazyInit();
+#ifdef MEMDBG_VERBOSE
+    fprintf(stderr, "%s:%d: memdbg: track(%zu) -> %p\n", file, line, size, ptr);
+#endif // MEMDBG_VERBOSE
+    pthread_mutex_lock(&gs_allocations_lock);
+    hmput(gs_allocations_map, ptr,
+        ((Allocation) {
+            .method = AM_tracked,
+            .size = size,
+            .status = AS_allocated,
+            .comment = NULL,
+        }));
+    pthread_mutex_unlock(&gs_allocations_lock);
+}
+
+void dbg_untrack(verbose char const *file, verbose int line, void *begin, size_t size) {
+    lazyInit();
+    pthread_mutex_lock(&gs_allocations_lock);
+    for (size_t i = 0; i < hmlenu(gs_allocations_map); ++i) {
+        char *ptr = gs_allocations_map[i].key;
+        Allocation *alloc = &gs_allocations_map[i].value;
+        if (alloc->method == AM_tracked && alloc->status == AS_allocated
+            && ptr >= (char *)begin && ptr < (char *)begin + size) {
+#ifdef MEMDBG_VERBOSE
+            fprintf(stderr, "%s:%d: memdbg: untrack: %s\n", file, line, alloc->comment);
+#endif // MEMDBG_VERBOSE
+            alloc->status = AS_freed;
+        }
+    }
+    pthread_mutex_unlock(&gs_allocations_lock);
+}
+
 void *check_alloc(void *mallocResult, char const *fmt_allocComment, ...) {
     lazyInit();
     va_list args;
     va_start(args, fmt_allocComment);
 
     if (mallocResult != NULL) {
-        if (gs_initialized) {
-            AllocationsMapItem *item = hmgetp_null(gs_allocations_map, mallocResult);
-            if (item == NULL) {
-                fprintf(stderr, "!! Tried to check an allocation that never occured: ");
-                vfprintf(stderr, fmt_allocComment, args);
-                fprintf(stderr, " (%p)\n", mallocResult);
-                abort();
-            } else {
-                item->value.comment = malloc(bufferSize(fmt_allocComment, args));
-                // reset the arguments after bufferSize consumed them
-                va_end(args);
-                va_start(args, fmt_allocComment);
-                vsprintf(item->value.comment, fmt_allocComment, args);
-            }
+        pthread_mutex_lock(&gs_allocations_lock);
+        AllocationsMapItem *item = hmgetp_null(gs_allocations_map, mallocResult);
+        if (item == NULL) {
+            pthread_mutex_unlock(&gs_allocations_lock);
+            fprintf(stderr, "!! Tried to check an allocation that never occured: ");
+            vfprintf(stderr, fmt_allocComment, args);
+            fprintf(stderr, " (%p)\n", mallocResult);
+            abort();
+        } else {
+            item->value.comment = malloc(bufferSize(fmt_allocComment, args));
+            // reset the arguments after bufferSize consumed them
+            va_end(args);
+            va_start(args, fmt_allocComment);
+            vsprintf(item->value.comment, fmt_allocComment, args);
         }
+        pthread_mutex_unlock(&gs_allocations_lock);
+        va_end(args);
 
         return mallocResult;
     }
@@ -265,6 +344,7 @@ void dbg_print_allocations(FILE *outStream) {
 
 #define STR_AM_MALLOC "malloc"
 #define STR_AM_CALLOC "calloc"
+#define STR_AM_TRACKED "tracked"
 
 #define TH_INDEX "#"
 #define TH_STATUS "status"
@@ -281,10 +361,12 @@ void dbg_print_allocations(FILE *outStream) {
 #define COL_LEN_PTR ((int)sizeof(void *) + 4)
 #define COL_LEN_METHOD                                    \
     ((int)max(sizeof TH_METHOD,                     \
-         max(sizeof STR_AM_MALLOC, sizeof STR_AM_CALLOC)) \
+         max(sizeof STR_AM_MALLOC, max(sizeof STR_AM_CALLOC, sizeof STR_AM_TRACKED))) \
         - 1)
 #define COL_LEN_SIZE ((int)sizeof TH_SIZE - 1)
 
+    pthread_mutex_lock(&gs_allocations_lock);
+
     // Header
     fprintf(outStream, "%*s | %*s | %*s | %*s | %*s | %s\n", COL_LEN_INDEX,
         TH_INDEX, COL_LEN_STATUS, TH_STATUS, COL_LEN_METHOD,
@@ -304,12 +386,16 @@ void dbg_print_allocations(FILE *outStream) {
             COL_LEN_INDEX, i, COL_LEN_STATUS,
             alloc.status == AS_freed ? STR_AS_FREED : STR_AS_ALLOCATED,
             COL_LEN_METHOD,
-            alloc.method == AM_malloc ? STR_AM_MALLOC : STR_AM_CALLOC,
+            alloc.method == AM_malloc       ? STR_AM_MALLOC
+                : alloc.method == AM_calloc ? STR_AM_CALLOC
+                                            : STR_AM_TRACKED,
             COL_LEN_SIZE, alloc.size, COL_LEN_PTR, (intptr_t)ptr,
             alloc.comment);
     }
     fprintf(outStream, "%zu allocations (%zu currently allocated, %zu freed)\n",
         hmlen(gs_allocations_map), allocatedCount, freedCount);
+
+    pthread_mutex_unlock(&gs_allocations_lock);
 }
 
 // Redefine stdlib functions
@@ -0,0 +1,269 @@
+/** @file
+ * @brief Minimum remaining values index
+ * @author 5cover, Matteo-K
+ *
+ * Keeps the empty cells of a grid in bucket lists keyed by their amount of
+ * possible values, so that the backtracking technique can pick the most
+ * constrained cell without rescanning the grid.
+ *
+ * The possible value counts are updated incrementally by @ref
+ * mrv_markValueFree, which must be used instead of @ref grid_markValueFree while
+ * the index is in use.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "types.c"
+
+/// @brief Integer: end of a bucket list.
+#define MRV_NIL UINT_LEAST32_MAX
+
+/// @brief A guess of the backtracking technique: a cell picked from the index
+/// and the value tried on it.
+typedef struct {
+    /// @brief Flat index of the cell.
+    tIntCell iCell;
+    /// @brief First value to try. The values are tried in circular order from
+    /// it.
+    tIntSize first;
+    /// @brief Value being tried, or 0 before the first one.
+    tIntSize value;
+    /// @brief Number of solutions found before the guess.
+    unsigned count;
+} tMrvGuess;
+
+/// @brief Minimum remaining values index of the empty cells of a grid.
+typedef struct {
+    /// @brief Number of possible values of each indexed cell.
+    /// @remark Dimensions: [cellIndex]
+    tIntSize *possibleCounts;
+
+    /// @brief Next cell in the bucket list, or @ref MRV_NIL.
+    /// @remark Dimensions: [cellIndex]
+    tIntCell *next;
+
+    /// @brief Previous cell in the bucket list, or @ref MRV_NIL.
+    /// @remark Dimensions: [cellIndex]
+    tIntCell *prev;
+
+    /// @brief Whether a cell is currently indexed.
+    /// @remark Dimensions: [cellIndex]
+    bool *isIndexed;
+
+    /// @brief First cell of the bucket list of each possible value count, or
+    /// @ref MRV_NIL.
+    /// @remark Dimensions: [possibleCount] (SIZE + 1 buckets)
+    tIntCell *bucketHeads;
+
+    /// @brief Stack of the guesses of the backtracking technique, from the
+    /// first one.
+    /// @remark Dimensions: [depth] (at most one guess per cell)
+    tMrvGuess *guesses;
+
+    /// @brief Lower bound of the smallest non-empty bucket.
+    tIntSize minCount;
+
+    /// @brief Number of indexed cells.
+    tIntCell cellCount;
+} tMrv;
+
+/// @brief Gets the flat index of a cell.
+#define mrv_cellIndex(grid, row, column) at2d(grid_size(grid), (row), (column))
+
+/// @brief Determines whether the index has no cells left.
+#define mrv_isEmpty(mrv) ((mrv).cellCount == 0)
+
+/// @brief Gets the number of bytes an index takes in the arena of a grid.
+/// @param N in: grid size factor
+size_t mrv_arenaSize(tIntN N);
+
+/// @brief Creates an empty index for a grid.
+/// @param grid in/out: the grid. The index is allocated in its arena, which
+/// must have @ref mrv_arenaSize bytes reserved for it.
+/// @return A new empty index. It lives as long as the grid.
+tMrv mrv_create(tGrid *grid);
+
+/// @brief Fills an index with the empty cells of a grid.
+/// @param mrv in/out: the index, created for a grid of the same size
+/// @param grid in: the grid
+void mrv_reset(tMrv *mrv, tGrid const *grid);
+
+/// @brief Removes and returns the cell with the least possible values.
+/// @param mrv in/out: the index. Must not be empty.
+/// @return The flat index of the removed cell.
+tIntCell mrv_popMin(tMrv *mrv);
+
+/// @brief Inserts a cell back into the index.
+/// @param mrv in/out: the index
+/// @param iCell in: the flat index of the cell. Its possible value count must
+/// be up to date.
+/// @remark Used to undo @ref mrv_popMin.
+void mrv_push(tMrv *mrv, tIntCell iCell);
+
+/// @brief Defines whether a value is free or not at a position on the grid and
+/// updates the possible value counts of the indexed peers of the cell.
+/// @param isFree in: whether the value becomes free
+/// @param mrv in/out: the index
+/// @param grid in/out: the grid
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param value in: the value
+/// @remark When marking the value as not free, it must be possible at the
+/// position.
+void mrv_markValueFree(bool isFree, tMrv *mrv, tGrid *grid, tIntSize row,
+    tIntSize column, tIntSize value);
+
+/// @brief Adjusts the possible value count of a cell if a value is possible on
+/// it.
+/// @param mrv in/out: the index
+/// @param grid in: the grid
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param value in: the value
+/// @param delta in: the amount to add to the count (+1 or -1)
+/// @remark Used in @ref mrv_markValueFree.
+void mrv_updatePeer(tMrv *mrv, tGrid const *grid, tIntSize row,
+    tIntSize column, tIntSize value, int delta);
+
+/////////////////////////////////////////////////////////////////////////
+
+size_t mrv_arenaSize(tIntN N) {
+    size_t const size = (size_t)N * N, cellCount = size * size;
+    tMrv mrv;
+
+    return arena_blockSize(sizeof *mrv.possibleCounts * cellCount)
+        + arena_blockSize(sizeof *mrv.next * cellCount)
+        + arena_blockSize(sizeof *mrv.prev * cellCount)
+        + arena_blockSize(sizeof *mrv.isIndexed * cellCount)
+        + arena_blockSize(sizeof *mrv.bucketHeads * (size + 1))
+        + arena_blockSize(sizeof *mrv.guesses * cellCount);
+}
+
+tMrv mrv_create(tGrid *grid) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+    tArena *arena = &grid->_arena;
+
+    // The contents are initialized by mrv_reset
+    tMrv mrv = {
+        .possibleCounts = check_alloc(arena_array(arena, mrv.possibleCounts, cellCount), "mrv possibleCounts array"),
+        .next = check_alloc(arena_array(arena, mrv.next, cellCount), "mrv next array"),
+        .prev = check_alloc(arena_array(arena, mrv.prev, cellCount), "mrv prev array"),
+        .isIndexed = check_alloc(arena_array(arena, mrv.isIndexed, cellCount), "mrv isIndexed array"),
+        .bucketHeads = check_alloc(arena_array(arena, mrv.bucketHeads, grid_size(*grid) + 1), "mrv bucketHeads array"),
+        .guesses = check_alloc(arena_array(arena, mrv.guesses, cellCount), "mrv guesses array"),
+        .minCount = 0,
+        .cellCount = 0,
+    };
+
+    return mrv;
+}
+
+void mrv_reset(tMrv *mrv, tGrid const *grid) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+
+    for (tIntSize count = 0; count <= grid_size(*grid); count++) {
+        mrv->bucketHeads[count] = MRV_NIL;
+    }
+    memset(mrv->isIndexed, false, sizeof *mrv->isIndexed * cellCount);
+    mrv->minCount = 0;
+    mrv->cellCount = 0;
+
+    for (tIntSize r = 0; r < grid_size(*grid); r++) {
+        for (tIntSize c = 0; c < grid_size(*grid); c++) {
+            if (!cell_hasValue(grid_cellAt(*grid, r, c))) {
+                grid_cellPossibleValuesCount(*grid, r, c, possibleCount);
+                tIntCell const iCell = mrv_cellIndex(*grid, r, c);
+                mrv->possibleCounts[iCell] = possibleCount;
+                mrv_push(mrv, iCell);
+            }
+        }
+    }
+}
+
+/// @brief Unlinks an indexed cell from its bucket list.
+#define mrv_unlink(mrv, iCell)                                                 \
+    do {                                                                       \
+        if ((mrv)->prev[iCell] == MRV_NIL) {                                   \
+            (mrv)->bucketHeads[(mrv)->possibleCounts[iCell]] = (mrv)->next[iCell]; \
+        } else {                                                               \
+            (mrv)->next[(mrv)->prev[iCell]] = (mrv)->next[iCell];              \
+        }                                                                      \
+        if ((mrv)->next[iCell] != MRV_NIL) {                                   \
+            (mrv)->prev[(mrv)->next[iCell]] = (mrv)->prev[iCell];              \
+        }                                                                      \
+    } while (0)
+
+/// @brief Links a cell at the head of the bucket list of its count.
+#define mrv_link(mrv, iCell)                                                 \
+    do {                                                                     \
+        tIntCell const _head = (mrv)->bucketHeads[(mrv)->possibleCounts[iCell]]; \
+        (mrv)->prev[iCell] = MRV_NIL;                                        \
+        (mrv)->next[iCell] = _head;                                          \
+        if (_head != MRV_NIL) {                                              \
+            (mrv)->prev[_head] = (iCell);                                    \
+        }                                                                    \
+        (mrv)->bucketHeads[(mrv)->possibleCounts[iCell]] = (iCell);          \
+        (mrv)->minCount = min((mrv)->minCount, (mrv)->possibleCounts[iCell]); \
+    } while (0)
+
+tIntCell mrv_popMin(tMrv *mrv) {
+    assert(!mrv_isEmpty(*mrv));
+
+    while (mrv->bucketHeads[mrv->minCount] == MRV_NIL) {
+        mrv->minCount++;
+    }
+
+    tIntCell const iCell = mrv->bucketHeads[mrv->minCount];
+    mrv_unlink(mrv, iCell);
+    mrv->isIndexed[iCell] = false;
+    mrv->cellCount--;
+
+    return iCell;
+}
+
+void mrv_push(tMrv *mrv, tIntCell iCell) {
+    assert(!mrv->isIndexed[iCell]);
+
+    mrv_link(mrv, iCell);
+    mrv->isIndexed[iCell] = true;
+    mrv->cellCount++;
+}
+
+void mrv_updatePeer(tMrv *mrv, tGrid const *grid, tIntSize row,
+    tIntSize column, tIntSize value, int delta) {
+    tIntCell const iCell = mrv_cellIndex(*grid, row, column);
+
+    if (mrv->isIndexed[iCell] && grid_possible(*grid, row, column, value)) {
+        mrv_unlink(mrv, iCell);
+        mrv->possibleCounts[iCell] += delta;
+        mrv_link(mrv, iCell);
+    }
+}
+
+void mrv_markValueFree(bool isFree, tMrv *mrv, tGrid *grid, tIntSize row,
+    tIntSize column, tIntSize value) {
+    // A peer loses the value when it is marked as not free, and gets it back
+    // when it is freed. Check the peers while the value is free, so before
+    // marking it as not free and after marking it as free.
+    if (isFree) {
+        grid_markValueFree(true, *grid, row, column, value);
+    }
+
+    int const delta = isFree ? 1 : -1;
+
+    tIntCell const *peers = grid_cellPeers(grid, at2d(grid_size(*grid), row, column));
+    for (tIntCell i = 0; i < grid_peerCount(*grid); i++) {
+        tPosition const pos = grid_cellPosition(*grid, peers[i]);
+        mrv_updatePeer(mrv, grid, pos.row, pos.column, value, delta);
+    }
+
+    if (!isFree) {
+        grid_markValueFree(false, *grid, row, column, value);
+    }
+}
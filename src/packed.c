@@ -0,0 +1,320 @@
+/** @file
+ * @brief Packed grid format
+ * @author 5cover, Matteo-K
+ *
+ * A compact alternative to the Sud format for archives of grids.
+ *
+ * A packed stream starts with a header of @ref PACKED_HEADER_SIZE bytes: the
+ * magic "SUDP", the version, the flags, N, a reserved byte, and the number of
+ * grids as a 32-bit little-endian integer, or @ref PACKED_COUNT_UNKNOWN when
+ * the grids go on until the end of the stream. As a Sud value, the magic would
+ * be greater than any grid size, so the formats can't be mistaken for one
+ * another.
+ *
+ * The grids follow, each starting on a byte boundary. Their bits are stored
+ * from the least significant bit of each byte. In the default mode, the SIZE²
+ * values are stored row by row on ceil(log2(SIZE + 1)) bits each. With @ref
+ * PACKED_FLAG_RLE, the runs of empty cells are run-length encoded: each value
+ * is preceded by the number of empty cells before it, as an Elias gamma code
+ * of the number plus one, and is stored minus one on ceil(log2(SIZE)) bits. If
+ * the grid ends with empty cells, their number follows the last value.
+ *
+ * The packed mode suits solved grids, the run-length mode sparse puzzles: 9×9
+ * grids take 41 bytes, and about 25 with 25 clues, instead of 324.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "const.c"
+#include "grid.c"
+#include "types.c"
+
+/// @brief Integer: magic number of a packed stream ("SUDP" in little-endian).
+#define PACKED_MAGIC 0x50445553
+/// @brief Integer: version of the packed format.
+#define PACKED_VERSION 1
+/// @brief Integer: size of the header of a packed stream, in bytes.
+#define PACKED_HEADER_SIZE 12
+/// @brief Integer: grid count of a packed stream whose grids go on until the
+/// end of the stream.
+#define PACKED_COUNT_UNKNOWN UINT32_MAX
+
+/// @brief Integer: flag: the runs of empty cells are run-length encoded.
+#define PACKED_FLAG_RLE 1
+
+/// @brief The header of a packed stream.
+typedef struct {
+    /// @brief Grid size factor.
+    tIntN N;
+    /// @brief Combination of PACKED_FLAG_* flags.
+    uint8_t flags;
+    /// @brief Number of grids, or @ref PACKED_COUNT_UNKNOWN.
+    uint32_t count;
+} tPackedHeader;
+
+/// @brief Determines whether bytes start with the magic number of a packed
+/// stream.
+/// @param bytes in: at least 4 bytes
+#define packed_isMagic(bytes) \
+    ((bytes)[0] == 'S' && (bytes)[1] == 'U' && (bytes)[2] == 'D' && (bytes)[3] == 'P')
+
+/// @brief Parses the header of a packed stream.
+/// @param bytes in: the @ref PACKED_HEADER_SIZE bytes of the header
+/// @param header out: the header
+/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if the header
+/// is invalid or of another version.
+int packed_parseHeader(uint8_t const *bytes, tPackedHeader *header);
+
+/// @brief Writes the header of a packed stream.
+/// @param header in: the header
+/// @param outStream in: the stream to write to
+void packed_writeHeader(tPackedHeader header, FILE *outStream);
+
+/// @brief Gets the maximum size of a packed grid.
+/// @param N in: grid size factor
+/// @param flags in: flags of the stream
+/// @return The maximum size of a grid, in bytes.
+size_t packed_maxGridSize(tIntN N, uint8_t flags);
+
+/// @brief Encodes a grid.
+/// @param sudValues in: the SIZE² Sud values of the grid, each at most SIZE
+/// @param N in: grid size factor
+/// @param flags in: flags of the stream
+/// @param bytes out: at least @ref packed_maxGridSize bytes
+/// @return The size of the encoded grid, in bytes.
+size_t packed_encode(uint32_t const *sudValues, tIntN N, uint8_t flags, uint8_t *bytes);
+
+/// @brief Decodes a grid.
+/// @param bytes in: the bytes of the grid
+/// @param size in: the number of bytes available
+/// @param N in: grid size factor
+/// @param flags in: flags of the stream
+/// @param sudValues out: the SIZE² Sud values of the grid
+/// @param used out: the size of the encoded grid, in bytes
+/// @return 0 if everything went well, or @ref ERROR_INVALID_DATA if the grid
+/// is truncated or malformed.
+/// @remark The values aren't checked against SIZE: @ref grid_loadSudValues
+/// does it.
+int packed_decode(uint8_t const *bytes, size_t size, tIntN N, uint8_t flags, uint32_t *sudValues, size_t *used);
+
+/// @brief Writes a grid in the packed format.
+/// @param grid in: the grid
+/// @param flags in: flags of the stream, whose header has been written
+/// @param buffer in: room for @ref packed_maxGridSize bytes
+/// @param outStream in: the stream to write to
+void packed_writeGrid(tGrid const *grid, uint8_t flags, uint8_t *buffer, FILE *outStream);
+
+/////////////////////////////////////////////////////////////////////////
+
+/// @brief Writes bits from the least significant bit of each byte.
+typedef struct {
+    uint8_t *bytes;
+    size_t size;
+    uint64_t bits;
+    unsigned bitCount;
+} tBitWriter;
+
+/// @brief Reads bits from the least significant bit of each byte.
+typedef struct {
+    uint8_t const *bytes;
+    size_t size;
+    size_t position;
+    uint64_t bits;
+    unsigned bitCount;
+} tBitReader;
+
+/// @brief Gets the number of bits needed to store the integers [0 ; count[.
+#define packed_bitWidth(count)                   \
+    __extension__({                              \
+        unsigned _width = 0;                     \
+        while ((1ull << _width) < (count)) {     \
+            _width++;                            \
+        }                                        \
+        _width;                                  \
+    })
+
+/// @brief Writes bits.
+/// @param writer in/out: the writer
+/// @param value in: the bits, as an integer
+/// @param count in: the number of bits, at most 32
+static inline void bitWriter_write(tBitWriter *writer, uint32_t value, unsigned count) {
+    writer->bits |= (uint64_t)value << writer->bitCount;
+    writer->bitCount += count;
+    while (writer->bitCount >= 8) {
+        writer->bytes[writer->size++] = (uint8_t)writer->bits;
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+    }
+}
+
+/// @brief Writes the last partial byte of a writer.
+/// @return The number of bytes written.
+static inline size_t bitWriter_flush(tBitWriter *writer) {
+    if (writer->bitCount > 0) {
+        writer->bytes[writer->size++] = (uint8_t)writer->bits;
+        writer->bits = writer->bitCount = 0;
+    }
+    return writer->size;
+}
+
+/// @brief Reads bits.
+/// @param reader in/out: the reader
+/// @param value out: the bits, as an integer
+/// @param count in: the number of bits, at most 32
+/// @return Whether there were enough bits.
+static inline bool bitReader_read(tBitReader *reader, uint32_t *value, unsigned count) {
+    while (reader->bitCount < count) {
+        if (reader->position == reader->size) {
+            return false;
+        }
+        reader->bits |= (uint64_t)reader->bytes[reader->position++] << reader->bitCount;
+        reader->bitCount += 8;
+    }
+    *value = (uint32_t)(reader->bits & ((1ull << count) - 1));
+    reader->bits >>= count;
+    reader->bitCount -= count;
+    return true;
+}
+
+/// @brief Writes the Elias gamma code of a positive integer: as many zeros as
+/// its bits after the leading one, a one, then those bits.
+static inline void bitWriter_writeGamma(tBitWriter *writer, uint32_t value) {
+    unsigned const width = packed_bitWidth((uint64_t)value + 1) - 1;
+    for (unsigned i = 0; i < width; i++) {
+        bitWriter_write(writer, 0, 1);
+    }
+    bitWriter_write(writer, 1, 1);
+    bitWriter_write(writer, value & ((1u << width) - 1), width);
+}
+
+/// @brief Reads the Elias gamma code of a positive integer.
+/// @return Whether there were enough bits and the integer fits in 32 bits.
+static inline bool bitReader_readGamma(tBitReader *reader, uint32_t *value) {
+    unsigned width = 0;
+    uint32_t bit;
+    while (bitReader_read(reader, &bit, 1) && bit == 0) {
+        if (++width > 31) {
+            return false;
+        }
+    }
+    uint32_t low;
+    if (bit != 1 || !bitReader_read(reader, &low, width)) {
+        return false;
+    }
+    *value = (1u << width) | low;
+    return true;
+}
+
+int packed_parseHeader(uint8_t const *bytes, tPackedHeader *header) {
+    if (!packed_isMagic(bytes) || bytes[4] != PACKED_VERSION || (bytes[5] & ~PACKED_FLAG_RLE) != 0 || bytes[6] == 0) {
+        return ERROR_INVALID_DATA;
+    }
+
+    *header = (tPackedHeader) {
+        .flags = bytes[5],
+        .N = bytes[6],
+        .count = bytes[8] | (uint32_t)bytes[9] << 8 | (uint32_t)bytes[10] << 16 | (uint32_t)bytes[11] << 24,
+    };
+    return 0;
+}
+
+void packed_writeHeader(tPackedHeader header, FILE *outStream) {
+    uint8_t const bytes[PACKED_HEADER_SIZE] = {
+        'S', 'U', 'D', 'P',
+        PACKED_VERSION,
+        header.flags,
+        header.N,
+        0,
+        (uint8_t)header.count,
+        (uint8_t)(header.count >> 8),
+        (uint8_t)(header.count >> 16),
+        (uint8_t)(header.count >> 24),
+    };
+    fwrite(bytes, 1, sizeof bytes, outStream);
+}
+
+size_t packed_maxGridSize(tIntN N, uint8_t flags) {
+    size_t const size = (size_t)N * N, cellCount = size * size;
+
+    // A run of g empty cells takes at most 2g + 1 bits
+    size_t const bitCount = flags & PACKED_FLAG_RLE
+        ? cellCount * (packed_bitWidth(size) + 2) + 1
+        : cellCount * packed_bitWidth(size + 1);
+    return (bitCount + 7) / 8;
+}
+
+size_t packed_encode(uint32_t const *sudValues, tIntN N, uint8_t flags, uint8_t *bytes) {
+    size_t const size = (size_t)N * N, cellCount = size * size;
+    tBitWriter writer = { .bytes = bytes };
+
+    if (flags & PACKED_FLAG_RLE) {
+        unsigned const width = packed_bitWidth(size);
+        uint32_t run = 0;
+        for (size_t iCell = 0; iCell < cellCount; iCell++) {
+            if (sudValues[iCell] == 0) {
+                run++;
+            } else {
+                bitWriter_writeGamma(&writer, run + 1);
+                bitWriter_write(&writer, sudValues[iCell] - 1, width);
+                run = 0;
+            }
+        }
+        if (run > 0) {
+            bitWriter_writeGamma(&writer, run + 1);
+        }
+    } else {
+        unsigned const width = packed_bitWidth(size + 1);
+        for (size_t iCell = 0; iCell < cellCount; iCell++) {
+            bitWriter_write(&writer, sudValues[iCell], width);
+        }
+    }
+
+    return bitWriter_flush(&writer);
+}
+
+int packed_decode(uint8_t const *bytes, size_t size, tIntN N, uint8_t flags, uint32_t *sudValues, size_t *used) {
+    size_t const gridSize = (size_t)N * N, cellCount = gridSize * gridSize;
+    tBitReader reader = { .bytes = bytes, .size = size };
+
+    if (flags & PACKED_FLAG_RLE) {
+        unsigned const width = packed_bitWidth(gridSize);
+        size_t iCell = 0;
+        while (iCell < cellCount) {
+            uint32_t run, value;
+            if (!bitReader_readGamma(&reader, &run) || run - 1 > cellCount - iCell) {
+                return ERROR_INVALID_DATA;
+            }
+            for (uint32_t i = 1; i < run; i++) {
+                sudValues[iCell++] = 0;
+            }
+            if (iCell == cellCount) {
+                break;
+            }
+            if (!bitReader_read(&reader, &value, width)) {
+                return ERROR_INVALID_DATA;
+            }
+            sudValues[iCell++] = value + 1;
+        }
+    } else {
+        unsigned const width = packed_bitWidth(gridSize + 1);
+        for (size_t iCell = 0; iCell < cellCount; iCell++) {
+            if (!bitReader_read(&reader, &sudValues[iCell], width)) {
+                return ERROR_INVALID_DATA;
+            }
+        }
+    }
+
+    *used = reader.position;
+    return 0;
+}
+
+void packed_writeGrid(tGrid const *grid, uint8_t flags, uint8_t *buffer, FILE *outStream) {
+    // Serialize the values in the Sud buffer, like grid_write
+    grid_storeSudValues(grid, grid->_sudValues);
+    size_t const size = packed_encode(grid->_sudValues, grid->N, flags, buffer);
+    fwrite(buffer, 1, size, outStream);
+}
@@ -0,0 +1,346 @@
+/** @file
+ * @brief Constraint propagation with trail-based undo
+ * @author 5cover, Matteo-K
+ *
+ * Places values and removes candidates while keeping the candidates of the
+ * grid consistent, propagating naked and hidden singletons. Every change is
+ * recorded on a trail so that a search can undo its guesses without copying
+ * the grid.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "types.c"
+
+/// @brief A change recorded on the trail.
+typedef struct {
+    /// @brief Flat index of the changed cell.
+    tIntCell iCell;
+    /// @brief The removed candidate, or the placed value.
+    tIntSize value;
+    /// @brief Whether the change is a value placement (otherwise it is a
+    /// candidate removal).
+    bool isPlacement;
+} tTrailEntry;
+
+/// @brief A guess of the propagating backtracking: a cell and the candidate
+/// tried on it.
+typedef struct {
+    /// @brief Flat index of the cell.
+    tIntCell iCell;
+    /// @brief First candidate to try. The candidates are tried in circular
+    /// order from it.
+    tIntSize first;
+    /// @brief Candidate being tried, or 0 before the first one.
+    tIntSize value;
+    /// @brief Trail count before the guess, where its attempts are undone to.
+    size_t mark;
+    /// @brief Number of solutions found before the guess.
+    unsigned count;
+} tTrailGuess;
+
+/// @brief Undo trail and propagation state of a grid.
+typedef struct {
+    /// @brief Recorded changes, oldest first.
+    /// @remark Capacity: SIZE² * (SIZE + 1), the maximum amount of changes
+    /// that can be made to a grid.
+    tTrailEntry *entries;
+
+    /// @brief Number of recorded changes.
+    size_t count;
+
+    /// @brief Flat indexes of the cells left with a single candidate that have
+    /// not been placed yet.
+    /// @remark Capacity: SIZE².
+    tIntCell *nakedSingles;
+
+    /// @brief Number of cells in @ref nakedSingles.
+    size_t nakedSingleCount;
+
+    /// @brief Stack of the guesses of the propagating backtracking, from the
+    /// first one.
+    /// @remark Dimensions: [depth] (at most one guess per cell)
+    tTrailGuess *guesses;
+} tTrail;
+
+/// @brief Gets the number of bytes a trail takes in the arena of a grid.
+/// @param N in: grid size factor
+size_t trail_arenaSize(tIntN N);
+
+/// @brief Creates an empty trail for a grid.
+/// @param grid in/out: the grid. The trail is allocated in its arena, which
+/// must have @ref trail_arenaSize bytes reserved for it.
+/// @return A new trail. It lives as long as the grid.
+tTrail trail_create(tGrid *grid);
+
+/// @brief Undoes the changes recorded after a mark.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail
+/// @param mark in: a previous value of @c trail->count
+void trail_undo(tGrid *grid, tTrail *trail, size_t mark);
+
+/// @brief Empties the trail and makes the candidates of the grid consistent
+/// with its values.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail, created for a grid of the same size
+/// @return Whether every empty cell still has a candidate.
+/// @remark Must be called before propagating on candidates computed by other
+/// techniques. The changes are not recorded on the trail.
+bool propagation_init(tGrid *grid, tTrail *trail);
+
+/// @brief Removes a candidate from a cell and records it.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param candidate in: the candidate to remove
+/// @return Whether the cell still has candidates or a value.
+bool propagation_removeCandidate(tGrid *grid, tTrail *trail, tIntSize row,
+    tIntSize column, tIntSize candidate);
+
+/// @brief Places a value on a cell, removes it from the candidates of its
+/// peers and records it.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail
+/// @param row in: the cell's row
+/// @param column in: the cell's column
+/// @param value in: the value to place. Must be a candidate of the cell.
+/// @return Whether no contradiction has been found.
+bool propagation_placeValue(tGrid *grid, tTrail *trail, tIntSize row,
+    tIntSize column, tIntSize value);
+
+/// @brief Places the hidden singletons of a unit.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail
+/// @param unit in: the unit index
+/// @param progress out: set to @c true if a value has been placed
+/// @return Whether no contradiction has been found.
+bool propagation_hiddenSingletons(tGrid *grid, tTrail *trail, tIntCell unit,
+    bool *progress);
+
+/// @brief Propagates naked and hidden singletons until none are left.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail
+/// @return Whether no contradiction has been found.
+bool propagation_propagate(tGrid *grid, tTrail *trail);
+
+/////////////////////////////////////////////////////////////////////////
+
+size_t trail_arenaSize(tIntN N) {
+    size_t const size = (size_t)N * N, cellCount = size * size;
+    tTrail trail;
+
+    return arena_blockSize(sizeof *trail.entries * cellCount * (size + 1))
+        + arena_blockSize(sizeof *trail.nakedSingles * cellCount)
+        + arena_blockSize(sizeof *trail.guesses * cellCount);
+}
+
+tTrail trail_create(tGrid *grid) {
+    size_t const cellCount = (size_t)grid_size(*grid) * grid_size(*grid);
+
+    tTrail trail = {
+        .count = 0,
+        .nakedSingleCount = 0,
+    };
+    trail.entries = check_alloc(arena_array(&grid->_arena, trail.entries, cellCount * (grid_size(*grid) + 1)),
+        "trail entries array");
+    trail.nakedSingles = check_alloc(arena_array(&grid->_arena, trail.nakedSingles, cellCount),
+        "trail nakedSingles array");
+    trail.guesses = check_alloc(arena_array(&grid->_arena, trail.guesses, cellCount),
+        "trail guesses array");
+
+    return trail;
+}
+
+void trail_undo(tGrid *grid, tTrail *trail, size_t mark) {
+    assert(mark <= trail->count);
+
+    trail->nakedSingleCount = 0;
+
+    while (trail->count > mark) {
+        tTrailEntry const entry = trail->entries[--trail->count];
+        tCell const cell = grid_cellAtIndex(*grid, entry.iCell);
+
+        if (entry.isPlacement) {
+            tPosition const pos = grid_cellPosition(*grid, entry.iCell);
+            cell_value(cell) = 0;
+            grid_markValueFree(true, *grid, pos.row, pos.column, entry.value);
+        } else {
+            bitset_add(cell.candidates, entry.value);
+            cell_candidate_count(cell)++;
+        }
+    }
+}
+
+bool propagation_init(tGrid *grid, tTrail *trail) {
+    trail->count = 0;
+    trail->nakedSingleCount = 0;
+
+    for (tIntSize r = 0; r < grid_size(*grid); r++) {
+        for (tIntSize c = 0; c < grid_size(*grid); c++) {
+            tCell const cell = grid_cellAt(*grid, r, c);
+            if (cell_hasValue(cell)) {
+                continue;
+            }
+
+            // Only keep the candidates that are still possible values
+            for (tIntSize word = 0; word < grid->_candidateWordCount; word++) {
+                cell.candidates[word] &= grid_cellPossibleValuesWord(*grid, r, c, word);
+            }
+            cell_candidate_count(cell) = bitset_count(cell.candidates, grid->_candidateWordCount);
+
+            if (cell_candidate_count(cell) == 0) {
+                return false;
+            }
+            if (cell_candidate_count(cell) == 1) {
+                trail->nakedSingles[trail->nakedSingleCount++] = at2d(grid_size(*grid), r, c);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool propagation_removeCandidate(tGrid *grid, tTrail *trail, tIntSize row,
+    tIntSize column, tIntSize candidate) {
+    tCell const cell = grid_cellAt(*grid, row, column);
+
+    if (!cell_hasCandidate(cell, candidate)) {
+        return true;
+    }
+
+    tIntCell const iCell = at2d(grid_size(*grid), row, column);
+
+    bitset_remove(cell.candidates, candidate);
+    cell_candidate_count(cell)--;
+    trail->entries[trail->count++] = (tTrailEntry) {
+        .iCell = iCell,
+        .value = candidate,
+        .isPlacement = false,
+    };
+    stats_add(grid->stats, eliminated, 1);
+
+    // Placed cells have no candidates, so the cell is empty.
+    if (cell_candidate_count(cell) == 1) {
+        trail->nakedSingles[trail->nakedSingleCount++] = iCell;
+    }
+
+    return cell_candidate_count(cell) != 0;
+}
+
+bool propagation_placeValue(tGrid *grid, tTrail *trail, tIntSize row,
+    tIntSize column, tIntSize value) {
+    tCell const cell = grid_cellAt(*grid, row, column);
+
+    assert(!cell_hasValue(cell));
+    assert(cell_hasCandidate(cell, value));
+
+    // Remove all the other candidates of the cell
+    for (unsigned candidate = grid_cell_nextCandidate(*grid, cell, 0);
+        candidate <= grid_size(*grid);
+        candidate = grid_cell_nextCandidate(*grid, cell, candidate)) {
+        bitset_remove(cell.candidates, candidate);
+        trail->entries[trail->count++] = (tTrailEntry) {
+            .iCell = at2d(grid_size(*grid), row, column),
+            .value = candidate,
+            .isPlacement = false,
+        };
+    }
+    cell_candidate_count(cell) = 0;
+
+    cell_value(cell) = value;
+    grid_markValueFree(false, *grid, row, column, value);
+    trail->entries[trail->count++] = (tTrailEntry) {
+        .iCell = at2d(grid_size(*grid), row, column),
+        .value = value,
+        .isPlacement = true,
+    };
+    stats_add(grid->stats, placed, 1);
+
+    // Remove the value from the candidates of the peers
+    tIntCell const *peers = grid_cellPeers(grid, at2d(grid_size(*grid), row, column));
+    for (tIntCell i = 0; i < grid_peerCount(*grid); i++) {
+        tPosition const pos = grid_cellPosition(*grid, peers[i]);
+        if (!propagation_removeCandidate(grid, trail, pos.row, pos.column, value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool propagation_hiddenSingletons(tGrid *grid, tTrail *trail, tIntCell unit,
+    bool *progress) {
+    tIntCell const *cells = grid_unitCells(*grid, unit);
+    tBitWord const *unitValues = grid_unitValues(*grid, unit);
+
+    grid_countGroupCandidates(grid, unit);
+
+    for (tIntSize word = 0; word < grid->_candidateWordCount; word++) {
+        // A value that is neither present nor a candidate cannot be placed
+        tBitWord const freeValues = ~unitValues[word];
+        if ((freeValues & ~grid_groupAtLeastOnce(*grid, word)) != 0) {
+            return false;
+        }
+
+        for (tBitWord unique = grid_groupExactlyOnce(*grid, word); unique != 0; unique &= unique - 1) {
+            tIntSize const value = word * BITWORD_BITS + bitword_first(unique);
+
+            // Find the cell: an earlier placement may have taken it
+            tIntSize i = 0;
+            while (i < grid_size(*grid) - 1 && !cell_hasCandidate(grid_cellAtIndex(*grid, cells[i]), value)) {
+                i++;
+            }
+
+            tPosition const pos = grid_cellPosition(*grid, cells[i]);
+            if (!cell_hasCandidate(grid_cellAtIndex(*grid, cells[i]), value)
+                || !propagation_placeValue(grid, trail, pos.row, pos.column, value)) {
+                return false;
+            }
+            *progress = true;
+        }
+    }
+
+    return true;
+}
+
+bool propagation_propagate(tGrid *grid, tTrail *trail) {
+    bool progress;
+
+    do {
+        // Naked singletons
+        while (trail->nakedSingleCount > 0) {
+            tIntCell const iCell = trail->nakedSingles[--trail->nakedSingleCount];
+            tPosition const pos = grid_cellPosition(*grid, iCell);
+            tCell const cell = grid_cellAtIndex(*grid, iCell);
+
+            // The cell may have been placed as a hidden singleton since
+            if (cell_hasValue(cell)) {
+                continue;
+            }
+
+            cell_get_first_candidate(cell, value);
+            if (!propagation_placeValue(grid, trail, pos.row, pos.column, value)) {
+                trail->nakedSingleCount = 0;
+                return false;
+            }
+        }
+
+        // Hidden singletons
+        progress = false;
+        for (tIntCell unit = 0; unit < grid_unitCount(*grid); unit++) {
+            if (!propagation_hiddenSingletons(grid, trail, unit, &progress)) {
+                trail->nakedSingleCount = 0;
+                return false;
+            }
+        }
+    } while (progress || trail->nakedSingleCount > 0);
+
+    return true;
+}
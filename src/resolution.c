@@ -6,24 +6,33 @@
 #pragma once
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "grid.c"
+#include "mrv.c"
+#include "propagation.c"
 #include "types.c"
 
-/// @brief Performs the simple techniques on the grid.
+/// @brief Performs the simple techniques on the cells of the queued units of
+/// the grid, until the queue is empty.
 /// @param grid in/out: the grid
+/// @param pairs in: whether to perform the pair techniques, or only the
+/// singleton ones
 /// @return Whether progress has been made.
-bool perform_simpleTechniques(tGrid *grid);
+/// @remark The changes made by the techniques queue the units of the changed
+/// cells, so that the cells that may allow further progress are examined again.
+bool perform_simpleTechniques(tGrid *grid, bool pairs);
 
 /// @brief Performs the backtracking technique.
 /// @param grid in/out: the grid
-/// @param emptyCellPositions in/out: the empty cell positions
-/// @param emptyCellCount in: the amount of empty cells (length of @p
-/// emptyCellPositions)
-/// @param iEmptyCellPositions in: index of the empty cell to start the
-/// backtracking from
+/// @param mrv in/out: the index of the empty cells left to solve. Cells are
+/// picked from it by least possible values.
+/// @param cancel in: when set by another thread, the search stops and fails.
+/// May be NULL.
 /// @return Whether progress has been made.
 /// @remark This technique must be performed last, as it will always solve the
 /// grid completely.
@@ -31,21 +40,125 @@ bool perform_simpleTechniques(tGrid *grid);
 /// the grid have an inconsistent state. This choice was made because it offers
 /// a performance gain and we no longer need the candidates once the grid is
 /// solved.
-bool technique_backtracking(tGrid *grid, tPosition *emptyCellPositions,
-    tIntSize emptyCellCount,
-    tIntSize iEmptyCellPosition);
+/// @remark The search is iterative: the guesses are kept on the stack of @p
+/// mrv rather than in recursive calls, so its depth is only bounded by the
+/// number of cells.
+bool technique_backtracking(tGrid *grid, tMrv *mrv, atomic_bool const *cancel);
 
-/// @brief Swaps the cell at @p iHere with the cell after @p iHere having the
-/// least possible values in @p emptyCellPositions.
+/// @brief Performs the backtracking technique with constraint propagation.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail recording the changes made to the grid.
+/// @ref propagation_init must have been called on it.
+/// @param cancel in: when set by another thread, the search stops and fails.
+/// May be NULL.
+/// @return Whether the grid has been solved.
+/// @remark This technique must be performed last, as it will always solve the
+/// grid completely.
+/// @remark Unlike @ref technique_backtracking, this technique keeps the
+/// candidates consistent: naked and hidden singletons are propagated after each
+/// guess, and guesses are undone by popping the trail.
+bool technique_propagatingBacktracking(tGrid *grid, tTrail *trail, atomic_bool const *cancel);
+
+/// @brief Counts the solutions of a grid by backtracking, up to a limit.
+/// @param grid in/out: the grid
+/// @param mrv in/out: the index of the empty cells left to solve
+/// @param limit in: the number of solutions at which the search stops
+/// @param count in/out: the number of solutions found so far
+/// @param solution out: assigned to the Sud values of the first solution found
+/// @return Whether the limit has been reached.
+/// @remark Like @ref technique_backtracking, but the search goes on after a
+/// solution. Unless the limit is reached, the grid and the index are left
+/// unchanged.
+bool technique_countingBacktracking(tGrid *grid, tMrv *mrv, unsigned limit,
+    unsigned *count, uint32_t *solution);
+
+/// @brief Counts the solutions of a grid by backtracking with constraint
+/// propagation, up to a limit.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail recording the changes made to the grid.
+/// @ref propagation_init must have been called on it.
+/// @param limit in: the number of solutions at which the search stops
+/// @param count in/out: the number of solutions found so far
+/// @param solution out: assigned to the Sud values of the first solution found
+/// @return Whether the limit has been reached.
+/// @remark Like @ref technique_propagatingBacktracking, but the search goes on
+/// after a solution.
+bool technique_countingPropagatingBacktracking(tGrid *grid, tTrail *trail,
+    unsigned limit, unsigned *count, uint32_t *solution);
+
+/// @brief Performs the backtracking technique, trying the values of each cell
+/// in a random order.
+/// @param grid in/out: the grid
+/// @param mrv in/out: see @ref technique_backtracking
+/// @param random in/out: the state of the pseudo-random generator (see @ref
+/// random_next)
+/// @return Whether the grid has been solved.
+/// @remark The values of a cell are tried in circular order from a random one,
+/// so that solving an empty grid gives a random solution.
+bool technique_randomBacktracking(tGrid *grid, tMrv *mrv, uint64_t *random);
+
+/// @brief Searches the solutions of a grid by backtracking on the empty cells
+/// of an index, up to a limit.
+/// @param grid in/out: the grid
+/// @param mrv in/out: the index of the empty cells left to solve
+/// @param cancel in: when set by another thread, the search stops and fails.
+/// May be NULL.
+/// @param random in/out: the state of the pseudo-random generator to pick the
+/// first value tried on each cell, or NULL to start from its value in the
+/// pattern solution (see @ref grid_patternValue)
+/// @param limit in: the number of solutions at which the search stops
+/// @param count in/out: the number of solutions found so far
+/// @param solution out: assigned to the Sud values of the first solution
+/// found. May be NULL.
+/// @return Whether the limit has been reached, in which case the grid holds the
+/// last solution found. Otherwise, the grid and the index are left unchanged.
+/// @remark Used in @ref technique_backtracking, @ref
+/// technique_countingBacktracking and @ref technique_randomBacktracking.
+bool technique_mrvBacktracking(tGrid *grid, tMrv *mrv, atomic_bool const *cancel,
+    uint64_t *random, unsigned limit, unsigned *count, uint32_t *solution);
+
+/// @brief Searches the solutions of a grid by backtracking with constraint
+/// propagation, up to a limit.
+/// @param grid in/out: the grid
+/// @param trail in/out: the trail recording the changes made to the grid.
+/// @ref propagation_init must have been called on it.
+/// @param cancel in: when set by another thread, the search stops and fails.
+/// May be NULL.
+/// @param limit in: the number of solutions at which the search stops
+/// @param count in/out: the number of solutions found so far
+/// @param solution out: assigned to the Sud values of the first solution
+/// found. May be NULL.
+/// @return Whether the limit has been reached, in which case the grid holds the
+/// last solution found. Otherwise, the grid and the trail are left unchanged.
+/// @remark The guesses are kept on the stack of the trail, each undone by
+/// popping the trail to its mark.
+/// @remark Used in @ref technique_propagatingBacktracking and @ref
+/// technique_countingPropagatingBacktracking.
+bool technique_trailBacktracking(tGrid *grid, tTrail *trail, atomic_bool const *cancel,
+    unsigned limit, unsigned *count, uint32_t *solution);
+
+/// @brief Gets the next value to try on the cell of a guess.
+/// @param grid in: the grid
+/// @param guess in: the guess
+/// @return The next possible value of the cell in circular order from the
+/// first value of @p guess, or a value greater than @ref SIZE if all have been
+/// tried.
+/// @remark Used in @ref technique_mrvBacktracking.
+tIntSize technique_mrvBacktracking_nextValue(tGrid const *grid, tMrvGuess const *guess);
+
+/// @brief Gets the next candidate to try on the cell of a guess.
 /// @param grid in: the grid
-/// @param emptyCellPositions in/out: the empty cell positions
-/// @param emptyCellCount in: the amount of empty cells (length of @p
-/// emptyCellPositions)
-/// @param iHere in: the index of the cell to swap
-/// @remark Used in the backtracking technique.
-void technique_backtracking_swap_cells(tGrid const *grid,
-    tPosition *emptyCellPositions,
-    tIntSize emptyCellCount, tIntSize iHere);
+/// @param guess in: the guess
+/// @return The next candidate of the cell in circular order from the first
+/// candidate of @p guess, or a value greater than @ref SIZE if all have been
+/// tried.
+/// @remark Used in @ref technique_trailBacktracking.
+tIntSize technique_trailBacktracking_nextCandidate(tGrid const *grid, tTrailGuess const *guess);
+
+/// @brief Determines whether a search has been cancelled.
+/// @param cancel in: the cancellation flag, or NULL
+#define technique_isCancelled(cancel) \
+    ((cancel) != NULL && atomic_load_explicit((cancel), memory_order_relaxed))
 
 /// @brief Performs the naked singleton technique.
 /// @param grid in/out: the grid
@@ -63,17 +176,13 @@ bool technique_hiddenSingleton(tGrid *grid, tIntSize row, tIntSize column);
 
 /// @brief Finds the unique candidate in a group.
 /// @param grid in: the grid
-/// @param rStart in: search start row
-/// @param rEnd in: search end row (excluded)
-/// @param cStart in: search start column
-/// @param cEnd in: search end column (excluded)
+/// @param unit in: the unit index of the group
 /// @param candidatePosition out: assigned to the position of the unique
 /// candidate found
 /// @return The unique candidate found, or 0 if none was found.
 /// @remark Used in the hidden singleton technique.
 int technique_hiddenSingleton_findUniqueCandidate(
-    tGrid const *grid, tIntSize rStart, tIntSize rEnd, tIntSize cStart,
-    tIntSize cEnd, tPosition *candidatePosition);
+    tGrid const *grid, tIntCell unit, tPosition *candidatePosition);
 
 /// @brief Performs the naked pair technique.
 /// @param grid in/out: the grid
@@ -100,19 +209,14 @@ bool technique_hiddenPair(tGrid *grid, tIntSize row, tIntSize column);
 
 /// @brief Finds a pair present exactly twice in a group.
 /// @param grid in: the grid
-/// @param rStart in: search start row
-/// @param rEnd in: search end row (excluded)
-/// @param cStart in: search start column
-/// @param cEnd in: search end column (excluded)
+/// @param unit in: the unit index of the group
 /// @param pairCellPositions in/out: positions of the cells containing the found
 /// pair. The first element must contain the position of the first cell
 /// containing the pair.
 /// @param candidates out: filled with the pair's candididates
 /// @return Whether a pair has been found.
 /// @remark Used in the hidden singleton technique.
-bool technique_hiddenPair_findPair(tGrid const *grid, tIntSize rStart,
-    tIntSize rEnd, tIntSize cStart,
-    tIntSize cEnd,
+bool technique_hiddenPair_findPair(tGrid const *grid, tIntCell unit,
     tPosition pairCellPositions[PAIR_SIZE],
     tIntSize candidates[PAIR_SIZE]);
 
@@ -125,141 +229,348 @@ bool technique_hiddenPair_removePairCells(
     tGrid *grid, tPosition const pairCellPositions[PAIR_SIZE],
     tIntSize const candidates[PAIR_SIZE]);
 
-/// @brief Finds the cells containing a pair of candidates.
+/// @brief Checks if a candidate is present exactly twice in the last group
+/// counted with @ref grid_countGroupCandidates.
+/// @remark Used in the hidden pair technique.
+#define technique_hiddenPair_isTwice(grid, candidate) \
+    ((grid_groupExactlyTwice(grid, (candidate) / BITWORD_BITS) & bitset_mask(candidate)) != 0)
+
+/// @brief Finds the cell other than a given one containing a candidate in a
+/// group.
 /// @param grid in: the grid
-/// @param candidates in: the pair's candidates
-/// @param rStart in: search start row
-/// @param rEnd in: search end row (excluded)
-/// @param cStart in: search start column
-/// @param cEnd in: search end column (excluded)
-/// @param pairCellPositions out: assigned to the positions of the cells
-/// containing the pair
-/// @return Whether a pair has been found.
-bool technique_hiddenPair_findPairCells(tGrid const *grid,
-    tIntSize const candidates[PAIR_SIZE],
-    tIntSize rStart, tIntSize rEnd,
-    tIntSize cStart, tIntSize cEnd,
-    tPosition pairCellPositions[PAIR_SIZE]);
+/// @param candidate in: the candidate
+/// @param unit in: the unit index of the group
+/// @param pairCellPositions in/out: the first element is the cell to skip. The
+/// second is assigned to the position of the cell found.
+/// @remark Used in the hidden pair technique. The candidate must be present in
+/// another cell of the group.
+void technique_hiddenPair_findOtherCell(tGrid const *grid, tIntSize candidate,
+    tIntCell unit, tPosition pairCellPositions[PAIR_SIZE]);
+
+/// @brief State of a fish search: for a candidate, @c size base lines (rows or
+/// columns) whose positions of the candidate all lie in @c size cover lines
+/// (columns or rows). The candidate is then removed from the rest of the cover
+/// lines.
+typedef struct {
+    /// @brief Kind of the base lines: @ref UNIT_COLUMN or @ref UNIT_ROW.
+    tUnitKind baseKind;
+    /// @brief The candidate.
+    tIntSize candidate;
+    /// @brief Number of base lines, in [2 ; @ref FISH_MAX_SIZE].
+    tIntSize size;
+    /// @brief Indexes of the base lines chosen so far, increasing.
+    tIntSize baseLines[FISH_MAX_SIZE];
+} tFish;
+
+/// @brief Performs the fish technique (X-Wing, Swordfish and Jellyfish).
+/// @param grid in/out: the grid
+/// @param since in: a previous value of @c grid->_changeCount. Only the fish
+/// with a base line changed after it are examined: the others have been
+/// examined since their last change.
+/// @return Whether progress has been made.
+bool technique_fish(tGrid *grid, size_t since);
+
+/// @brief Chooses the remaining base lines of a fish.
+/// @param grid in/out: the grid. The positions of the candidates must be
+/// mapped, and the covers of the chosen base lines must be in @c
+/// grid->_fishCovers at @p depth.
+/// @param fish in/out: the fish, with @p depth base lines chosen
+/// @param since in: see @ref technique_fish
+/// @param firstLine in: the first base line that may be chosen next
+/// @param depth in: the number of base lines chosen
+/// @param isChanged in: whether a base line chosen has changed after @p since
+/// @return Whether progress has been made.
+/// @remark Used in the fish technique.
+bool technique_fish_search(tGrid *grid, tFish *fish, size_t since,
+    tIntSize firstLine, tIntSize depth, bool isChanged);
 
-/// @brief Performs the X-Wing technique
+/// @brief Removes the candidate of a complete fish from its cover lines, except
+/// on its base lines.
 /// @param grid in/out: the grid
+/// @param fish in: the fish
 /// @return Whether progress has been made.
-bool technique_x_wing(tGrid *grid);
+/// @remark Used in the fish technique.
+bool technique_fish_eliminate(tGrid *grid, tFish const *fish);
 
 /////////////////////////////////////////////////////////////////
 
-bool perform_simpleTechniques(tGrid *grid) {
+bool perform_simpleTechniques(tGrid *grid, bool pairs) {
     bool progress = false;
-    tCell *cell;
 
-    for (tIntSize r = 0; r < grid_size(*grid); r++) {
-        for (tIntSize c = 0; c < grid_size(*grid); c++) {
+    while (grid_hasQueuedUnits(*grid)) {
+        tIntCell const *cells = grid_unitCells(*grid, grid_popQueuedUnit(grid));
+
+        for (tIntSize i = 0; i < grid_size(*grid); i++) {
             // Executing the techniques in order of increasing complexity.
             // As soon as the value of the cell is defined, we move on to the next
             // one.
 
-            // Save time by avoiding to recalculate the address of the cell each time.
-            cell = &grid_cellAt(*grid, r, c);
+            // Save time by avoiding to recalculate the address of the cell each
+            // time. Only its value is tested, so the sweep only reads the
+            // values array.
+            tIntSize const *value = &grid->values[cells[i]];
 
-            if (cell_hasValue(*cell))
+            if (*value != 0)
                 continue;
 
-            progress |= technique_nakedSingleton(grid, r, c);
-            if (cell_hasValue(*cell))
+            grid->_workCount++;
+            tPosition const pos = grid_cellPosition(*grid, cells[i]);
+
+            progress |= stats_measure(grid->stats, TECHNIQUE_NAKED_SINGLETON, technique_nakedSingleton(grid, pos.row, pos.column));
+            if (*value != 0)
                 continue;
 
-            progress |= technique_hiddenSingleton(grid, r, c);
-            if (cell_hasValue(*cell))
+            progress |= stats_measure(grid->stats, TECHNIQUE_HIDDEN_SINGLETON, technique_hiddenSingleton(grid, pos.row, pos.column));
+            if (*value != 0 || !pairs)
                 continue;
 
-            progress |= technique_nakedPair(grid, r, c);
-            if (cell_hasValue(*cell))
+            progress |= stats_measure(grid->stats, TECHNIQUE_NAKED_PAIR, technique_nakedPair(grid, pos.row, pos.column));
+            if (*value != 0)
                 continue;
 
-            progress |= technique_hiddenPair(grid, r, c);
+            progress |= stats_measure(grid->stats, TECHNIQUE_HIDDEN_PAIR, technique_hiddenPair(grid, pos.row, pos.column));
         }
     }
 
     return progress;
 }
 
-bool technique_backtracking(tGrid *grid, tPosition *emptyCellPositions,
-    tIntSize emptyCellCount, tIntSize iCellPosition) {
-    // This technique does not use candidates but value presence arrays.
-    // The reason is that synchronizing the candidates between recursive calls
-    // requires loops. While for the value arrays it is a simple boolean that
-    // indicates whether a value is present in a group (row, block or column).
+bool technique_backtracking(tGrid *grid, tMrv *mrv, atomic_bool const *cancel) {
+    // This technique does not use candidates but value presence bitsets.
+    // The reason is that synchronizing the candidates between guesses requires
+    // loops. While for the value bitsets it is a single bit that indicates
+    // whether a value is present in a group (row, block or column).
+    unsigned count = 0;
+    return technique_mrvBacktracking(grid, mrv, cancel, NULL, 1, &count, NULL);
+}
 
-    // we have processed all the cells, the grid is solved
-    if (iCellPosition == emptyCellCount) {
-        return true;
-    }
+bool technique_propagatingBacktracking(tGrid *grid, tTrail *trail, atomic_bool const *cancel) {
+    unsigned count = 0;
+    return technique_trailBacktracking(grid, trail, cancel, 1, &count, NULL);
+}
 
-    assert(iCellPosition < emptyCellCount);
+bool technique_randomBacktracking(tGrid *grid, tMrv *mrv, uint64_t *random) {
+    unsigned count = 0;
+    return technique_mrvBacktracking(grid, mrv, NULL, random, 1, &count, NULL);
+}
 
-    // Select the cell to solve
-    technique_backtracking_swap_cells(grid, emptyCellPositions, emptyCellCount,
-        iCellPosition);
+bool technique_countingBacktracking(tGrid *grid, tMrv *mrv, unsigned limit,
+    unsigned *count, uint32_t *solution) {
+    return technique_mrvBacktracking(grid, mrv, NULL, NULL, limit, count, solution);
+}
 
-    tPosition pos = emptyCellPositions[iCellPosition];
+bool technique_mrvBacktracking(tGrid *grid, tMrv *mrv, atomic_bool const *cancel,
+    uint64_t *random, unsigned limit, unsigned *count, uint32_t *solution) {
+    tIntCell depth = 0;
+    bool cancelled = false;
 
-    for (tIntSize value = 1; value <= grid_size(*grid); value++) {
-        if (grid_possible(*grid, pos.row, pos.column, value)) {
-            // assuming that the cell contains this value,
-            grid_markValueFree(false, *grid, pos.row, pos.column, value);
+    while (true) {
+        // A node of the search tree: solved, cancelled, or a new guess on the
+        // cell with the least possible values
+        stats_enterNode(grid->stats);
 
-            // move on to the next cell: recursive call to see if the value is good
-            // afterwards
-            if (technique_backtracking(grid, emptyCellPositions, emptyCellCount,
-                    iCellPosition + 1)) {
-                // the value is good, put it and return.
-                grid_cellAtPos(*grid, pos)._value = value;
+        if (mrv_isEmpty(*mrv)) {
+            // The values of the guesses are in the grid
+            if (solution != NULL && *count == 0) {
+                grid_storeSudValues(grid, solution);
+            }
+            stats_leaveNode(grid->stats, false);
+
+            if (++*count >= limit) {
+                for (; depth > 0; depth--) {
+                    stats_leaveNode(grid->stats, false);
+                }
                 return true;
             }
+        } else if (technique_isCancelled(cancel)) {
+            stats_leaveNode(grid->stats, false);
+            cancelled = true;
+        } else {
+            // Without a random order, the values of the pattern solution are
+            // tried first: they fill an empty or sparse grid without
+            // backtracking, whatever its size.
+            tIntCell const iCell = mrv_popMin(mrv);
+            tPosition const pos = grid_cellPosition(*grid, iCell);
+            mrv->guesses[depth++] = (tMrvGuess) {
+                .iCell = iCell,
+                .first = random == NULL ? grid_patternValue(*grid, pos.row, pos.column)
+                                        : random_below(random, grid_size(*grid)) + 1,
+                .value = 0,
+                .count = *count,
+            };
+        }
+
+        // Try the next value of the last guess, undoing the guesses whose
+        // values have all been tried. Once cancelled, all of them are undone.
+        tMrvGuess *guess;
+        tIntSize value;
+        do {
+            if (depth == 0) {
+                return false;
+            }
 
-            // Solving the following cells assuming this value has failed, so we don't
-            // have the right value.
-            grid_markValueFree(true, *grid, pos.row, pos.column, value);
+            guess = &mrv->guesses[depth - 1];
+            tPosition const pos = grid_cellPosition(*grid, guess->iCell);
+
+            // The possible values are unchanged after each failed attempt, as
+            // the attempted value is marked free again.
+            if (guess->value != 0) {
+                cell_value(grid_cellAtIndex(*grid, guess->iCell)) = 0;
+                mrv_markValueFree(true, mrv, grid, pos.row, pos.column, guess->value);
+            }
+
+            value = cancelled ? grid_size(*grid) + 1 : technique_mrvBacktracking_nextValue(grid, guess);
+            if (value > grid_size(*grid)) {
+                // We failed for all values, the cell must be picked again by
+                // the previous guess's next attempt.
+                mrv_push(mrv, guess->iCell);
+                stats_leaveNode(grid->stats, !cancelled && *count == guess->count);
+                depth--;
+            }
+        } while (value > grid_size(*grid));
+
+        // Assume that the cell contains this value, and move on to the next
+        // cell to see if the value is good afterwards
+        tPosition const pos = grid_cellPosition(*grid, guess->iCell);
+        guess->value = value;
+        mrv_markValueFree(false, mrv, grid, pos.row, pos.column, value);
+        cell_value(grid_cellAtIndex(*grid, guess->iCell)) = value;
+    }
+}
+
+tIntSize technique_mrvBacktracking_nextValue(tGrid const *grid, tMrvGuess const *guess) {
+    tPosition const pos = grid_cellPosition(*grid, guess->iCell);
+
+    // From the first value to the end, then from the start to the first value
+    if (guess->value == 0 || guess->value >= guess->first) {
+        tIntSize const value = grid_cellNextPossibleValue(grid, pos.row, pos.column,
+            guess->value == 0 ? guess->first - 1 : guess->value);
+        if (value <= grid_size(*grid) || guess->first == 1) {
+            return value;
         }
     }
 
-    // We failed for all values
-    return false;
+    tIntSize const value = grid_cellNextPossibleValue(grid, pos.row, pos.column,
+        guess->value == 0 || guess->value >= guess->first ? 0 : guess->value);
+    return value < guess->first ? value : grid_size(*grid) + 1;
+}
+
+bool technique_countingPropagatingBacktracking(tGrid *grid, tTrail *trail,
+    unsigned limit, unsigned *count, uint32_t *solution) {
+    return technique_trailBacktracking(grid, trail, NULL, limit, count, solution);
 }
 
-void technique_backtracking_swap_cells(tGrid const *grid,
-    tPosition *emptyCellPositions,
-    tIntSize emptyCellCount,
-    tIntSize iHere) {
-    assert(iHere < emptyCellCount);
+bool technique_trailBacktracking(tGrid *grid, tTrail *trail, atomic_bool const *cancel,
+    unsigned limit, unsigned *count, uint32_t *solution) {
+    tIntCell const cellCount = grid_size(*grid) * grid_size(*grid);
+    tIntCell depth = 0;
+    bool cancelled = false;
+
+    while (true) {
+        // A node of the search tree: solved, cancelled, or a new guess on the
+        // empty cell with the least candidates. After propagation, there are no
+        // cells with a single candidate left, so stop at the first cell with 2
+        // candidates.
+        tIntCell iCell = cellCount;
+        tIntSize minCount = grid_size(*grid) + 1;
+        for (tIntCell i = 0; i < cellCount && minCount > 2; i++) {
+            if (grid->values[i] == 0 && grid->_candidateCounts[i] < minCount) {
+                iCell = i;
+                minCount = grid->_candidateCounts[i];
+            }
+        }
+
+        stats_enterNode(grid->stats);
+
+        if (iCell == cellCount) {
+            // No empty cells left, the grid is solved
+            if (solution != NULL && *count == 0) {
+                grid_storeSudValues(grid, solution);
+            }
+            stats_leaveNode(grid->stats, false);
+
+            if (++*count >= limit) {
+                for (; depth > 0; depth--) {
+                    stats_leaveNode(grid->stats, false);
+                }
+                return true;
+            }
+        } else if (technique_isCancelled(cancel)) {
+            stats_leaveNode(grid->stats, false);
+            cancelled = true;
+        } else {
+            // The values of the pattern solution are tried first, as in
+            // technique_mrvBacktracking
+            tPosition const pos = grid_cellPosition(*grid, iCell);
+            trail->guesses[depth++] = (tTrailGuess) {
+                .iCell = iCell,
+                .first = grid_patternValue(*grid, pos.row, pos.column),
+                .value = 0,
+                .mark = trail->count,
+                .count = *count,
+            };
+        }
+
+        // Try the next candidate of the last guess, undoing the guesses whose
+        // candidates have all been tried. Once cancelled, all of them are
+        // undone.
+        while (true) {
+            if (depth == 0) {
+                return false;
+            }
+
+            tTrailGuess *guess = &trail->guesses[depth - 1];
+
+            // The candidates of the cell are restored by the undo after each
+            // attempt, so the iteration can resume from the last value tried.
+            if (guess->value != 0) {
+                trail_undo(grid, trail, guess->mark);
+            }
+
+            tIntSize const value = cancelled ? grid_size(*grid) + 1 : technique_trailBacktracking_nextCandidate(grid, guess);
+            if (value > grid_size(*grid)) {
+                // We failed for all candidates
+                stats_leaveNode(grid->stats, !cancelled && *count == guess->count);
+                depth--;
+                continue;
+            }
 
-    tPosition pos = emptyCellPositions[iHere];
-    tIntSize iMin = iHere;
-    grid_cellPossibleValuesCount(*grid, pos.row, pos.column, possibleValCountMin);
+            // Assume that the cell contains this value, and move on to the
+            // next cell if the propagation finds no contradiction
+            tPosition const pos = grid_cellPosition(*grid, guess->iCell);
+            guess->value = value;
+            if (propagation_placeValue(grid, trail, pos.row, pos.column, value)
+                && propagation_propagate(grid, trail)) {
+                break;
+            }
+        }
+    }
+}
 
-    // find the cell after which has the least possible values
-    for (tIntSize i = iHere + 1; i < emptyCellCount; i++) {
-        pos = emptyCellPositions[i];
-        grid_cellPossibleValuesCount(*grid, pos.row, pos.column, possibleValCountI);
+tIntSize technique_trailBacktracking_nextCandidate(tGrid const *grid, tTrailGuess const *guess) {
+    tCell const cell = grid_cellAtIndex(*grid, guess->iCell);
 
-        if (possibleValCountI < possibleValCountMin) {
-            iMin = i;
-            possibleValCountMin = possibleValCountI;
+    // From the first candidate to the end, then from the start to the first
+    // candidate
+    if (guess->value == 0 || guess->value >= guess->first) {
+        tIntSize const candidate = (tIntSize)grid_cell_nextCandidate(*grid, cell,
+            guess->value == 0 ? guess->first - 1u : guess->value);
+        if (candidate <= grid_size(*grid) || guess->first == 1) {
+            return candidate;
         }
     }
 
-    // swap the cells
-    tPosition tmp = emptyCellPositions[iHere];
-    emptyCellPositions[iHere] = emptyCellPositions[iMin];
-    emptyCellPositions[iMin] = tmp;
+    tIntSize const candidate = (tIntSize)grid_cell_nextCandidate(*grid, cell,
+        guess->value == 0 || guess->value >= guess->first ? 0u : guess->value);
+    return candidate < guess->first ? candidate : grid_size(*grid) + 1;
 }
 
 bool technique_nakedSingleton(tGrid *grid, tIntSize row, tIntSize column) {
     bool progress = false;
 
-    tCell *cell = &grid_cellAt(*grid, row, column);
-    if (cell_candidate_count(*cell) == 1) {
-        cell_get_first_candidate(*cell, candidate);
+    tCell const cell = grid_cellAt(*grid, row, column);
+    if (cell_candidate_count(cell) == 1) {
+        cell_get_first_candidate(cell, candidate);
         // remove all corresponding candidates
         // there will be at least one removal, the unique candidate of the cell.
         progress |= grid_removeCandidateFromRow(grid, row, candidate);
@@ -275,12 +586,9 @@ bool technique_hiddenSingleton(tGrid *grid, tIntSize row, tIntSize column) {
     int candidate;
     bool progress = false;
 
-    int const blockRow = grid_blockIndex(*grid, row);
-    int const blockCol = grid_blockIndex(*grid, column);
-
     // Block
     if ((candidate = technique_hiddenSingleton_findUniqueCandidate(
-             grid, blockRow, blockRow + grid->N, blockCol, blockCol + grid->N,
+             grid, grid_unit(*grid, UNIT_BLOCK, grid_blockAt(*grid, row, column)),
              &candidatePos))
         != 0) {
         grid_cell_provideValue(grid, candidatePos.row, candidatePos.column,
@@ -291,7 +599,7 @@ bool technique_hiddenSingleton(tGrid *grid, tIntSize row, tIntSize column) {
     }
     // Row
     if ((candidate = technique_hiddenSingleton_findUniqueCandidate(
-             grid, row, row + 1, 0, grid_size(*grid), &candidatePos))
+             grid, grid_unit(*grid, UNIT_ROW, row), &candidatePos))
         != 0) {
         grid_cell_provideValue(grid, candidatePos.row, candidatePos.column,
             candidate);
@@ -305,7 +613,7 @@ bool technique_hiddenSingleton(tGrid *grid, tIntSize row, tIntSize column) {
 
     // Column
     if ((candidate = technique_hiddenSingleton_findUniqueCandidate(
-             grid, 0, grid_size(*grid), column, column + 1, &candidatePos))
+             grid, grid_unit(*grid, UNIT_COLUMN, column), &candidatePos))
         != 0) {
         grid_cell_provideValue(grid, candidatePos.row, candidatePos.column,
             candidate);
@@ -319,39 +627,27 @@ bool technique_hiddenSingleton(tGrid *grid, tIntSize row, tIntSize column) {
 }
 
 int technique_hiddenSingleton_findUniqueCandidate(
-    tGrid const *grid, tIntSize rStart, tIntSize rEnd, tIntSize cStart,
-    tIntSize cEnd, tPosition *candidatePosition) {
-    tIntSize *candidateCounts = check_alloc(
-        array_calloc(candidateCounts, grid_size(*grid) + 1), "candidate counts array");
-
-    for (tIntSize r = rStart; r < rEnd; r++) {
-        for (tIntSize c = cStart; c < cEnd; c++) {
-            tCell cell = grid_cellAt(*grid, r, c);
-            for (tIntSize candidate = 1; candidate <= grid_size(*grid); candidate++) {
-                candidateCounts[candidate] += cell_hasCandidate(cell, candidate);
-            }
-        }
-    }
+    tGrid const *grid, tIntCell unit, tPosition *candidatePosition) {
+    grid_countGroupCandidates(grid, unit);
 
-    // Search for the unique candidate
-    tIntSize candidate = 1;
-    while (candidate <= grid_size(*grid) && candidateCounts[candidate] != 1) {
-        candidate++;
+    // Search for the first unique candidate
+    tIntSize word = 0;
+    while (word < grid->_candidateWordCount && grid_groupExactlyOnce(*grid, word) == 0) {
+        word++;
     }
 
-    free(candidateCounts);
-
     // If it hasn't been found
-    if (candidate == grid_size(*grid) + 1) {
+    if (word == grid->_candidateWordCount) {
         return 0;
     }
 
-    for (tIntSize r = rStart; r < rEnd; r++) {
-        for (tIntSize c = cStart; c < cEnd; c++) {
-            if (cell_hasCandidate(grid_cellAt(*grid, r, c), candidate)) {
-                *candidatePosition = (tPosition) { .row = r, .column = c };
-                return candidate;
-            }
+    tIntSize const candidate = word * BITWORD_BITS + bitword_first(grid_groupExactlyOnce(*grid, word));
+
+    tIntCell const *cells = grid_unitCells(*grid, unit);
+    for (tIntSize i = 0; i < grid_size(*grid); i++) {
+        if (cell_hasCandidate(grid_cellAtIndex(*grid, cells[i]), candidate)) {
+            *candidatePosition = grid_cellPosition(*grid, cells[i]);
+            return candidate;
         }
     }
 
@@ -362,35 +658,31 @@ int technique_hiddenSingleton_findUniqueCandidate(
 bool technique_nakedPair(tGrid *grid, tIntSize row, tIntSize column) {
     bool progress = false;
 
-    tCell *cellRowColumn = &grid_cellAt(*grid, row, column);
+    tIntCell const iCell = at2d(grid_size(*grid), row, column);
+    tCell const cellRowColumn = grid_cellAtIndex(*grid, iCell);
 
-    if (cell_candidate_count(*cellRowColumn) == 2) {
-        tIntSize const blockRow = grid_blockIndex(*grid, row);
-        tIntSize const blockCol = grid_blockIndex(*grid, column);
+    if (cell_candidate_count(cellRowColumn) == 2) {
+        tIntCell const *blockCells = grid_unitCells(*grid, grid_unit(*grid, UNIT_BLOCK, grid_blockAt(*grid, row, column)));
 
         tPair2 pair = (tPair2) {
-            .candidates = { cell_candidateAt(cellRowColumn, 1),
-                cell_candidateAt(cellRowColumn, 2) },
+            .candidates = { cell_candidateAt(&cellRowColumn, 1),
+                cell_candidateAt(&cellRowColumn, 2) },
             .count = 1,
         };
 
-        for (tIntSize r = blockRow; r < blockRow + grid->N && pair.count < 2; r++) {
-            for (tIntSize c = blockCol; c < blockCol + grid->N && pair.count < 2;
-                c++) {
-                pair.count += (r != row || c != column) && technique_nakedPair_isPairCell(grid_cellAt(*grid, r, c), pair);
-            }
+        for (tIntSize i = 0; i < grid_size(*grid) && pair.count < 2; i++) {
+            pair.count += blockCells[i] != iCell && technique_nakedPair_isPairCell(grid_cellAtIndex(*grid, blockCells[i]), pair);
         }
 
         if (pair.count == 2) {
             // Remove all candidates from the block except on the cells containing
             // only the candidates of the pair So we cannot use
             // grid_removeCandidateFromBlock
-            for (tIntSize r = blockRow; r < blockRow + grid->N; r++) {
-                for (tIntSize c = blockCol; c < blockCol + grid->N; c++) {
-                    bool isNotPairCell = !technique_nakedPair_isPairCell(grid_cellAt(*grid, r, c), pair);
-                    progress |= isNotPairCell && grid_cell_removeCandidate(grid, r, c, pair.candidates[0]);
-                    progress |= isNotPairCell && grid_cell_removeCandidate(grid, r, c, pair.candidates[1]);
-                }
+            for (tIntSize i = 0; i < grid_size(*grid); i++) {
+                tPosition const pos = grid_cellPosition(*grid, blockCells[i]);
+                bool isNotPairCell = !technique_nakedPair_isPairCell(grid_cellAtIndex(*grid, blockCells[i]), pair);
+                progress |= isNotPairCell && grid_cell_removeCandidate(grid, pos.row, pos.column, pair.candidates[0]);
+                progress |= isNotPairCell && grid_cell_removeCandidate(grid, pos.row, pos.column, pair.candidates[1]);
             }
         }
     }
@@ -405,44 +697,50 @@ bool technique_hiddenPair(tGrid *grid, tIntSize row, tIntSize column) {
     tIntSize candidates[PAIR_SIZE];
     bool progress = false;
 
-    tIntSize const blockRow = grid_blockIndex(*grid, row);
-    tIntSize const blockCol = grid_blockIndex(*grid, column);
-
-    tCell *cellRowColumn = &grid_cellAt(*grid, row, column);
+    tCell const cellRowColumn = grid_cellAt(*grid, row, column);
 
     // Block
-    progress |= (cell_candidate_count(*cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, blockRow, blockRow + grid->N, blockCol, blockCol + grid->N, pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
+    progress |= (cell_candidate_count(cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, grid_unit(*grid, UNIT_BLOCK, grid_blockAt(*grid, row, column)), pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
     // Row
-    progress |= (cell_candidate_count(*cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, row, row + 1, 0, grid_size(*grid), pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
+    progress |= (cell_candidate_count(cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, grid_unit(*grid, UNIT_ROW, row), pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
     // Column
-    progress |= (cell_candidate_count(*cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, 0, grid_size(*grid), column, column + 1, pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
+    progress |= (cell_candidate_count(cellRowColumn) >= 2 && technique_hiddenPair_findPair(grid, grid_unit(*grid, UNIT_COLUMN, column), pairCellPositions, candidates)) && technique_hiddenPair_removePairCells(grid, pairCellPositions, candidates);
 
     return progress;
 }
 
-bool technique_hiddenPair_findPair(tGrid const *grid, tIntSize rStart,
-    tIntSize rEnd, tIntSize cStart,
-    tIntSize cEnd,
+bool technique_hiddenPair_findPair(tGrid const *grid, tIntCell unit,
     tPosition pairCellPositions[PAIR_SIZE],
     tIntSize candidates[PAIR_SIZE]) {
     tCell firstPairCell = grid_cellAtPos(*grid, pairCellPositions[0]);
 
     assert(cell_candidate_count(firstPairCell) >= 2);
 
-    for (candidates[0] = 1; candidates[0] <= grid_size(*grid); candidates[0]++) {
-        if (!cell_hasCandidate(firstPairCell, candidates[0])) {
+    grid_countGroupCandidates(grid, unit);
+
+    // A hidden pair is made of two candidates present exactly twice in the
+    // group, in the same two cells.
+    for (candidates[0] = grid_cell_nextCandidate(*grid, firstPairCell, 0);
+        candidates[0] <= grid_size(*grid);
+        candidates[0] = grid_cell_nextCandidate(*grid, firstPairCell, candidates[0])) {
+        if (!technique_hiddenPair_isTwice(*grid, candidates[0])) {
             continue;
         }
 
-        for (candidates[1] = candidates[0] + 1; candidates[1] <= grid_size(*grid);
-            candidates[1]++) {
-            if (!cell_hasCandidate(firstPairCell, candidates[1])) {
-                continue;
-            }
+        technique_hiddenPair_findOtherCell(grid, candidates[0], unit, pairCellPositions);
+        tCell otherPairCell = grid_cellAtPos(*grid, pairCellPositions[1]);
+
+        // For the hidden pair to be useful, the other cell of the pair must
+        // contain other candidates. Otherwise, we won't be able to remove any
+        // candidates.
+        if (cell_candidate_count(otherPairCell) <= PAIR_SIZE) {
+            continue;
+        }
 
-            // Start the search for a pair with new candidates.
-            if (technique_hiddenPair_findPairCells(grid, candidates, rStart, rEnd,
-                    cStart, cEnd, pairCellPositions)) {
+        for (candidates[1] = grid_cell_nextCandidate(*grid, firstPairCell, candidates[0]);
+            candidates[1] <= grid_size(*grid);
+            candidates[1] = grid_cell_nextCandidate(*grid, firstPairCell, candidates[1])) {
+            if (technique_hiddenPair_isTwice(*grid, candidates[1]) && cell_hasCandidate(otherPairCell, candidates[1])) {
                 return true;
             }
         }
@@ -451,41 +749,20 @@ bool technique_hiddenPair_findPair(tGrid const *grid, tIntSize rStart,
     return false;
 }
 
-bool technique_hiddenPair_findPairCells(
-    tGrid const *grid, tIntSize const candidates[PAIR_SIZE], tIntSize rStart,
-    tIntSize rEnd, tIntSize cStart, tIntSize cEnd,
-    tPosition pairCellPositions[PAIR_SIZE]) {
-    tIntSize nbPairCells = 1; // Count of cells found containing the pair (candidate1, candidate2).
-    tIntSize nbPairCellsContainingOtherCandidates = 0;
-
-    // Searching for hidden pairs
-    // Add each cell that contain both candidates
-    for (tIntSize r = rStart; r < rEnd && nbPairCells <= PAIR_SIZE + 1; r++) {
-        for (tIntSize c = cStart; c < cEnd && nbPairCells <= PAIR_SIZE + 1; c++) {
-            if (r == pairCellPositions[0].row && c == pairCellPositions[0].column) {
-                continue;
-            }
+void technique_hiddenPair_findOtherCell(tGrid const *grid, tIntSize candidate,
+    tIntCell unit, tPosition pairCellPositions[PAIR_SIZE]) {
+    tIntCell const *cells = grid_unitCells(*grid, unit);
+    tIntCell const iFirstCell = at2d(grid_size(*grid), pairCellPositions[0].row, pairCellPositions[0].column);
 
-            tCell cell = grid_cellAt(*grid, r, c);
-
-            if (cell_hasCandidate(cell, candidates[0]) && cell_hasCandidate(cell, candidates[1])) {
-                nbPairCellsContainingOtherCandidates += cell_candidate_count(cell) > PAIR_SIZE;
-                if (nbPairCells < PAIR_SIZE) {
-                    pairCellPositions[nbPairCells] = (tPosition) { .row = r, .column = c };
-                }
-                nbPairCells++;
-            }
-            // search for single candidates that would invalidate the pair
-            else if (cell_hasCandidate(cell, candidates[0]) || cell_hasCandidate(cell, candidates[1])) {
-                return false;
-            }
+    for (tIntSize i = 0; i < grid_size(*grid); i++) {
+        if (cells[i] != iFirstCell && cell_hasCandidate(grid_cellAtIndex(*grid, cells[i]), candidate)) {
+            pairCellPositions[1] = grid_cellPosition(*grid, cells[i]);
+            return;
         }
     }
 
-    // For the hidden pair to be useful, at least one cell of the pair must
-    // contain other candidates. Otherwise, we won't be able to remove any
-    // candidates.
-    return nbPairCells == PAIR_SIZE && nbPairCellsContainingOtherCandidates > 0;
+    dbg_fail("Unreachable code bug : hidden pair candidate not found twice even "
+             "though it was counted twice");
 }
 
 bool technique_hiddenPair_removePairCells(
@@ -495,8 +772,11 @@ bool technique_hiddenPair_removePairCells(
     // For each cell containing the pair:
     for (tIntSize iPos = 0; iPos < PAIR_SIZE; ++iPos) {
         tPosition pos = pairCellPositions[iPos];
+        tCell const cell = grid_cellAtPos(*grid, pos);
         // remove all its candidates
-        for (tIntSize candidate = 1; candidate <= grid_size(*grid); ++candidate) {
+        for (unsigned candidate = grid_cell_nextCandidate(*grid, cell, 0);
+            candidate <= grid_size(*grid);
+            candidate = grid_cell_nextCandidate(*grid, cell, candidate)) {
             // except those forming the pair
             progress |= candidate != candidates[0] && candidate != candidates[1] && grid_cell_removeCandidate(grid, pos.row, pos.column, candidate);
         }
@@ -504,81 +784,100 @@ bool technique_hiddenPair_removePairCells(
     return progress;
 }
 
-bool technique_x_wing(tGrid *grid) {
+bool technique_fish(tGrid *grid, size_t since) {
     bool progress = false;
+    tUnitKind const baseKinds[] = { UNIT_COLUMN, UNIT_ROW };
+
+    grid_mapCandidatePositions(grid);
 
-    // VERTICAL X-WING
-    // identify 2 columns that each have, on the same rows, exactly two cells
-    // where a candidate appears.
-    /* We get a rectangle with these four cells as vertices:
-    _   _
-    A---B
-    |   |
-    C---D
-    ‾   ‾*/
-    for (tIntSize colAC = 0; colAC < grid_size(*grid); colAC++) {
-        for (tIntSize colBD = colAC + 1; colBD < grid_size(*grid); colBD++) {
+    // A fish and the fish made of the other lines are the same, so sizes above
+    // SIZE / 2 are not searched.
+    for (unsigned iKind = 0; iKind < sizeof baseKinds / sizeof *baseKinds; iKind++) {
+        for (tIntSize size = 2; size <= FISH_MAX_SIZE && 2 * size <= grid_size(*grid); size++) {
             for (tIntSize candidate = 1; candidate <= grid_size(*grid); candidate++) {
-                tIntSize rows[2];
-                tIntSize candidateInBothCount = 0;
-                tIntSize candidateCounts[2] = { 0 };
-                for (tIntSize row = 0; row < grid_size(*grid); row++) {
-                    bool colACHasCandidate = cell_hasCandidate(grid_cellAt(*grid, row, colAC), candidate);
-                    bool colBDHasCandidate = cell_hasCandidate(grid_cellAt(*grid, row, colBD), candidate);
-                    candidateCounts[0] += colACHasCandidate;
-                    candidateCounts[1] += colBDHasCandidate;
-                    if (colACHasCandidate && colBDHasCandidate) {
-                        if (candidateInBothCount < 2) {
-                            rows[candidateInBothCount] = row;
-                        }
-                        candidateInBothCount++;
-                    }
-                }
-                if (candidateInBothCount == 2 && candidateCounts[0] == 2 && candidateCounts[1] == 2) {
-                    // eliminate the candidate from the rows (AB) and (CD).
-                    for (tIntSize c = 0; c < grid_size(*grid); c++) {
-                        // do not remove the candidate from the cells that form the X.
-                        progress |= c != colAC && c != colBD && grid_cell_removeCandidate(grid, rows[0], c, candidate);
-                        progress |= c != colAC && c != colBD && grid_cell_removeCandidate(grid, rows[1], c, candidate);
-                    }
-                }
+                tFish fish = {
+                    .baseKind = baseKinds[iKind],
+                    .candidate = candidate,
+                    .size = size,
+                };
+                memset(grid->_fishCovers, 0, sizeof *grid->_fishCovers * grid_lineWordCount(*grid));
+                progress |= technique_fish_search(grid, &fish, since, 0, 0, false);
             }
         }
     }
 
-    // HORIZONTAL X-WING
-    // identify 2 rows that each have, on the same columns, exactly two cells
-    // where a candidate appears.
-    /* We get a rectangle with these four cells as vertices:
-    (A---B)
-     |   |
-    (C---D)*/
-    for (tIntSize rowAB = 0; rowAB < grid_size(*grid); rowAB++) {
-        for (tIntSize rowCD = rowAB + 1; rowCD < grid_size(*grid); rowCD++) {
-            for (tIntSize candidate = 1; candidate <= grid_size(*grid); candidate++) {
-                tIntSize columns[2];
-                tIntSize candidateInBothCount = 0;
-                tIntSize candidateCounts[2] = { 0 };
-                for (tIntSize col = 0; col < grid_size(*grid); col++) {
-                    bool rowABHasCandidate = cell_hasCandidate(grid_cellAt(*grid, rowAB, col), candidate);
-                    bool rowCDHasCandidate = cell_hasCandidate(grid_cellAt(*grid, rowCD, col), candidate);
-                    candidateCounts[0] += rowABHasCandidate;
-                    candidateCounts[1] += rowCDHasCandidate;
-                    if (rowABHasCandidate && rowCDHasCandidate) {
-                        if (candidateInBothCount < 2) {
-                            columns[candidateInBothCount] = col;
-                        }
-                        candidateInBothCount++;
-                    }
-                }
-                if (candidateInBothCount == 2 && candidateCounts[0] == 2 && candidateCounts[1] == 2) {
-                    // elmininate the candidate from the columns (AC) and (BD).
-                    for (tIntSize r = 0; r < grid_size(*grid); r++) {
-                        // do not remove the candidate from the cells that form the X.
-                        progress |= r != rowAB && r != rowCD && grid_cell_removeCandidate(grid, r, columns[0], candidate);
-                        progress |= r != rowAB && r != rowCD && grid_cell_removeCandidate(grid, r, columns[1], candidate);
-                    }
-                }
+    return progress;
+}
+
+bool technique_fish_search(tGrid *grid, tFish *fish, size_t since,
+    tIntSize firstLine, tIntSize depth, bool isChanged) {
+    tIntSize const lineWordCount = grid_lineWordCount(*grid);
+    tBitWord const *covers = &grid->_fishCovers[at2d(lineWordCount, depth, 0)];
+
+    if (depth == fish->size) {
+        // The base lines cannot have their positions in less cover lines
+        // without a contradiction
+        return isChanged
+            && bitset_count(covers, lineWordCount) == fish->size
+            && technique_fish_eliminate(grid, fish);
+    }
+
+    tBitWord *nextCovers = &grid->_fishCovers[at2d(lineWordCount, depth + 1, 0)];
+    bool progress = false;
+
+    for (tIntSize line = firstLine; line + fish->size - depth <= grid_size(*grid); line++) {
+        tBitWord const *positions = grid_candidatePositions(*grid, fish->baseKind, fish->candidate, line);
+        grid->_workCount++;
+        unsigned const positionCount = bitset_count(positions, lineWordCount);
+
+        // Lines with a single position are hidden singletons
+        if (positionCount < 2 || positionCount > fish->size) {
+            continue;
+        }
+
+        unsigned coverCount = 0;
+        for (tIntSize word = 0; word < lineWordCount; word++) {
+            nextCovers[word] = covers[word] | positions[word];
+            coverCount += bitword_count(nextCovers[word]);
+        }
+        if (coverCount > fish->size) {
+            continue;
+        }
+
+        fish->baseLines[depth] = line;
+        progress |= technique_fish_search(grid, fish, since, line + 1, depth + 1,
+            isChanged || grid_unitChangedSince(*grid, grid_unit(*grid, fish->baseKind, line), since));
+    }
+
+    return progress;
+}
+
+bool technique_fish_eliminate(tGrid *grid, tFish const *fish) {
+    tIntSize const lineWordCount = grid_lineWordCount(*grid);
+    tBitWord const *covers = &grid->_fishCovers[at2d(lineWordCount, fish->size, 0)];
+    tUnitKind const coverKind = fish->baseKind == UNIT_COLUMN ? UNIT_ROW : UNIT_COLUMN;
+    bool progress = false;
+
+    for (size_t cover = bitset_first(covers); cover < grid_size(*grid);
+        cover = bitset_next(covers, lineWordCount, cover)) {
+        // The ith cell of a cover line is on the ith base line
+        tIntCell const *cells = grid_unitCells(*grid, grid_unit(*grid, coverKind, cover));
+        tIntSize iBase = 0;
+
+        for (tIntSize i = 0; i < grid_size(*grid); i++) {
+            // Do not remove the candidate from the base lines
+            if (iBase < fish->size && fish->baseLines[iBase] == i) {
+                iBase++;
+                continue;
+            }
+
+            tPosition const pos = grid_cellPosition(*grid, cells[i]);
+            if (grid_cell_removeCandidate(grid, pos.row, pos.column, fish->candidate)) {
+                // Keep the positions of the candidate up to date for the next
+                // fish
+                bitset_remove(grid_candidatePositions(*grid, UNIT_ROW, fish->candidate, pos.row), pos.column);
+                bitset_remove(grid_candidatePositions(*grid, UNIT_COLUMN, fish->candidate, pos.column), pos.row);
+                progress = true;
             }
         }
     }
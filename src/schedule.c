@@ -0,0 +1,143 @@
+/** @file
+ * @brief Adaptive scheduling of the logic techniques
+ * @author 5cover, Matteo-K
+ *
+ * Orders the logic techniques of a solve by their cost. The singletons are
+ * cheap, and always run until they make no more progress. Only then does the
+ * scheduler escalate to a costly pass, the pairs or the fish, and go back to
+ * the singletons as soon as it makes progress. A grid the singletons solve never
+ * pays for the costly passes.
+ *
+ * The yield of each costly pass, the changes it makes to the grid per cell or
+ * line it examines, is averaged over its runs on the grid. The passes are tried
+ * by decreasing average yield, and a pass whose yield falls well below its
+ * average is not tried again: the solve switches to backtracking sooner
+ * instead. The yields only depend on the grid, so neither the grids solved
+ * before it nor the speed of the machine change the result of a solve.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "grid.c"
+#include "resolution.c"
+#include "stats.c"
+#include "types.c"
+
+/// @brief Integer: number of runs over which the yield of a pass is averaged
+/// before it becomes a moving average.
+#define SCHEDULE_YIELD_WINDOW 16
+
+/// @brief Float: fraction of its average yield under which a pass no longer
+/// pays off on a grid.
+#define SCHEDULE_MIN_YIELD_RATIO 0.25
+
+/// @brief A costly pass of the logic techniques.
+typedef enum {
+    /// @brief Naked and hidden pairs on the units changed since the last pass.
+    PASS_PAIRS,
+    /// @brief Fish on the lines changed since the last pass.
+    PASS_FISH,
+    PASS_COUNT,
+} tPass;
+
+/// @brief Yield statistics of the costly passes, kept over the solve of a grid.
+typedef struct {
+    /// @brief Average yield of each pass, in grid changes per unit of @c
+    /// grid->_workCount.
+    /// @remark Dimensions: [pass]
+    double yields[PASS_COUNT];
+    /// @brief Number of runs of each pass, saturating at @ref
+    /// SCHEDULE_YIELD_WINDOW.
+    /// @remark Dimensions: [pass]
+    unsigned runs[PASS_COUNT];
+} tSchedule;
+
+/// @brief Makes progress on a grid with the logic techniques, cheapest first.
+/// @param grid in/out: the grid
+/// @remark Unlike @ref solver_applyTier, this may stop before the techniques
+/// make no more progress.
+void schedule_apply(tGrid *grid);
+
+/// @brief Runs a costly pass.
+/// @param grid in/out: the grid
+/// @param pass in: the pass
+/// @param since in: the value of @c grid->_changeCount at the start of the last
+/// run of the pass on the grid
+/// @return Whether progress has been made.
+/// @remark Used in @ref schedule_apply.
+bool schedule_runPass(tGrid *grid, tPass pass, size_t since);
+
+/// @brief Records the yield of a run of a pass.
+/// @param schedule in/out: the yield statistics
+/// @param pass in: the pass
+/// @param yield in: the yield of the run
+/// @remark Used in @ref schedule_apply.
+void schedule_recordYield(tSchedule *schedule, tPass pass, double yield);
+
+/////////////////////////////////////////////////////////////////////////
+
+void schedule_apply(tGrid *grid) {
+    tSchedule schedule = { 0 };
+    size_t passSince[PASS_COUNT] = { 0 }; // change count at the start of the last run of each pass
+    bool paysOff[PASS_COUNT];
+    for (tPass pass = 0; pass < PASS_COUNT; pass++) {
+        paysOff[pass] = true;
+    }
+
+    bool progress;
+    do {
+        // The singletons on the queued units, until they make no progress
+        perform_simpleTechniques(grid, false);
+        if (grid_isFilled(grid)) {
+            return;
+        }
+
+        // Then the first costly pass that makes progress, by decreasing yield
+        tPass order[PASS_COUNT] = { PASS_PAIRS, PASS_FISH };
+        if (schedule.yields[PASS_FISH] > schedule.yields[PASS_PAIRS]) {
+            order[0] = PASS_FISH;
+            order[1] = PASS_PAIRS;
+        }
+
+        progress = false;
+        for (unsigned i = 0; i < PASS_COUNT && !progress; i++) {
+            tPass const pass = order[i];
+            if (!paysOff[pass]) {
+                continue;
+            }
+
+            size_t const changeCount = grid->_changeCount;
+            size_t const workCount = grid->_workCount;
+            progress = schedule_runPass(grid, pass, passSince[pass]);
+            size_t const work = grid->_workCount - workCount;
+            passSince[pass] = changeCount;
+
+            double const yield = (double)(grid->_changeCount - changeCount) / (work > 0 ? work : 1);
+            paysOff[pass] = schedule.runs[pass] == 0 || yield >= SCHEDULE_MIN_YIELD_RATIO * schedule.yields[pass];
+            schedule_recordYield(&schedule, pass, yield);
+        }
+    } while (progress);
+}
+
+bool schedule_runPass(tGrid *grid, tPass pass, size_t since) {
+    switch (pass) {
+    case PASS_PAIRS:
+        // The singletons run along on the changed units
+        grid_queueChangedUnits(grid, since);
+        return perform_simpleTechniques(grid, true);
+    case PASS_FISH:
+        return stats_measure(grid->stats, TECHNIQUE_FISH, technique_fish(grid, since));
+    default:
+        abort();
+    }
+}
+
+void schedule_recordYield(tSchedule *schedule, tPass pass, double yield) {
+    if (schedule->runs[pass] < SCHEDULE_YIELD_WINDOW) {
+        schedule->runs[pass]++;
+    }
+    schedule->yields[pass] += (yield - schedule->yields[pass]) / schedule->runs[pass];
+}
@@ -0,0 +1,468 @@
+/** @file
+ * @brief Solver server
+ * @author 5cover, Matteo-K
+ *
+ * Serves solve requests on a Unix or TCP socket, so that clients don't pay for
+ * a process and a grid allocation per grid.
+ *
+ * Each connection is handled by its own thread, with a pool of solvers, one per
+ * grid size requested so far, reused from one request to the next.
+ *
+ * All integers are 32-bit little-endian, like in the Sud format. A request is a
+ * grid size factor N followed by the N⁴ Sud values of a grid. A reply is a
+ * status followed, unless the status is @ref SERVER_STATUS_UNSUPPORTED, by N⁴
+ * Sud values.
+ *
+ * Requests are pipelined: a client may send many requests without waiting for
+ * the replies, which come in the same order. The replies are buffered, and sent
+ * whenever the server would wait for more requests.
+ *
+ * The solutions may be cached, in a cache per grid size shared by the
+ * connections. With a snapshot file, the caches are loaded from it when created
+ * and saved to it when the server is terminated by SIGINT or SIGTERM.
+ */
+
+#pragma once
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cache.c"
+#include "grid.c"
+#include "memdbg.c"
+#include "solver.c"
+#include "types.c"
+
+/// @brief Integer: largest grid size factor served.
+/// @remark Bounds the memory a client can make a connection allocate.
+#define SERVER_MAX_N 8
+
+/// @brief Integer: size of the input and output buffers of a connection, in
+/// bytes.
+#define SERVER_BUFFER_SIZE 65536
+
+/// @brief Integer: reply status: the grid has been solved. The values are the
+/// solution.
+#define SERVER_STATUS_SOLVED 0
+/// @brief Integer: reply status: the grid has no solution. The values are the
+/// request's.
+#define SERVER_STATUS_UNSOLVABLE 1
+/// @brief Integer: reply status: a value of the grid is greater than N². The
+/// values are the request's.
+#define SERVER_STATUS_INVALID 2
+/// @brief Integer: reply status: N is 0 or greater than @ref SERVER_MAX_N. The
+/// reply has no values, and the server closes the connection.
+#define SERVER_STATUS_UNSUPPORTED 3
+
+/// @brief Options of a server.
+typedef struct {
+    /// @brief Engine used to solve the grids.
+    tEngine engine;
+    /// @brief Whether to propagate singletons while backtracking.
+    bool propagate;
+    /// @brief Number of entries of the cache of each grid size, 0 for no cache.
+    size_t cacheCapacity;
+    /// @brief Path of the cache snapshot file, or NULL.
+    char const *cacheFile;
+} tServerOptions;
+
+/// @brief A client connection.
+typedef struct {
+    /// @brief The connected socket.
+    int fd;
+
+    /// @brief Options of the server.
+    tServerOptions options;
+
+    /// @brief Solver of each grid size factor, created on first use.
+    /// @remark Dimensions: [N]
+    tSolver solvers[SERVER_MAX_N + 1];
+
+    /// @brief Cache key of each grid size factor, created on first use.
+    /// @remark Dimensions: [N]
+    tCacheKey cacheKeys[SERVER_MAX_N + 1];
+
+    /// @brief Sud values of the current request, sized for @ref
+    /// SERVER_MAX_N.
+    uint32_t *values;
+
+    /// @brief Received bytes. Those in [inFirst ; inEnd[ are yet to be
+    /// consumed.
+    uint8_t in[SERVER_BUFFER_SIZE];
+    size_t inFirst, inEnd;
+
+    /// @brief Bytes of the replies yet to be sent.
+    uint8_t out[SERVER_BUFFER_SIZE];
+    size_t outCount;
+} tConnection;
+
+/// @brief Cache of each grid size factor, created on first use.
+/// @remark Dimensions: [N]
+static tCache gs_serverCaches[SERVER_MAX_N + 1];
+/// @brief Protects the creation of @ref gs_serverCaches.
+static pthread_mutex_t gs_serverCachesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief Listens on a socket and serves the connections until the process is
+/// terminated.
+/// @param address in: Unix socket path, or TCP [HOST]:PORT. An address with a
+/// colon is a TCP address.
+/// @param options in: options of the server
+/// @return The exit code of the program, if the socket could not be set up.
+int server_run(char const *address, tServerOptions options);
+
+/// @brief Creates a listening socket.
+/// @param address in: the address, see @ref server_run
+/// @return The socket, or -1 on error. The error has been reported.
+/// @remark Used in @ref server_run.
+int server_listen(char const *address);
+
+/// @brief Gets the cache of a grid size, creating it on first use.
+/// @param options in: options of the server
+/// @param N in: the grid size factor
+/// @return The cache, or NULL if the server has no cache.
+/// @remark Used in @ref server_connectionMain.
+tCache *server_cache(tServerOptions const *options, tIntN N);
+
+/// @brief Main function of the thread saving the cache snapshot on
+/// termination.
+/// @param options in: options of the server (tServerOptions const *)
+/// @return Doesn't return: exits the process.
+/// @remark Used in @ref server_run.
+void *server_signalMain(void *options);
+
+/// @brief Main function of a connection thread.
+/// @param connection in/out: the connection (tConnection *). Freed on exit.
+/// @return NULL.
+/// @remark Used in @ref server_run.
+void *server_connectionMain(void *connection);
+
+/// @brief Reads bytes from a connection.
+/// @param conn in/out: the connection
+/// @param dst out: the bytes read
+/// @param size in: the number of bytes to read
+/// @return Whether the bytes could be read. If not, the client is gone.
+/// @remark Before waiting for more bytes, the buffered replies are sent.
+bool connection_read(tConnection *conn, void *dst, size_t size);
+
+/// @brief Buffers bytes to send on a connection.
+/// @param conn in/out: the connection
+/// @param src in: the bytes to send
+/// @param size in: the number of bytes to send
+/// @return Whether the bytes could be buffered or sent. If not, the client is
+/// gone.
+bool connection_write(tConnection *conn, void const *src, size_t size);
+
+/// @brief Sends the buffered replies of a connection.
+/// @param conn in/out: the connection
+/// @return Whether the replies could be sent. If not, the client is gone.
+bool connection_flush(tConnection *conn);
+
+/////////////////////////////////////////////////////////////////////////
+
+int server_run(char const *address, tServerOptions options) {
+    int const listenFd = server_listen(address);
+    if (listenFd < 0) {
+        return EXIT_INVALID_ARG;
+    }
+
+    if (options.cacheCapacity > 0 && options.cacheFile != NULL) {
+        // Handle the termination signals in a thread of their own, inherited
+        // by the connection threads
+        static tServerOptions signalOptions;
+        signalOptions = options;
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, server_signalMain, &signalOptions) == 0) {
+            pthread_detach(thread);
+        } else {
+            perror(PROGRAM_NAME ": pthread_create");
+        }
+    }
+
+    while (true) {
+        int const fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                perror(PROGRAM_NAME ": accept");
+            }
+            continue;
+        }
+
+        // Replies are flushed as soon as the server would wait: don't delay
+        // them further. Fails harmlessly on Unix sockets.
+        int const noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof noDelay);
+
+        tConnection *conn = check_alloc(malloc(sizeof *conn), "server connection");
+        conn->fd = fd;
+        conn->options = options;
+        memset(conn->solvers, 0, sizeof conn->solvers);
+        memset(conn->cacheKeys, 0, sizeof conn->cacheKeys);
+        conn->values = check_alloc(array_malloc(conn->values, (size_t)SERVER_MAX_N * SERVER_MAX_N * SERVER_MAX_N * SERVER_MAX_N),
+            "server connection values array");
+        conn->inFirst = conn->inEnd = conn->outCount = 0;
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, server_connectionMain, conn) == 0) {
+            pthread_detach(thread);
+        } else {
+            perror(PROGRAM_NAME ": pthread_create");
+            close(fd);
+            free(conn->values);
+            free(conn);
+        }
+    }
+}
+
+int server_listen(char const *address) {
+    char const *colon = strrchr(address, ':');
+    int fd;
+
+    if (colon == NULL) {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        if (strlen(address) >= sizeof addr.sun_path) {
+            fprintf(stderr, PROGRAM_NAME ": %s: socket path too long\n", address);
+            return -1;
+        }
+        strcpy(addr.sun_path, address);
+
+        // Replace the socket of a previous server
+        struct stat st;
+        if (stat(address, &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(address);
+        }
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+            fprintf(stderr, PROGRAM_NAME ": %s: %s\n", address, strerror(errno));
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    } else {
+        char host[256];
+        size_t const hostLength = colon - address;
+        if (hostLength >= sizeof host) {
+            fprintf(stderr, PROGRAM_NAME ": %s: host name too long\n", address);
+            return -1;
+        }
+        memcpy(host, address, hostLength);
+        host[hostLength] = '\0';
+
+        struct addrinfo hints = {
+            .ai_family = AF_UNSPEC,
+            .ai_socktype = SOCK_STREAM,
+            .ai_flags = AI_PASSIVE,
+        };
+        struct addrinfo *info;
+        int const gaiResult = getaddrinfo(hostLength == 0 ? NULL : host, colon + 1, &hints, &info);
+        if (gaiResult != 0) {
+            fprintf(stderr, PROGRAM_NAME ": %s: %s\n", address, gai_strerror(gaiResult));
+            return -1;
+        }
+
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        int const reuseAddress = 1;
+        if (fd < 0
+            || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof reuseAddress) != 0
+            || bind(fd, info->ai_addr, info->ai_addrlen) != 0) {
+            fprintf(stderr, PROGRAM_NAME ": %s: %s\n", address, strerror(errno));
+            if (fd >= 0) close(fd);
+            freeaddrinfo(info);
+            return -1;
+        }
+        freeaddrinfo(info);
+    }
+
+    if (listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, PROGRAM_NAME ": %s: %s\n", address, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+tCache *server_cache(tServerOptions const *options, tIntN N) {
+    if (options->cacheCapacity == 0) {
+        return NULL;
+    }
+
+    tCache *cache = &gs_serverCaches[N];
+    pthread_mutex_lock(&gs_serverCachesLock);
+    if (cache->entries == NULL) {
+        *cache = cache_create(N, options->cacheCapacity);
+        if (options->cacheFile != NULL) {
+            cache_loadSnapshot(cache, options->cacheFile);
+        }
+    }
+    pthread_mutex_unlock(&gs_serverCachesLock);
+
+    return cache;
+}
+
+void *server_signalMain(void *options) {
+    tServerOptions const *opts = options;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    int signalNumber;
+    while (sigwait(&signals, &signalNumber) != 0) {
+    }
+
+    // Keep new caches from being created while saving
+    pthread_mutex_lock(&gs_serverCachesLock);
+    bool const saved = cache_saveSnapshot(gs_serverCaches, SERVER_MAX_N + 1, opts->cacheFile);
+    exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+void *server_connectionMain(void *connection) {
+    tConnection *conn = connection;
+    uint32_t N;
+
+    // Serve requests until the client is gone or sends an unsupported size
+    while (connection_read(conn, &N, sizeof N)) {
+        if (N == 0 || N > SERVER_MAX_N) {
+            uint32_t const status = SERVER_STATUS_UNSUPPORTED;
+            connection_write(conn, &status, sizeof status);
+            break;
+        }
+
+        size_t const valuesSize = sizeof *conn->values * (N * N) * (N * N);
+        if (!connection_read(conn, conn->values, valuesSize)) {
+            break;
+        }
+
+        tSolver *solver = &conn->solvers[N];
+        if (solver->grid.values == NULL) {
+            *solver = solver_create(N, conn->options.engine, conn->options.propagate);
+        }
+
+        tCache *cache = server_cache(&conn->options, N);
+        tCacheKey *cacheKey = &conn->cacheKeys[N];
+        if (cache != NULL && cacheKey->rows == NULL) {
+            *cacheKey = cache_createKey(N);
+        }
+
+        uint32_t status;
+        if (grid_loadSudValues(&solver->grid, conn->values) != 0) {
+            status = SERVER_STATUS_INVALID;
+        } else if (grid_hasConflicts(&solver->grid)) {
+            status = SERVER_STATUS_UNSOLVABLE;
+        } else if (cache != NULL && cache_lookup(cache, &solver->grid, cacheKey)) {
+            status = SERVER_STATUS_SOLVED;
+            grid_storeSudValues(&solver->grid, conn->values);
+        } else {
+            // The engines expect grids with a solution: check the result
+            solver_solve(solver);
+            if (cache != NULL) {
+                cache_store(cache, &solver->grid, cacheKey);
+            }
+            status = grid_isSolved(&solver->grid) ? SERVER_STATUS_SOLVED : SERVER_STATUS_UNSOLVABLE;
+            if (status == SERVER_STATUS_SOLVED) {
+                grid_storeSudValues(&solver->grid, conn->values);
+            }
+        }
+
+        if (!connection_write(conn, &status, sizeof status)
+            || !connection_write(conn, conn->values, valuesSize)) {
+            break;
+        }
+    }
+
+    connection_flush(conn);
+    close(conn->fd);
+
+    for (tIntN n = 1; n <= SERVER_MAX_N; n++) {
+        solver_free(&conn->solvers[n]);
+        cache_freeKey(&conn->cacheKeys[n]);
+    }
+    free(conn->values);
+    free(conn);
+
+    return NULL;
+}
+
+bool connection_read(tConnection *conn, void *dst, size_t size) {
+    uint8_t *bytes = dst;
+
+    while (size > 0) {
+        if (conn->inFirst == conn->inEnd) {
+            // Out of requests: send the replies before waiting for more
+            if (!connection_flush(conn)) {
+                return false;
+            }
+
+            ssize_t received;
+            do {
+                received = recv(conn->fd, conn->in, sizeof conn->in, 0);
+            } while (received < 0 && errno == EINTR);
+            if (received <= 0) {
+                return false;
+            }
+            conn->inFirst = 0;
+            conn->inEnd = received;
+        }
+
+        size_t const count = min(size, conn->inEnd - conn->inFirst);
+        memcpy(bytes, &conn->in[conn->inFirst], count);
+        conn->inFirst += count;
+        bytes += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+bool connection_write(tConnection *conn, void const *src, size_t size) {
+    uint8_t const *bytes = src;
+
+    while (size > 0) {
+        if (conn->outCount == sizeof conn->out && !connection_flush(conn)) {
+            return false;
+        }
+
+        size_t const count = min(size, sizeof conn->out - conn->outCount);
+        memcpy(&conn->out[conn->outCount], bytes, count);
+        conn->outCount += count;
+        bytes += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+bool connection_flush(tConnection *conn) {
+    size_t sent = 0;
+
+    while (sent < conn->outCount) {
+        // Don't get killed by SIGPIPE if the client is gone
+        ssize_t const result = send(conn->fd, &conn->out[sent], conn->outCount - sent, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += result;
+    }
+
+    conn->outCount = 0;
+    return true;
+}
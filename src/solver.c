@@ -0,0 +1,339 @@
+/** @file
+ * @brief Grid solver
+ * @author 5cover, Matteo-K
+ *
+ * Bundles a grid with the scratch state of the solving engines, so that many
+ * grids can be solved one after another without reallocating.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dlx.c"
+#include "fixed.c"
+#include "grid.c"
+#include "memdbg.c"
+#include "mrv.c"
+#include "propagation.c"
+#include "resolution.c"
+#include "schedule.c"
+#include "types.c"
+
+/// @brief A solving engine
+typedef enum {
+    /// @brief Logic techniques, then backtracking.
+    ENGINE_TECHNIQUES,
+    /// @brief Dancing Links exact cover.
+    ENGINE_DLX,
+    /// @brief Backtracking specialized at compile time for the common grid
+    /// sizes. Other sizes use @ref ENGINE_TECHNIQUES.
+    ENGINE_FIXED,
+    /// @brief @ref ENGINE_FIXED for the sizes it specializes, unless
+    /// propagating, @ref ENGINE_TECHNIQUES otherwise. Resolved by @ref
+    /// solver_create.
+    ENGINE_AUTO,
+} tEngine;
+
+/// @brief A tier of the logic techniques. Each tier includes the techniques of
+/// the lower ones.
+typedef enum {
+    /// @brief Naked and hidden singletons.
+    TIER_SINGLETONS,
+    /// @brief Naked and hidden pairs.
+    TIER_PAIRS,
+    /// @brief Fish of sizes 2 to 4.
+    TIER_FISH,
+    /// @brief No logic technique: backtracking is needed.
+    TIER_BACKTRACKING,
+    TIER_COUNT,
+} tTier;
+
+/// @brief Gets the name of a tier.
+#define solver_tierName(tier)                      \
+    ((char const *const[TIER_COUNT]) {             \
+        [TIER_SINGLETONS] = "singletons",          \
+        [TIER_PAIRS] = "pairs",                    \
+        [TIER_FISH] = "fish",                      \
+        [TIER_BACKTRACKING] = "backtracking",      \
+    }[tier])
+
+/// @brief A grid and the state needed to solve it.
+typedef struct {
+    /// @brief The grid to solve.
+    tGrid grid;
+
+    /// @brief Engine used to solve the grid.
+    tEngine engine;
+
+    /// @brief Whether to propagate singletons while backtracking.
+    /// @remark Only used by @ref ENGINE_TECHNIQUES.
+    bool propagate;
+
+    /// @brief Index of the empty cells for backtracking without propagation and
+    /// random solves. Allocated on first use in the arena of the grid.
+    tMrv mrv;
+
+    /// @brief Trail for propagating backtracking. Allocated on first use in the
+    /// arena of the grid.
+    tTrail trail;
+
+    /// @brief Exact cover matrix for @ref ENGINE_DLX. Only allocated during a
+    /// solve, as its size depends on the grid.
+    tDlx dlx;
+
+    /// @brief Sud values of the first solution found when counting solutions.
+    /// Allocated on first use.
+    /// @remark Dimensions: [cellIndex]
+    uint32_t *solution;
+} tSolver;
+
+/// @brief Integer: solution count limit of a uniqueness check. A grid has 0, 1
+/// or many solutions.
+#define SOLVER_UNIQUENESS_LIMIT 2
+
+/// @brief Gets the name of the result of a uniqueness check.
+/// @param count in: a solution count, at most @ref SOLVER_UNIQUENESS_LIMIT
+/// @return "0", "1" or "many".
+#define solver_uniquenessName(count) \
+    ((count) == 0 ? "0" : (count) == 1 ? "1" : "many")
+
+/// @brief Creates a solver.
+/// @param N in: grid size factor
+/// @param engine in: the solving engine. @ref ENGINE_AUTO is resolved for
+/// @p N.
+/// @param propagate in: whether to propagate singletons while backtracking
+/// @return A new solver. Must be freed with @ref solver_free.
+tSolver solver_create(tIntN N, tEngine engine, bool propagate);
+
+/// @brief Frees a solver.
+/// @param solver in/out: the solver to free
+/// @remark It's always safe to call this function on a zero-initialized or
+/// created solver, as all its pointers are either NULL or valid.
+void solver_free(tSolver *solver);
+
+/// @brief Estimates the memory of a solver, before creating it.
+/// @param N in: grid size factor
+/// @param propagate in: whether the solver propagates singletons while
+/// backtracking
+/// @return The number of bytes the solver allocates at most.
+/// @remark The Dancing Links matrix, which only grows with the candidates of
+/// the grid solved, is not counted.
+size_t solver_memorySize(tIntN N, bool propagate);
+
+/// @brief Solves the grid of a solver.
+/// @param solver in/out: the solver
+/// @return Whether the grid has been solved.
+bool solver_solve(tSolver *solver);
+
+/// @brief Makes progress on the grid of a solver with the logic techniques,
+/// as long as they pay off.
+/// @param solver in/out: the solver
+/// @remark First step of @ref solver_solve with @ref ENGINE_TECHNIQUES.
+/// @remark The techniques are scheduled by @ref schedule_apply.
+void solver_applyTechniques(tSolver *solver);
+
+/// @brief Makes as much progress as possible on the grid of a solver with the
+/// logic techniques of a tier.
+/// @param solver in/out: the solver
+/// @param tier in: the tier, below @ref TIER_BACKTRACKING
+void solver_applyTier(tSolver *solver, tTier tier);
+
+/// @brief Grades a grid by the lowest tier of techniques that solves it.
+/// @param solver in/out: the solver. Its grid is left partially solved.
+/// @param sudValues in: the Sud values of the grid, which must have a unique
+/// solution
+/// @return The lowest tier that solves the grid, or @ref TIER_BACKTRACKING.
+tTier solver_grade(tSolver *solver, uint32_t const *sudValues);
+
+/// @brief Fills the grid of a solver with a random solution, by backtracking
+/// in a random value order.
+/// @param solver in/out: the solver
+/// @param random in/out: the state of the pseudo-random generator
+/// @return Whether the grid has been solved.
+bool solver_randomSolve(tSolver *solver, uint64_t *random);
+
+/// @brief Solves the grid of a solver by backtracking.
+/// @param solver in/out: the solver
+/// @param cancel in: when set by another thread, the search stops and fails.
+/// May be NULL.
+/// @return Whether the grid has been solved.
+/// @remark Last step of @ref solver_solve with @ref ENGINE_TECHNIQUES.
+bool solver_backtrack(tSolver *solver, atomic_bool const *cancel);
+
+/// @brief Counts the solutions of the grid of a solver, up to a limit.
+/// @param solver in/out: the solver
+/// @param limit in: the number of solutions at which the search stops. At
+/// least 1.
+/// @return The number of solutions of the grid, at most @p limit.
+/// @remark The grid is left with the first solution found, if any.
+/// @remark Whatever the engine, the grid is solved by backtracking, which goes
+/// on past the first solution. The logic techniques are not applied, as they
+/// don't expect grids without solutions.
+unsigned solver_countSolutions(tSolver *solver, unsigned limit);
+
+/////////////////////////////////////////////////////////////////////////
+
+tSolver solver_create(tIntN N, tEngine engine, bool propagate) {
+    return (tSolver) {
+        // Reserve room in the arena of the grid for the backtracking state. The
+        // index of the empty cells is also used by solver_randomSolve.
+        .grid = grid_create(N, mrv_arenaSize(N) + (propagate ? trail_arenaSize(N) : 0)),
+        .engine = engine != ENGINE_AUTO             ? engine
+                  : fixed_isSpecialized(N) && !propagate ? ENGINE_FIXED
+                                                         : ENGINE_TECHNIQUES,
+        .propagate = propagate,
+    };
+}
+
+size_t solver_memorySize(tIntN N, bool propagate) {
+    // Creating a solver doesn't allocate its grid yet
+    tSolver const solver = solver_create(N, ENGINE_TECHNIQUES, propagate);
+    return grid_arenaSize(&solver.grid) + solver.grid._arenaReserve;
+}
+
+void solver_free(tSolver *solver) {
+    // The backtracking state lives in the arena of the grid
+    grid_free(&solver->grid);
+    dlx_free(&solver->dlx);
+    free(solver->solution);
+    solver->solution = NULL;
+}
+
+bool solver_solve(tSolver *solver) {
+    if (solver->engine == ENGINE_FIXED && fixed_isSpecialized(solver->grid.N)) {
+        return stats_measure(solver->grid.stats, TECHNIQUE_FIXED, fixed_solve(&solver->grid));
+    }
+
+    if (solver->engine == ENGINE_DLX) {
+        solver->dlx = dlx_create(&solver->grid);
+
+        bool const solved = stats_measure(solver->grid.stats, TECHNIQUE_DLX, dlx_solve(&solver->dlx, &solver->grid));
+
+        dlx_free(&solver->dlx);
+        solver->dlx = (tDlx) { 0 };
+
+        return solved;
+    }
+
+    solver_applyTechniques(solver);
+
+    // Wrap up with backtracking which will always solve the grid.
+    return solver_backtrack(solver, NULL);
+}
+
+void solver_applyTechniques(tSolver *solver) {
+    schedule_apply(&solver->grid);
+}
+
+void solver_applyTier(tSolver *solver, tTier tier) {
+    tGrid *grid = &solver->grid;
+    size_t fishSince = 0; // change count at the start of the last fish pass
+    bool progress; // if the fish technique made progress
+
+    do {
+        // Drain the queue of changed units with the simple techniques, then
+        // try the fish technique on the rows and columns changed since its
+        // last pass. Its eliminations queue units for the simple techniques,
+        // and vice versa. The loop continues until no further progress can be
+        // made.
+        perform_simpleTechniques(grid, tier >= TIER_PAIRS);
+
+        size_t const since = fishSince;
+        fishSince = grid->_changeCount;
+        progress = tier >= TIER_FISH
+            && stats_measure(grid->stats, TECHNIQUE_FISH, technique_fish(grid, since));
+    } while (progress);
+}
+
+tTier solver_grade(tSolver *solver, uint32_t const *sudValues) {
+    for (tTier tier = TIER_SINGLETONS; tier < TIER_BACKTRACKING; tier++) {
+        grid_loadSudValues(&solver->grid, sudValues);
+        solver_applyTier(solver, tier);
+        if (grid_isSolved(&solver->grid)) {
+            return tier;
+        }
+    }
+    return TIER_BACKTRACKING;
+}
+
+bool solver_randomSolve(tSolver *solver, uint64_t *random) {
+    tGrid *grid = &solver->grid;
+
+    if (solver->mrv.possibleCounts == NULL) {
+        solver->mrv = mrv_create(grid);
+    }
+    mrv_reset(&solver->mrv, grid);
+
+    return technique_randomBacktracking(grid, &solver->mrv, random);
+}
+
+bool solver_backtrack(tSolver *solver, atomic_bool const *cancel) {
+    tGrid *grid = &solver->grid;
+    bool solved;
+
+    if (solver->propagate) {
+        if (solver->trail.entries == NULL) {
+            solver->trail = trail_create(grid);
+        }
+
+        solved = stats_measure(grid->stats, TECHNIQUE_BACKTRACKING,
+            propagation_init(grid, &solver->trail)
+                && propagation_propagate(grid, &solver->trail)
+                && technique_propagatingBacktracking(grid, &solver->trail, cancel));
+    } else {
+        if (solver->mrv.possibleCounts == NULL) {
+            solver->mrv = mrv_create(grid);
+        }
+
+        // Index the remaining empty cells for backtracking
+        mrv_reset(&solver->mrv, grid);
+
+        solved = stats_measure(grid->stats, TECHNIQUE_BACKTRACKING, technique_backtracking(grid, &solver->mrv, cancel));
+    }
+
+    return solved;
+}
+
+unsigned solver_countSolutions(tSolver *solver, unsigned limit) {
+    tGrid *grid = &solver->grid;
+    unsigned count = 0;
+
+    // Backtracking relies on the values only, which must not conflict
+    if (grid_hasConflicts(grid)) {
+        return 0;
+    }
+
+    if (solver->solution == NULL) {
+        solver->solution = check_alloc(array_malloc(solver->solution, (size_t)grid_size(*grid) * grid_size(*grid)), "solver solution array");
+    }
+
+    if (solver->propagate) {
+        if (solver->trail.entries == NULL) {
+            solver->trail = trail_create(grid);
+        }
+
+        (void)stats_measure(grid->stats, TECHNIQUE_BACKTRACKING,
+            propagation_init(grid, &solver->trail)
+                && propagation_propagate(grid, &solver->trail)
+                && technique_countingPropagatingBacktracking(grid, &solver->trail, limit, &count, solver->solution));
+    } else {
+        if (solver->mrv.possibleCounts == NULL) {
+            solver->mrv = mrv_create(grid);
+        }
+
+        mrv_reset(&solver->mrv, grid);
+
+        (void)stats_measure(grid->stats, TECHNIQUE_BACKTRACKING,
+            technique_countingBacktracking(grid, &solver->mrv, limit, &count, solver->solution));
+    }
+
+    if (count > 0) {
+        grid_loadSudValues(grid, solver->solution);
+    }
+
+    return count;
+}
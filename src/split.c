@@ -0,0 +1,225 @@
+/** @file
+ * @brief Parallel search tree splitting
+ * @author 5cover, Matteo-K
+ *
+ * Lowers the latency of solving a single hard grid by splitting the top levels
+ * of its backtracking search tree into independent subproblems, solved on a
+ * pool of threads.
+ *
+ * The subproblems are expanded breadth-first: the most constrained empty cell of
+ * a subproblem is replaced by one child subproblem per possible value, until
+ * there are enough of them to keep the threads busy. Each subproblem is a copy
+ * of the grid values, which a thread loads into its own solver and backtracks
+ * on. The first thread to find a solution cancels the others.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "grid.c"
+#include "memdbg.c"
+#include "solver.c"
+#include "types.c"
+
+/// @brief Integer: number of subproblems to expand per thread.
+/// @remark More subproblems balance the load better, as their difficulty
+/// varies widely.
+#define SPLIT_SUBPROBLEMS_PER_THREAD 16
+
+/// @brief Subproblems shared by the threads of a split solve.
+typedef struct {
+    /// @brief Sud values of the subproblems, in a ring buffer.
+    /// @remark Dimensions: [subproblemIndex][cellIndex]
+    uint32_t *subproblems;
+
+    /// @brief Capacity of the ring buffer, in subproblems.
+    size_t capacity;
+
+    /// @brief Index of the first subproblem in the ring buffer.
+    size_t first;
+
+    /// @brief Number of subproblems.
+    size_t count;
+
+    /// @brief Index of the next subproblem to solve, relative to @ref first.
+    atomic_size_t next;
+
+    /// @brief Set when a solution has been found.
+    atomic_bool solved;
+
+    /// @brief Sud values of the solution.
+    uint32_t *solution;
+
+    /// @brief Grid size factor.
+    tIntN N;
+
+    /// @brief Whether the solvers of the threads propagate singletons.
+    bool propagate;
+} tSplit;
+
+/// @brief Gets a subproblem of a split.
+/// @param split in: the split
+/// @param i in: the index of the subproblem, relative to @c split.first
+/// @param cellCount in: the number of cells of the grid
+/// @return The Sud values of the subproblem.
+#define split_subproblem(split, i, cellCount) \
+    (&(split).subproblems[(((split).first + (i)) % (split).capacity) * (cellCount)])
+
+/// @brief Solves the grid of a solver, splitting its search tree between
+/// threads.
+/// @param solver in/out: the solver
+/// @param threadCount in: the number of threads to use
+/// @return Whether the grid has been solved.
+/// @remark Only applies to @ref ENGINE_TECHNIQUES. Other engines solve
+/// sequentially. Without a solution, the grid is left as the logic techniques
+/// left it.
+bool split_solve(tSolver *solver, unsigned threadCount);
+
+/// @brief Expands the subproblems of a split breadth-first.
+/// @param split in/out: the split, with a single subproblem
+/// @param scratch in/out: a grid used to expand the subproblems
+/// @param targetCount in: the number of subproblems to reach
+/// @return Whether a subproblem turned out to be solved. If so, it is in @c
+/// split->solution.
+/// @remark Used in @ref split_solve.
+bool split_expand(tSplit *split, tGrid *scratch, size_t targetCount);
+
+/// @brief Main function of a split thread.
+/// @param split in/out: the split (tSplit *)
+/// @return NULL.
+/// @remark Used in @ref split_solve.
+void *split_threadMain(void *split);
+
+/////////////////////////////////////////////////////////////////////////
+
+bool split_solve(tSolver *solver, unsigned threadCount) {
+    if (solver->engine != ENGINE_TECHNIQUES || threadCount <= 1) {
+        return solver_solve(solver);
+    }
+
+    solver_applyTechniques(solver);
+
+    tGrid *grid = &solver->grid;
+    size_t const cellCount = (size_t)grid_size(*grid) * grid_size(*grid);
+    size_t const targetCount = (size_t)SPLIT_SUBPROBLEMS_PER_THREAD * threadCount;
+
+    tSplit split = {
+        // A subproblem is expanded while there are less than targetCount, into
+        // at most SIZE children
+        .capacity = targetCount + grid_size(*grid),
+        .first = 0,
+        .count = 1,
+        .N = grid->N,
+        .propagate = solver->propagate,
+    };
+    atomic_init(&split.next, 0);
+    atomic_init(&split.solved, false);
+    split.subproblems = check_alloc(array_malloc(split.subproblems, split.capacity * cellCount), "split subproblems array");
+    split.solution = check_alloc(array_malloc(split.solution, cellCount), "split solution array");
+
+    grid_storeSudValues(grid, split.subproblems);
+
+    tGrid scratch = grid_create(grid->N, 0);
+    bool const solvedWhileExpanding = split_expand(&split, &scratch, targetCount);
+    grid_free(&scratch);
+
+    if (!solvedWhileExpanding && split.count > 0) {
+        pthread_t *threads = check_alloc(array_malloc(threads, threadCount), "split threads array");
+
+        for (unsigned t = 0; t < threadCount; t++) {
+            pthread_create(&threads[t], NULL, split_threadMain, &split);
+        }
+        for (unsigned t = 0; t < threadCount; t++) {
+            pthread_join(threads[t], NULL);
+        }
+
+        free(threads);
+    }
+
+    bool const solved = solvedWhileExpanding || atomic_load(&split.solved);
+    if (solved) {
+        grid_loadSudValues(grid, split.solution);
+    }
+
+    free(split.subproblems);
+    free(split.solution);
+
+    return solved;
+}
+
+bool split_expand(tSplit *split, tGrid *scratch, size_t targetCount) {
+    size_t const cellCount = (size_t)grid_size(*scratch) * grid_size(*scratch);
+
+    while (split->count > 0 && split->count < targetCount) {
+        // Pop the first subproblem. Its slot is free once loaded.
+        grid_loadSudValues(scratch, split_subproblem(*split, 0, cellCount));
+        split->first = (split->first + 1) % split->capacity;
+        split->count--;
+
+        // Find its most constrained empty cell
+        size_t iCell = cellCount;
+        tIntSize minCount = grid_size(*scratch) + 1;
+        for (tIntSize r = 0; r < grid_size(*scratch) && minCount > 1; r++) {
+            for (tIntSize c = 0; c < grid_size(*scratch) && minCount > 1; c++) {
+                if (!cell_hasValue(grid_cellAt(*scratch, r, c))) {
+                    grid_cellPossibleValuesCount(*scratch, r, c, possibleCount);
+                    if (possibleCount < minCount) {
+                        minCount = possibleCount;
+                        iCell = at2d(grid_size(*scratch), r, c);
+                    }
+                }
+            }
+        }
+
+        // No empty cells left, the subproblem is solved
+        if (iCell == cellCount) {
+            grid_storeSudValues(scratch, split->solution);
+            return true;
+        }
+
+        // Push a child per possible value. None if the subproblem is a dead end.
+        tIntSize const row = iCell / grid_size(*scratch), column = iCell % grid_size(*scratch);
+        for (tIntSize word = 0; word < scratch->_candidateWordCount; word++) {
+            for (tBitWord possibleValues = grid_cellPossibleValuesWord(*scratch, row, column, word);
+                possibleValues != 0; possibleValues &= possibleValues - 1) {
+                uint32_t *child = split_subproblem(*split, split->count, cellCount);
+                grid_storeSudValues(scratch, child);
+                child[iCell] = word * BITWORD_BITS + bitword_first(possibleValues);
+                split->count++;
+            }
+        }
+    }
+
+    return false;
+}
+
+void *split_threadMain(void *split) {
+    tSplit *self = split;
+    size_t const cellCount = (size_t)(self->N * self->N) * (self->N * self->N);
+    tSolver solver = solver_create(self->N, ENGINE_TECHNIQUES, self->propagate);
+
+    size_t i;
+    while (!atomic_load_explicit(&self->solved, memory_order_relaxed)
+        && (i = atomic_fetch_add(&self->next, 1)) < self->count) {
+        // Subproblems may be contradictory, which the logic techniques don't
+        // expect. Backtracking copes with that, as it relies on the values only.
+        grid_loadSudValues(&solver.grid, split_subproblem(*self, i, cellCount));
+
+        if (solver_backtrack(&solver, &self->solved)) {
+            // Only the first solution is kept: it cancels the other threads.
+            bool expected = false;
+            if (atomic_compare_exchange_strong(&self->solved, &expected, true)) {
+                grid_storeSudValues(&solver.grid, self->solution);
+            }
+        }
+    }
+
+    solver_free(&solver);
+
+    return NULL;
+}
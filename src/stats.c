@@ -0,0 +1,242 @@
+/** @file
+ * @brief Solving statistics
+ * @author 5cover, Matteo-K
+ *
+ * Counts, per technique, the invocations, the candidates eliminated, the values
+ * placed and the cycles spent, as well as the nodes, maximum depth and dead ends
+ * of the backtracking search.
+ *
+ * The statistics are compiled in with @c -DSUDONE_STATS (e.g. @c make
+ * cf=-DSUDONE_STATS) and recorded when @ref stats_enabled is set at run time.
+ * Compiled out, the macros of this file expand to nothing and the grids have no
+ * statistics member, so they cost nothing.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>
+#endif
+
+#include "utils.c"
+
+/// @brief A technique whose statistics are recorded.
+typedef enum {
+    TECHNIQUE_NAKED_SINGLETON,
+    TECHNIQUE_HIDDEN_SINGLETON,
+    TECHNIQUE_NAKED_PAIR,
+    TECHNIQUE_HIDDEN_PAIR,
+    TECHNIQUE_FISH,
+    /// @brief The backtracking search of @ref ENGINE_TECHNIQUES.
+    TECHNIQUE_BACKTRACKING,
+    /// @brief The solve of @ref ENGINE_DLX.
+    TECHNIQUE_DLX,
+    /// @brief The solve of @ref ENGINE_FIXED.
+    TECHNIQUE_FIXED,
+    TECHNIQUE_COUNT,
+} tTechnique;
+
+/// @brief Statistics of a technique.
+typedef struct {
+    /// @brief Number of invocations.
+    uint64_t calls;
+    /// @brief Number of candidates eliminated.
+    uint64_t eliminated;
+    /// @brief Number of values placed.
+    uint64_t placed;
+    /// @brief Number of cycles spent, or nanoseconds where there is no cycle
+    /// counter.
+    uint64_t cycles;
+} tTechniqueStats;
+
+/// @brief Statistics of the solve of a grid.
+typedef struct {
+    /// @brief Statistics of each technique.
+    /// @remark Dimensions: [technique]
+    tTechniqueStats techniques[TECHNIQUE_COUNT];
+    /// @brief Running number of candidates eliminated, by any technique.
+    uint64_t eliminated;
+    /// @brief Running number of values placed, by any technique.
+    uint64_t placed;
+    /// @brief Number of backtracking nodes visited.
+    uint64_t nodes;
+    /// @brief Number of backtracking nodes none of whose values led to a
+    /// solution.
+    uint64_t deadEnds;
+    /// @brief Current backtracking depth.
+    unsigned depth;
+    /// @brief Maximum backtracking depth reached.
+    unsigned maxDepth;
+} tStats;
+
+/// @brief Snapshot of the running statistics at the start of a technique.
+typedef struct {
+    uint64_t cycles, eliminated, placed;
+} tStatsMark;
+
+/// @brief Whether the statistics are recorded.
+/// @remark Set once at startup, before any solve.
+bool stats_enabled = false;
+
+#ifdef SUDONE_STATS
+
+/// @brief Resets statistics.
+#define stats_reset(stats) memset(&(stats), 0, sizeof(stats))
+
+/// @brief Adds to a running statistic.
+/// @param stats in/out: the statistics
+/// @param member in: the member of the statistic
+/// @param amount in: the amount to add
+#define stats_add(stats, member, amount)  \
+    do {                                 \
+        if (stats_enabled) {             \
+            (stats).member += (amount);  \
+        }                                \
+    } while (0)
+
+/// @brief Evaluates an expression as an invocation of a technique.
+/// @param stats in/out: the statistics
+/// @param technique in: the technique (@ref tTechnique)
+/// @param call in: the expression invoking the technique
+/// @return The value of @p call.
+#define stats_measure(stats, technique, call)                      \
+    __extension__({                                                \
+        tStatsMark const _statsMark = stats_mark(&(stats));        \
+        __typeof__(call) const _statsResult = (call);              \
+        stats_record(&(stats), (technique), _statsMark);           \
+        _statsResult;                                              \
+    })
+
+/// @brief Records the entry in a backtracking node.
+#define stats_enterNode(stats)                                    \
+    do {                                                          \
+        if (stats_enabled) {                                      \
+            (stats).nodes++;                                      \
+            (stats).depth++;                                      \
+            (stats).maxDepth = max((stats).maxDepth, (stats).depth); \
+        }                                                         \
+    } while (0)
+
+/// @brief Records the exit of a backtracking node.
+/// @param stats in/out: the statistics
+/// @param isDeadEnd in: whether none of the values of the node led to a solution
+#define stats_leaveNode(stats, isDeadEnd) \
+    do {                                  \
+        if (stats_enabled) {              \
+            (stats).depth--;              \
+            (stats).deadEnds += (isDeadEnd); \
+        }                                 \
+    } while (0)
+
+#else
+
+#define stats_reset(stats) ((void)0)
+#define stats_add(stats, member, amount) ((void)0)
+#define stats_measure(stats, technique, call) (call)
+#define stats_enterNode(stats) ((void)0)
+#define stats_leaveNode(stats, isDeadEnd) ((void)sizeof(isDeadEnd))
+
+#endif // SUDONE_STATS
+
+/// @brief Determines whether the statistics are compiled in.
+#ifdef SUDONE_STATS
+#define stats_isCompiled true
+#else
+#define stats_isCompiled false
+#endif
+
+/// @brief Reads the cycle counter.
+/// @return The cycle count, or the monotonic clock in nanoseconds where there
+/// is no cycle counter.
+uint64_t stats_cycles(void);
+
+/// @brief Takes a snapshot of the running statistics before a technique.
+/// @param stats in: the statistics
+/// @return The snapshot, meaningless if the statistics aren't enabled.
+tStatsMark stats_mark(tStats const *stats);
+
+/// @brief Records an invocation of a technique.
+/// @param stats in/out: the statistics
+/// @param technique in: the technique
+/// @param mark in: the snapshot taken by @ref stats_mark before the invocation
+void stats_record(tStats *stats, tTechnique technique, tStatsMark mark);
+
+/// @brief Prints statistics as a one-line JSON record.
+/// @param stats in: the statistics
+/// @param gridNumber in: the number of the grid in the input, from 1
+/// @param outStream in: the stream to print to
+/// @remark Only the techniques invoked are printed. The line is written
+/// atomically with respect to the other threads.
+void stats_print(tStats const *stats, unsigned long gridNumber, FILE *outStream);
+
+/////////////////////////////////////////////////////////////////////////
+
+uint64_t stats_cycles(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+tStatsMark stats_mark(tStats const *stats) {
+    if (!stats_enabled) {
+        return (tStatsMark) { 0 };
+    }
+    return (tStatsMark) {
+        .cycles = stats_cycles(),
+        .eliminated = stats->eliminated,
+        .placed = stats->placed,
+    };
+}
+
+void stats_record(tStats *stats, tTechnique technique, tStatsMark mark) {
+    if (!stats_enabled) {
+        return;
+    }
+    tTechniqueStats *t = &stats->techniques[technique];
+    t->cycles += stats_cycles() - mark.cycles;
+    t->calls++;
+    t->eliminated += stats->eliminated - mark.eliminated;
+    t->placed += stats->placed - mark.placed;
+}
+
+void stats_print(tStats const *stats, unsigned long gridNumber, FILE *outStream) {
+    static char const *const names[TECHNIQUE_COUNT] = {
+        [TECHNIQUE_NAKED_SINGLETON] = "naked_singleton",
+        [TECHNIQUE_HIDDEN_SINGLETON] = "hidden_singleton",
+        [TECHNIQUE_NAKED_PAIR] = "naked_pair",
+        [TECHNIQUE_HIDDEN_PAIR] = "hidden_pair",
+        [TECHNIQUE_FISH] = "fish",
+        [TECHNIQUE_BACKTRACKING] = "backtracking",
+        [TECHNIQUE_DLX] = "dlx",
+        [TECHNIQUE_FIXED] = "fixed",
+    };
+
+    flockfile(outStream);
+
+    fprintf(outStream, "{\"grid\":%lu", gridNumber);
+    for (tTechnique technique = 0; technique < TECHNIQUE_COUNT; technique++) {
+        tTechniqueStats const *t = &stats->techniques[technique];
+        if (t->calls > 0) {
+            fprintf(outStream,
+                ",\"%s\":{\"calls\":%" PRIu64 ",\"eliminated\":%" PRIu64
+                ",\"placed\":%" PRIu64 ",\"cycles\":%" PRIu64 "}",
+                names[technique], t->calls, t->eliminated, t->placed, t->cycles);
+        }
+    }
+    fprintf(outStream,
+        ",\"search\":{\"nodes\":%" PRIu64 ",\"max_depth\":%u,\"dead_ends\":%" PRIu64 "}}\n",
+        stats->nodes, stats->maxDepth, stats->deadEnds);
+
+    funlockfile(outStream);
+}
@@ -16,19 +16,24 @@
 /// @brief Returns the number of candidates of a cell.
 /// @param cell in: the cell
 /// @return The number of candidates of @p cell.
-#define cell_candidate_count(cell) ((cell)._candidateCount)
+#define cell_candidate_count(cell) (*(cell)._candidateCount)
 
 /// @brief Determines whether a cell has a value.
 /// @param cell in: the cell
 /// @return A boolean indicating whether @p cell has a value.
-#define cell_hasValue(cell) ((cell)._value != 0)
+#define cell_hasValue(cell) (*(cell)._value != 0)
+
+/// @brief Gets the value of a cell.
+/// @param cell in: the cell
+/// @return The value of @p cell as an lvalue, 0 if it has none.
+#define cell_value(cell) (*(cell)._value)
 
 /// @brief Determines whether a cell has a specific value as a candidate.
 /// @param cell in: the cell
 /// @param candidate in: the candidate to check
 /// @return A boolean indicating whether @p cell has @p candidate as a
 /// candidate.
-#define cell_hasCandidate(cell, candidate) ((cell).hasCandidate[candidate])
+#define cell_hasCandidate(cell, candidate) bitset_has((cell).candidates, candidate)
 
 /// @brief Gets the first candidate of a cell in the range [1 ; @ref SIZE].
 /// @param cell in: the cell
@@ -36,13 +41,10 @@
 /// @return The first value in the range [1 ; @ref SIZE] that is a candidate of
 /// @p cell.
 /// @remark This macro is equivalent to calling @c cell_candidateAt(cell,1) but
-/// offers better performance as it does not require the overhead of a function
-/// call.
+/// offers better performance as it scans for the lowest set bit directly.
+/// @remark @p cell must have at least one candidate.
 #define cell_get_first_candidate(cell, outVarName) \
-    tIntSize outVarName = 1;                       \
-    while (!cell_hasCandidate(cell, outVarName)) { \
-        outVarName++;                              \
-    }
+    tIntSize outVarName = bitset_first((cell).candidates)
 
 /// @brief Returns the nth candidate of a cell in the range [1 ; @ref SIZE].
 /// @param cell in: the cell
@@ -55,12 +57,5 @@ int cell_candidateAt(tCell const *cell, tIntSize n);
 int cell_candidateAt(tCell const *cell, tIntSize n) {
     assert(n <= cell_candidate_count(*cell));
 
-    tIntSize candidate = 0;
-
-    while (n > 0) {
-        candidate++;
-        n -= cell->hasCandidate[candidate];
-    }
-
-    return candidate;
+    return bitset_nth(cell->candidates, n);
 }
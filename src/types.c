@@ -8,7 +8,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "arena.c"
+#include "bitset.c"
 #include "const.c"
+#include "stats.c"
 
 #define array_malloc(name, length) malloc(sizeof *(name) * (length))
 #define array_calloc(name, length) calloc(sizeof *(name), (length))
@@ -33,57 +36,185 @@ typedef uint_least8_t tIntN;
 
 /// @brief Type for a SIZE-majored integer.
 /// @remark Range : [0; @ref MAX_SIZE]
-/// @remark May be used for grid axis indexes, cell indexes, block indexes,
-/// value/candodate counts.
+/// @remark May be used for grid axis indexes, block indexes, value/candodate
+/// counts. Flat cell indexes need a @ref tIntCell.
 typedef uint_least16_t tIntSize;
 
+/// @brief Type for a flat cell index.
+/// @remark Range : [0; @ref MAX_SIZE²[
+typedef uint_least32_t tIntCell;
+
+/// @brief Kind of a unit: a row, a column or a block.
+/// @remark A unit index is <tt>kind * SIZE + index</tt>, where index is the row,
+/// column or block index.
+typedef enum {
+    UNIT_ROW,
+    UNIT_COLUMN,
+    UNIT_BLOCK,
+    /// @brief Number of unit kinds.
+    UNIT_KIND_COUNT,
+} tUnitKind;
+
 /// @brief Maximum value of the grid size factor.
 #define MAX_N UINT_LEAST8_MAX
 /// @brief Maximum number of tiles in the grid. Equivalent to @ref MAX_N².
 #define MAX_SIZE UINT_LEAST16_MAX
 
-/// @brief A cell of a Sudoku grid
+/// @brief A reference to a cell of a Sudoku grid.
+/// @remark The fields of the cells are stored in separate arrays of the grid,
+/// so that a scan only touches the field it needs. A reference is built on the
+/// fly by @ref grid_cellAt and only lives in registers.
 typedef struct {
-    /// @brief Value of the cell.
-    /// @remark In range [1 ; SIZE]
-    tIntSize _value;
+    /// @brief Value of the cell, 0 if it has none.
+    /// @remark Points into the @ref tGrid.values array of the grid owning the
+    /// cell.
+    tIntSize *_value;
 
-    /// @brief Boolean dynamic array of length SIZE + 1 representing for each
-    /// candidate whether it is present or not.
-    /// @remark The first ekement of the array at index 0 is unused. This is to
-    /// allow direct indexation with the candidate value.
-    bool *hasCandidate;
+    /// @brief Bitset of SIZE + 1 bits representing for each candidate whether it
+    /// is present or not.
+    /// @remark Points into the @ref tGrid._candidates array of the grid owning
+    /// the cell.
+    /// @remark The first bit at index 0 is unused. This is to allow direct
+    /// indexation with the candidate value.
+    tBitWord *candidates;
 
     /// @brief Number of candidates.
-    /// @remark In range [0 ; SIZE]
-    tIntSize _candidateCount;
+    /// @remark Points into the @ref tGrid._candidateCounts array of the grid
+    /// owning the cell.
+    tIntSize *_candidateCount;
 } tCell;
 
 /// @brief A Sudoku grid
 typedef struct {
-    /// @brief Square dynamic matrix of cells of side SIZE representing a Sudoku
-    /// grid
+    /// @brief Square dynamic matrix of side SIZE holding the values of the
+    /// cells, 0 for an empty cell.
     /// @remark Dimensions: [rowIndex][columnIndex]
-    tCell *cells;
+    tIntSize *values;
+
+    /// @brief Square dynamic matrix of side SIZE holding the number of
+    /// candidates of the cells.
+    /// @remark Dimensions: [rowIndex][columnIndex]
+    tIntSize *_candidateCounts;
 
     /// @brief Grid size factor.
     /// @remark This member is semantically constant and should not be reassigned.
     tIntN N;
 
-    /// @brief Boolean dynamic matrix representing for each column whether the
-    /// value is present or not.
-    /// @remark Dimensions: [columnIndex][value]
-    bool *_isColumnFree;
+    /// @brief Number of words of a bitset of values: the candidate bitset of a
+    /// cell or the value bitset of a row, column or block.
+    /// @remark This member is semantically constant and should not be reassigned.
+    tIntSize _candidateWordCount;
+
+    /// @brief Contiguous dynamic array holding the candidate bitsets of all
+    /// cells.
+    /// @remark Dimensions: [rowIndex][columnIndex][word]
+    tBitWord *_candidates;
+
+    /// @brief Bitset dynamic matrix representing for each unit (row, column
+    /// and block) which values are present.
+    /// @remark Dimensions: [unitIndex][word]. See @ref tUnitKind for unit
+    /// indexes, block indexes are blockRowIndex * N + blockColumnIndex.
+    /// @remark Bit 0 and the padding bits after SIZE are always set, so the
+    /// complement of a bitset only holds the free values.
+    tBitWord *_unitValues;
+
+    /// @brief Flat indexes of the cells of each unit, in row-major order.
+    /// @remark Dimensions: [unitIndex][i] (SIZE cells per unit)
+    tIntCell *_unitCells;
+
+    /// @brief Row, column and block index of each cell.
+    /// @remark Dimensions: [cellIndex][unitKind]
+    tIntSize *_cellUnits;
+
+    /// @brief Flat indexes of the peers of each cell: the other cells of its
+    /// row, column and block, each listed once.
+    /// @remark Dimensions: [cellIndex][i] (see @ref grid_peerCount)
+    /// @remark NULL for a large grid (see @ref GRID_LARGE_N).
+    tIntCell *_peers;
+
+    /// @brief Flat indexes of the peers of the last cell passed to @ref
+    /// grid_cellPeers, for a large grid. NULL otherwise.
+    /// @remark Dimensions: [i] (see @ref grid_peerCount)
+    tIntCell *_peerBuffer;
+
+    /// @brief Dynamic matrix of side SIZE holding the values of the grid in the
+    /// Sud format.
+    /// @remark Used as a buffer when reading the grid.
+    uint32_t *_sudValues;
+
+    /// @brief Occurrences of the candidates of the last group counted with
+    /// @ref grid_countGroupCandidates.
+    /// @remark Dimensions: [occurrences - 1][word], for 1 to 3 occurrences:
+    /// the candidates present in at least one, two and three cells.
+    tBitWord *_groupOccurrences;
+
+    /// @brief Positions of each candidate in each row and column, as mapped by
+    /// @ref grid_mapCandidatePositions.
+    /// @remark Dimensions: [unitKind][candidate][lineIndex][word], for the row
+    /// and column kinds: the bitset of SIZE bits of the columns of a row, or the
+    /// rows of a column, holding the candidate.
+    tBitWord *_candidatePositions;
+
+    /// @brief Scratch buffer of the fish technique: the union of the positions
+    /// of the base lines at each search depth.
+    /// @remark Dimensions: [depth][word] (@ref FISH_MAX_SIZE + 1 bitsets of
+    /// SIZE bits)
+    tBitWord *_fishCovers;
+
+    /// @brief Units whose cells the logic techniques must examine again, in a
+    /// ring buffer.
+    /// @remark Capacity: the number of units, as a unit is queued at most once.
+    tIntCell *_unitQueue;
+
+    /// @brief Index of the first unit of @ref _unitQueue.
+    tIntCell _unitQueueFirst;
+
+    /// @brief Number of units in @ref _unitQueue.
+    tIntCell _unitQueueCount;
+
+    /// @brief Whether each unit is in @ref _unitQueue.
+    /// @remark Dimensions: [unitIndex]
+    bool *_isUnitQueued;
+
+    /// @brief Value of @ref _changeCount when a cell of each unit last changed.
+    /// @remark Dimensions: [unitIndex]
+    size_t *_unitChanges;
+
+    /// @brief Number of cell changes since the grid was cleared.
+    size_t _changeCount;
+
+    /// @brief Number of empty cells examined by the singletons and pairs, and
+    /// of base lines examined by the fish, since the grid was cleared. A
+    /// deterministic measure of the cost of the logic techniques.
+    size_t _workCount;
+
+    /// @brief Text rendering of the grid.
+    /// @remark The separators are written once when the grid is allocated, and
+    /// @ref grid_print only fills in the values.
+    char *_text;
+
+    /// @brief Rendered values, right-aligned on @ref _textPadding characters.
+    /// @remark Dimensions: [value][character] (SIZE + 1 values, 0 is the empty
+    /// value)
+    char *_textValues;
+
+    /// @brief Width of a value in @ref _text.
+    /// @remark This member is semantically constant and should not be reassigned.
+    int _textPadding;
 
-    /// @brief Boolean dynamic matrix representing for each row whether the value
-    /// is present or not.
-    /// @remark Dimensions: [rowIndex][value]
-    bool *_isRowFree;
+    /// @brief Arena holding all the storage of the grid, then @ref
+    /// _arenaReserve bytes for the solving engines.
+    tArena _arena;
+
+    /// @brief Number of bytes reserved in @ref _arena for the solving engines.
+    /// @remark This member is semantically constant and should not be reassigned.
+    size_t _arenaReserve;
 
-    /// @brief Boolean dynamic 3D array representing for each block whether the
-    /// value is present or not.
-    /// @remark Dimensions: [blockRowIndex][blockColumnIndex][value]
-    bool *_isBlockFree;
+#ifdef SUDONE_STATS
+    /// @brief Solving statistics of the grid.
+    /// @remark Reset by the caller before each solve.
+    tStats stats;
+#endif
 } tGrid;
 
 /// @brief A position on the grid
@@ -7,12 +7,26 @@
 
 #include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /// @brief Gets the necessary buffer size for a sprintf operation.
 #define bufferSize(format, args) \
     (vsnprintf(NULL, 0, (format), (args)) + 1) // safe byte for \0
 
+/// @brief Draws the next integer of a pseudo-random generator (splitmix64).
+/// @param state in/out: the state of the generator. Any value is a valid seed.
+/// @return A pseudo-random integer.
+static inline uint64_t random_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+/// @brief Draws a pseudo-random integer in [0 ; @p bound[.
+#define random_below(state, bound) (random_next(state) % (bound))
+
 /// @brief Gets the digit count of an unsigned integer @p n in base @p base.
 #define digitCount(n, base) ((n) == 0 ? 1 : (int)(log(n) / log(base)) + 1)
 